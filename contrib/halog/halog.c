@@ -16,34 +16,56 @@
  * Usage:
  *    $0 [ min_delay [ min_count [ field_shift ]]] < haproxy.log
  *    Note: if min_delay < 0, it only outputs lines with status codes 5xx.
+ *
+ * With -b, the input is made of the binary records sent to the "log-binary"
+ * socket, and the lines are output in the text format, without the syslog
+ * header.
+ *
+ * With -j <threads>, a log file passed on stdin is mapped and parsed by that
+ * many threads (0 = one per CPU). The output is the same as without -j. Other
+ * inputs are read sequentially.
+ *
+ * With -live, the input is read as it comes, typically from a FIFO, and every
+ * second a line reports the request rate, the error ratio and the response
+ * time percentiles over the last 10 and 60 seconds.
  */
 
 #include <errno.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <syslog.h>
 #include <string.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <time.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include <common/eb32tree.h>
+#include <common/eb64tree.h>
+#include <types/log.h>
 
 #define ACCEPT_FIELD 6
+#define SERVER_FIELD 8
 #define TIME_FIELD 9
 #define STATUS_FIELD 10
 #define CONN_FIELD 15
+#define QUEUE_FIELD 16
 #define MAXLINE 16384
 #define QBITS 4
 
 #define SKIP_CHAR(p,c) do { while (1) if (!*p) break; else if (*(p++) == c) break; } while (0)
 
-/* [0] = err/date, [1] = req, [2] = conn, [3] = resp, [4] = data */
-static struct eb_root timers[5] = {
-	EB_ROOT_UNIQUE, EB_ROOT_UNIQUE, EB_ROOT_UNIQUE,
-	EB_ROOT_UNIQUE, EB_ROOT_UNIQUE,
-};
-
 struct timer {
 	struct eb32_node node;
 	unsigned int count;
@@ -63,17 +85,80 @@ struct timer {
 #define FILT_INVERT_ERRORS     0x200
 #define FILT_INVERT_TIME_RESP  0x400
 
+#define FILT_COUNT_URL         0x800
+#define FILT_COUNT_SRV        0x1000
+#define FILT_LIVE             0x2000
+
+/* sort orders of the URLs or servers */
+#define SORT_HITS		0
+#define SORT_TIME		1
+#define SORT_ERRORS		2
+
+/* statistics of a URL or of a server, with -u or -srv. The key is stored
+ * right after the structure.
+ */
+struct key_stat {
+	struct eb32_node node;		/* indexing by hash of the key */
+	struct eb64_node sort;		/* sorting before output */
+	struct eb_root resp;		/* response times (Tr) */
+	unsigned int hits;		/* requests */
+	unsigned int errors;		/* 5xx or no response */
+	unsigned int timed;		/* requests with a response time */
+	unsigned long long total;	/* sum of the response times */
+	int len;			/* key length */
+	char key[0];			/* key, zero-terminated */
+};
+
 unsigned int filter = 0;
 unsigned int filter_invert = 0;
-const char *line;
+int sort_order = SORT_HITS;
+int top_keys = 0;
+int filter_acc_delay = 0, filter_acc_count = 0;
+int filter_time_resp = 0;
+int skip_fields = 1;
 
 const char *fgets2(FILE *stream);
 
+/* With -j, the input is mapped and cut into chunks of about CHUNK_SIZE bytes
+ * at line boundaries. Chunks are parsed by several threads, each of them with
+ * its own timer trees, which are merged at the end. The output of a chunk is
+ * kept in memory until the previous ones are printed, so that lines come out
+ * in the input order, and at most CHUNK_AHEAD chunks per thread are parsed in
+ * advance.
+ */
+#define CHUNK_SIZE	(8 * 1024 * 1024)
+#define CHUNK_AHEAD	4
+#define MAX_THREADS	64
+
+/* output produced while parsing a chunk */
+struct outbuf {
+	char *area;
+	size_t len, size;
+};
+
+struct chunk {
+	struct outbuf out;	/* lines for stdout */
+	struct outbuf err;	/* messages for stderr, see ctx_err() */
+	int lines;		/* number of lines in the chunk */
+	int done;		/* the chunk was parsed */
+};
+
+/* parsing state. When <out> and <err> are NULL, output goes to stdio. */
+struct ctx {
+	struct eb_root timers[5];	/* [0] = err/date, [1] = req, [2] = conn, [3] = resp, [4] = data */
+	struct timer *t;		/* spare timer node */
+	struct eb_root keys;		/* URLs or servers, with -u or -srv */
+	int linenum, tot, parse_err;
+	struct outbuf *out, *err;
+	char *line;			/* line buffer for mapped input */
+};
+
 void die(const char *msg)
 {
 	fprintf(stderr,
 		"%s"
-		"Usage: halog [-c] [-v] [-gt] [-pct] [-s <skip>] [-e|-E] [-rt|-RT <time>] [-ad <delay>] [-ac <count>] < file.log\n"
+		"Usage: halog [-b] [-j <threads>] [-c] [-v] [-gt] [-pct] [-u|-srv [-sort hits|time|err] [-top <n>]]\n"
+		"             [-s <skip>] [-e|-E] [-rt|-RT <time>] [-ad <delay>] [-ac <count>] [-live] < file.log\n"
 		"\n",
 		msg ? msg : ""
 		);
@@ -100,6 +185,51 @@ const char *field_stop(const char *p)
  * contiguous spaces (or tabs) as one delimiter. May return pointer to
  * last char if field is not found. Equivalent to awk '{print $field}'.
  */
+#ifdef __SSE2__
+/* This version checks 16 chars at once. It builds a bitmap of the delimiters
+ * and of the trailing zero, from which the starts of fields are the chars
+ * which follow a delimiter without being one. Loads are aligned so that they
+ * never cross a page boundary, the chars before <p> being ignored.
+ */
+const char *field_start(const char *p, int field)
+{
+	const __m128i spc = _mm_set1_epi8(' ');
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i nil = _mm_setzero_si128();
+	const char *blk = (const char *)((unsigned long)p & ~15UL);
+	unsigned int before = (1U << (p - blk)) - 1;
+	unsigned int prev = 1; /* the char before <p> counts as a delimiter */
+	unsigned int delim, end, start, n;
+	__m128i v;
+
+	while (1) {
+		v = _mm_load_si128((const __m128i *)blk);
+		delim = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, spc),
+						       _mm_cmpeq_epi8(v, tab)));
+		end = _mm_movemask_epi8(_mm_cmpeq_epi8(v, nil)) & ~before;
+		delim |= before;
+
+		start = ~delim & ((delim << 1) | prev) & 0xFFFF;
+		prev = delim >> 15;
+		if (end)
+			start &= (end & -end) - 1;
+
+		n = __builtin_popcount(start);
+		if (n >= field) {
+			while (--field)
+				start &= start - 1;
+			return blk + __builtin_ctz(start);
+		}
+
+		if (end)
+			return blk + __builtin_ctz(end);
+
+		field -= n;
+		blk += 16;
+		before = 0;
+	}
+}
+#else
 const char *field_start(const char *p, int field)
 {
 	unsigned char c;
@@ -132,10 +262,40 @@ const char *field_start(const char *p, int field)
 			if (c == ' ' || c == '\t')
 				break;
 			if (c == '\0')
-				return p;
+				return p - 1;
 		}
 	}
 }
+#endif
+
+/* Parses up to <nb> slash-separated timers starting at <p> into <array>, the
+ * way str2ic() followed by SKIP_CHAR(p, '/') would do for each of them, but
+ * in a single pass. Returns the number of timers found, which is lower than
+ * <nb> if the end of the string was reached first.
+ */
+int parse_timers(const char *p, int *array, int nb)
+{
+	unsigned int j;
+	int f, i, neg;
+
+	for (f = 0; f < nb && *p; f++) {
+		neg = (*p == '-');
+		p += neg;
+		i = 0;
+		while ((j = (unsigned char)*p - '0') <= 9) {
+			i = i * 10 + j;
+			p++;
+		}
+		array[f] = neg ? -i : i;
+
+		/* skip up to and including the next slash */
+		while (*p && *p != '/')
+			p++;
+		if (*p)
+			p++;
+	}
+	return f;
+}
 
 /* keep only the <bits> higher bits of <i> */
 static inline unsigned int quantify_u32(unsigned int i, int bits)
@@ -341,24 +501,1080 @@ int convert_date(const char *field)
 	return -1;
 }
 
-void truncated_line(int linenum, const char *line)
+/* Appends the <len> bytes of <data> to <buf>, or reserves them if <data> is
+ * NULL.
+ */
+void outbuf_put(struct outbuf *buf, const void *data, size_t len)
+{
+	if (buf->len + len > buf->size) {
+		buf->size = (buf->size + len) * 2;
+		buf->area = realloc(buf->area, buf->size);
+		if (unlikely(!buf->area)) {
+			fprintf(stderr, "%s: not enough memory\n", __FUNCTION__);
+			exit(1);
+		}
+	}
+	if (data)
+		memcpy(buf->area + buf->len, data, len);
+	buf->len += len;
+}
+
+/* Outputs <line> on stdout. */
+void ctx_puts(struct ctx *ctx, const char *line)
+{
+	if (!ctx->out) {
+		puts(line);
+		return;
+	}
+	outbuf_put(ctx->out, line, strlen(line));
+	outbuf_put(ctx->out, "\n", 1);
+}
+
+/* Outputs a message on stderr. When it is buffered, it is stored after the
+ * number of the line it refers to within the chunk, or zero, so that the
+ * absolute line number can be reported once the previous chunks are counted.
+ */
+void ctx_err(struct ctx *ctx, int linenum, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	if (!ctx->err) {
+		if (linenum)
+			fprintf(stderr, "Truncated line %d: ", linenum);
+		va_start(args, fmt);
+		vfprintf(stderr, fmt, args);
+		va_end(args);
+		return;
+	}
+
+	va_start(args, fmt);
+	len = vsnprintf(NULL, 0, fmt, args);
+	va_end(args);
+
+	outbuf_put(ctx->err, &linenum, sizeof(linenum));
+	outbuf_put(ctx->err, NULL, len + 1);
+	va_start(args, fmt);
+	vsnprintf(ctx->err->area + ctx->err->len - len - 1, len + 1, fmt, args);
+	va_end(args);
+}
+
+void truncated_line(struct ctx *ctx, const char *line)
 {
 	if (!(filter & FILT_QUIET))
-		fprintf(stderr, "Truncated line %d: %s\n", linenum, line);
+		ctx_err(ctx, ctx->linenum, "%s\n", line);
+}
+
+/* Reads the next binary log record from <stream> into <buf>, which must have
+ * room for BINLOG_MAX_LEN bytes. Returns the record, or NULL at the end of the
+ * input or if an invalid record is found, since it is not possible to find
+ * the next one.
+ */
+const struct binlog_rec *read_binlog(FILE *stream, char *buf)
+{
+	struct binlog_rec *rec = (struct binlog_rec *)buf;
+	int len;
+
+	if (fread(buf, sizeof(rec->len), 1, stream) != 1)
+		return NULL;
+
+	len = ntohs(rec->len);
+	if (len < sizeof(*rec)) {
+		fprintf(stderr, "Invalid binary record length %d\n", len);
+		return NULL;
+	}
+
+	if (fread(buf + sizeof(rec->len), len - sizeof(rec->len), 1, stream) != 1) {
+		fprintf(stderr, "Truncated binary record\n");
+		return NULL;
+	}
+
+	if (rec->version != BINLOG_VERSION) {
+		fprintf(stderr, "Unsupported binary record version %d\n", rec->version);
+		return NULL;
+	}
+	return rec;
+}
+
+/* Fills <array> with the Tq, Tw, Tc, Tr and Tt timers of record <rec>. */
+void binlog_timers(const struct binlog_rec *rec, int *array)
+{
+	array[0] = ntohl(rec->t_request);
+	array[1] = ntohl(rec->t_queue);
+	array[2] = ntohl(rec->t_connect);
+	array[3] = ntohl(rec->t_data);
+	array[4] = ntohl(rec->t_close);
+}
+
+/* Returns the accept date of record <rec> as the time of the day in
+ * milliseconds, like convert_date() does for text logs.
+ */
+int binlog_date(const struct binlog_rec *rec)
+{
+	time_t t = ntohl(rec->accept_sec);
+	struct tm tm;
+
+	localtime_r(&t, &tm);
+	return ((tm.tm_hour * 60 + tm.tm_min) * 60 + tm.tm_sec) * 1000 +
+		ntohl(rec->accept_usec) / 1000;
+}
+
+/* Returns the next string of record <rec> starting at <*pos>, which is then
+ * moved past it, and stores its length into <*len>. Returns NULL if the
+ * string exceeds the record.
+ */
+const char *binlog_next_str(const struct binlog_rec *rec, int *pos, int *len)
+{
+	const char *p = (const char *)rec + *pos;
+	unsigned short nl;
+
+	if (*pos + sizeof(nl) > ntohs(rec->len))
+		return NULL;
+	memcpy(&nl, p, sizeof(nl));
+	*len = ntohs(nl);
+	*pos += sizeof(nl) + *len;
+	if (*pos > ntohs(rec->len))
+		return NULL;
+	return p + sizeof(nl);
+}
+
+/* Writes the <len> chars of <str> at <out>, encoding the control chars and
+ * those from <enc> as '#' followed by their hex code, like haproxy does.
+ * <str> may be NULL, in which case <absent> is written instead. Returns a
+ * pointer to the end of the output.
+ */
+char *binlog_put_str(char *out, const char *str, int len, const char *enc, const char *absent)
+{
+	unsigned char c;
+
+	if (!str || !len)
+		return out + sprintf(out, "%s", absent);
+
+	while (len--) {
+		c = *str++;
+		if (c < 32 || c >= 127 || strchr(enc, c))
+			out += sprintf(out, "#%02X", c);
+		else
+			*out++ = c;
+	}
+	*out = 0;
+	return out;
+}
+
+/* Converts binary record <rec> to the text format of the logs, without the
+ * syslog header. Returns the line, or NULL if the record is invalid.
+ */
+const char *binlog_to_text(const struct binlog_rec *rec)
+{
+	static const char *monthname[12] = {
+		"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+		"Jul", "Aug", "Sep", "Oct", "Nov", "Dec"
+	};
+	static char out[4 * BINLOG_MAX_LEN + 256];
+	const char *str[5];
+	int len[5];
+	char addr[INET6_ADDRSTRLEN];
+	const char *partial, *redisp;
+	unsigned long long bytes;
+	int pos, i, t[5];
+	time_t sec;
+	struct tm tm;
+	char *o = out;
+
+	pos = sizeof(*rec);
+	for (i = 0; i < 5; i++)
+		if (!(str[i] = binlog_next_str(rec, &pos, &len[i])))
+			return NULL;
+
+	inet_ntop((rec->flags & BINLOG_F_IPV6) ? AF_INET6 : AF_INET, rec->cli_addr, addr, sizeof(addr));
+	sec = ntohl(rec->accept_sec);
+	localtime_r(&sec, &tm);
+	binlog_timers(rec, t);
+	bytes = ((unsigned long long)ntohl(rec->bytes_hi) << 32) + ntohl(rec->bytes_lo);
+	partial = (rec->flags & BINLOG_F_PARTIAL) ? "+" : "";
+	redisp = (rec->flags & BINLOG_F_REDISP) ? "+" : "";
+
+	o += sprintf(o, "%s:%d [%02d/%s/%04d:%02d:%02d:%02d.%03d] %.*s %.*s/%.*s ",
+		     addr, ntohs(rec->cli_port),
+		     tm.tm_mday, monthname[tm.tm_mon], tm.tm_year + 1900,
+		     tm.tm_hour, tm.tm_min, tm.tm_sec, ntohl(rec->accept_usec) / 1000,
+		     len[0], str[0], len[1], str[1], len[2], str[2]);
+
+	if (rec->type == BINLOG_HTTP) {
+		o += sprintf(o, "%d/%d/%d/%d/%s%d %d %s%llu ",
+			     t[0], t[1], t[2], t[3], partial, t[4],
+			     ntohs(rec->status), partial, bytes);
+		o = binlog_put_str(o, str[3], len[3], "", "-");
+		*o++ = ' ';
+		o = binlog_put_str(o, str[4], len[4], "", "-");
+		o += sprintf(o, " %c%c%c%c ", rec->term_cond, rec->fin_state, rec->cli_ck, rec->srv_ck);
+	}
+	else {
+		o += sprintf(o, "%d/%d/%s%d %s%llu %c%c ",
+			     t[1], t[2], partial, t[4], partial, bytes,
+			     rec->term_cond, rec->fin_state);
+	}
+
+	o += sprintf(o, "%u/%u/%u/%u/%s%u %u/%u",
+		     ntohl(rec->actconn), ntohl(rec->feconn), ntohl(rec->beconn),
+		     ntohl(rec->srv_conn), redisp, ntohs(rec->retries),
+		     ntohl(rec->srv_queue), ntohl(rec->prx_queue));
+
+	if (rec->type != BINLOG_HTTP)
+		return out;
+
+	for (i = 0; i < rec->nb_req_cap + rec->nb_rsp_cap; i++) {
+		if (i == 0 || i == rec->nb_req_cap)
+			o += sprintf(o, " {");
+		else
+			*o++ = '|';
+		if (!(str[0] = binlog_next_str(rec, &pos, &len[0])))
+			return NULL;
+		o = binlog_put_str(o, str[0], len[0], "\"#{|}", "");
+		if (i == rec->nb_req_cap - 1 || i == rec->nb_req_cap + rec->nb_rsp_cap - 1)
+			*o++ = '}';
+	}
+
+	if (!(str[0] = binlog_next_str(rec, &pos, &len[0])))
+		return NULL;
+	o += sprintf(o, " \"");
+	o = binlog_put_str(o, str[0], len[0], "\"#", "");
+	sprintf(o, "\"");
+	return out;
+}
+
+/* Returns a hash of the <len> bytes of <key>. */
+static inline unsigned int hash_key(const char *key, int len)
+{
+	unsigned int hash = 0;
+
+	while (len--)
+		hash = (unsigned char)*key++ + (hash << 6) + (hash << 16) - hash;
+	return hash;
+}
+
+/* Returns the statistics of the <len> bytes of <key> in tree <root>, or NULL
+ * if there are none.
+ */
+struct key_stat *find_key(struct eb_root *root, const char *key, int len, unsigned int hash)
+{
+	struct eb32_node *node;
+	struct key_stat *st;
+
+	for (node = eb32_lookup(root, hash); node && node->key == hash; node = eb32_next(node)) {
+		st = container_of(node, struct key_stat, node);
+		if (st->len == len && memcmp(st->key, key, len) == 0)
+			return st;
+	}
+	return NULL;
+}
+
+/* Returns the statistics of the <len> bytes of <key> in tree <root>, which
+ * are created if needed.
+ */
+struct key_stat *get_key(struct eb_root *root, const char *key, int len)
+{
+	unsigned int hash = hash_key(key, len);
+	struct key_stat *st;
+
+	st = find_key(root, key, len, hash);
+	if (st)
+		return st;
+
+	st = calloc(1, sizeof(*st) + len + 1);
+	if (unlikely(!st)) {
+		fprintf(stderr, "%s: not enough memory\n", __FUNCTION__);
+		exit(1);
+	}
+	st->resp = (struct eb_root)EB_ROOT_UNIQUE;
+	st->len = len;
+	memcpy(st->key, key, len);
+	st->node.key = hash;
+	eb32_insert(root, &st->node);
+	return st;
+}
+
+/* Returns the URL of request <req>, which starts with the method, and stores
+ * its length into <len>. The URL stops before the query string or the path
+ * parameters. Requests without a URL, such as "<BADREQ>", are returned as a
+ * whole.
+ */
+const char *request_url(const char *req, int len, int *url_len)
+{
+	const char *end = req + len;
+	const char *b, *e;
+
+	for (b = req; b < end && *b != ' '; b++);
+	if (b == end) {
+		*url_len = len;
+		return req;
+	}
+	while (b < end && *b == ' ')
+		b++;
+	for (e = b; e < end && *e != ' ' && *e != '?' && *e != ';'; e++);
+	*url_len = e - b;
+	return b;
+}
+
+/* Accounts for the request of <line>, or of the binary record <rec> if it is
+ * not NULL, in the statistics of its URL (-u) or of its server (-srv). Errors
+ * are requests with a 5xx status or without a response (Tr = -1).
+ */
+void count_key(struct ctx *ctx, const char *line, const struct binlog_rec *rec)
+{
+	char srv[1024];
+	struct key_stat *st;
+	const char *b, *e, *key;
+	int array[5];
+	int status, len;
+
+	if (rec) {
+		const char *str;
+		int pos = sizeof(*rec), i, l;
+
+		binlog_timers(rec, array);
+		status = ntohs(rec->status);
+
+		/* strings : frontend, backend, server, 2 cookies, captures, URI */
+		len = 0;
+		for (i = 0; i < 5 + rec->nb_req_cap + rec->nb_rsp_cap + 1; i++) {
+			if (!(str = binlog_next_str(rec, &pos, &l))) {
+				ctx->parse_err++;
+				return;
+			}
+			if ((filter & FILT_COUNT_SRV) && (i == 1 || i == 2)) {
+				if (l > sizeof(srv) / 2 - 1)
+					l = sizeof(srv) / 2 - 1;
+				memcpy(srv + len, str, l);
+				len += l;
+				if (i == 1)
+					srv[len++] = '/';
+			}
+		}
+		key = srv;
+		if (filter & FILT_COUNT_URL)
+			key = request_url(str, l, &len);
+	}
+	else {
+		b = field_start(line, SERVER_FIELD + skip_fields);
+		if (!*b) {
+			truncated_line(ctx, line);
+			return;
+		}
+		key = b;
+		len = field_stop(b) - b;
+
+		b = field_start(b, TIME_FIELD - SERVER_FIELD + 1);
+		if (!*b) {
+			truncated_line(ctx, line);
+			return;
+		}
+		if (parse_timers(b, array, 5) < 5) {
+			ctx->parse_err++;
+			return;
+		}
+
+		b = field_start(b, STATUS_FIELD - TIME_FIELD + 1);
+		if (!*b) {
+			truncated_line(ctx, line);
+			return;
+		}
+		status = str2ic(b);
+
+		if (filter & FILT_COUNT_URL) {
+			/* the request is the first quoted string after the
+			 * queues, since quotes are encoded in the captures.
+			 */
+			b = field_start(b, QUEUE_FIELD - STATUS_FIELD + 1);
+			if (!*b || !(b = strchr(b, '"'))) {
+				truncated_line(ctx, line);
+				return;
+			}
+			b++;
+			e = strchr(b, '"');
+			if (!e)
+				e = b + strlen(b);
+			key = request_url(b, e - b, &len);
+		}
+	}
+
+	st = get_key(&ctx->keys, key, len);
+	st->hits++;
+	if (status >= 500 || array[3] < 0)
+		st->errors++;
+	if (array[3] >= 0) {
+		st->timed++;
+		st->total += array[3];
+		insert_value(&st->resp, &ctx->t, array[3])->count++;
+	}
+	ctx->tot++;
+}
+
+/* With -live, requests are accounted in one slot per second of a ring covering
+ * the longest window. Each slot holds a histogram of the response times, in
+ * which values keep their QBITS higher bits like with -gt, so that memory does
+ * not depend on the traffic and slots are simply reset when reused.
+ */
+#define LIVE_SLOTS	60
+#define LIVE_SHORT	10
+#define LIVE_BINS	(((32 - QBITS) << (QBITS - 1)) + (1 << QBITS))
+#define LIVE_BUFSIZE	(4 * MAXLINE)
+
+struct live_slot {
+	time_t sec;			/* second accounted in this slot */
+	unsigned int req, err;		/* requests and errors (5xx or Tr=-1) */
+	unsigned int timed;		/* requests with a response time */
+	unsigned int bins[LIVE_BINS];	/* response times histogram */
+};
+
+static struct live_slot live_slots[LIVE_SLOTS];
+static time_t live_now;		/* current second */
+
+/* returns the histogram bin of response time <v> */
+static inline int live_bin(unsigned int v)
+{
+	int h;
+
+	if (v < (1 << QBITS))
+		return v;
+	h = fls_auto(v) - QBITS;	// 1 to 32 - QBITS
+	return (h << (QBITS - 1)) + (v >> h);
+}
+
+/* returns the lowest response time of histogram bin <b> */
+static inline unsigned int live_bin_value(int b)
+{
+	if (b < (1 << QBITS))
+		return b;
+	return ((b & ((1 << (QBITS - 1)) - 1)) | (1 << (QBITS - 1))) <<
+		((b >> (QBITS - 1)) - 1);
+}
+
+/* Accounts for the line <line> in the slot of the current second. */
+void count_live(struct ctx *ctx, const char *line)
+{
+	struct live_slot *slot;
+	const char *b;
+	int array[5];
+	int status;
+
+	b = field_start(line, TIME_FIELD + skip_fields);
+	if (!*b) {
+		truncated_line(ctx, line);
+		return;
+	}
+	if (parse_timers(b, array, 4) < 4) {
+		ctx->parse_err++;
+		return;
+	}
+
+	b = field_start(b, STATUS_FIELD - TIME_FIELD + 1);
+	if (!*b) {
+		truncated_line(ctx, line);
+		return;
+	}
+	status = str2ic(b);
+
+	slot = &live_slots[live_now % LIVE_SLOTS];
+	if (slot->sec != live_now) {
+		memset(slot, 0, sizeof(*slot));
+		slot->sec = live_now;
+	}
+
+	slot->req++;
+	if (status >= 500 || array[3] < 0)
+		slot->err++;
+	if (array[3] >= 0) {
+		slot->timed++;
+		slot->bins[live_bin(array[3])]++;
+	}
+	ctx->tot++;
+}
+
+/* Accounts for the line <line>, or for the binary record <rec> if it is not
+ * NULL, according to the filters.
+ */
+void process_line(struct ctx *ctx, const char *line, const struct binlog_rec *rec)
+{
+	const char *b;
+	struct timer *t2;
+	int f, err, val, test;
+	int array[5];
+
+	ctx->linenum++;
+
+	test = 1;
+	if (filter & FILT_TIME_RESP) {
+		int tps;
+
+		/* only report lines with response times larger than filter_time_resp */
+		if (rec) {
+			binlog_timers(rec, array);
+			tps = array[3];
+			goto test_time_resp;
+		}
+
+		b = field_start(line, TIME_FIELD + skip_fields);
+		if (!*b) {
+			truncated_line(ctx, line);
+			return;
+		}
+
+		if (parse_timers(b, array, 4) < 4) {
+			ctx->parse_err++;
+			return;
+		}
+		tps = array[3];
+		if (tps < 0)
+			tps = -1;
+	test_time_resp:
+		test &= (tps >= filter_time_resp) ^ !!(filter & FILT_INVERT_TIME_RESP);
+	}
+
+	if (filter & FILT_ERRORS_ONLY) {
+		/* only report erroneous status codes */
+		if (rec) {
+			val = ntohs(rec->status);
+			if (!val)
+				test &= !!(filter & FILT_INVERT_ERRORS);
+			else
+				test &= (val >= 500 && val <= 599) ^ !!(filter & FILT_INVERT_ERRORS);
+		}
+		else {
+			b = field_start(line, STATUS_FIELD + skip_fields);
+			if (!*b) {
+				truncated_line(ctx, line);
+				return;
+			}
+			if (*b == '-') {
+				test &= !!(filter & FILT_INVERT_ERRORS);
+			} else {
+				val = strl2ui(b, 3);
+				test &= (val >= 500 && val <= 599) ^ !!(filter & FILT_INVERT_ERRORS);
+			}
+		}
+	}
+
+	if (filter & (FILT_ACC_COUNT|FILT_ACC_DELAY)) {
+		if (rec)
+			val = binlog_date(rec);
+		else {
+			b = field_start(line, ACCEPT_FIELD + skip_fields);
+			if (!*b) {
+				truncated_line(ctx, line);
+				return;
+			}
+			val = convert_date(b);
+		}
+
+		ctx->tot++;
+		//printf("date=%s => %d\n", b, val);
+		if (val < 0) {
+			ctx->parse_err++;
+			return;
+		}
+
+		t2 = insert_value(&ctx->timers[0], &ctx->t, val);
+		t2->count++;
+		return;
+	}
+
+	if (filter & (FILT_GRAPH_TIMERS|FILT_PERCENTILE)) {
+		struct timer *(*insert)(struct eb_root *, struct timer **, int);
+
+		if (rec)
+			binlog_timers(rec, array);
+		else {
+			b = field_start(line, TIME_FIELD + skip_fields);
+			if (!*b) {
+				truncated_line(ctx, line);
+				return;
+			}
+
+			if (parse_timers(b, array, 5) < 5) {
+				ctx->parse_err++;
+				return;
+			}
+		}
+
+		err = 0;
+		for (f = 0; f < 5; f++) {
+			if (array[f] < 0) {
+				array[f] = -1;
+				err = 1;
+			}
+		}
+
+		/* if we find at least one negative time, we count one error
+		 * with a time equal to the total session time. This will
+		 * emphasize quantum timing effects associated to known
+		 * timeouts. Note that on some buggy machines, it is possible
+		 * that the total time is negative, hence the reason to reset
+		 * it. Timers are quantified for graphs, but not for percentiles.
+		 */
+		insert = (filter & FILT_GRAPH_TIMERS) ? insert_timer : insert_value;
+
+		if (err) {
+			if (array[4] < 0)
+				array[4] = -1;
+			t2 = insert(&ctx->timers[0], &ctx->t, array[4]);  // total time
+			t2->count++;
+		} else {
+			int v;
+
+			t2 = insert(&ctx->timers[1], &ctx->t, array[0]); t2->count++;  // req
+			t2 = insert(&ctx->timers[2], &ctx->t, array[2]); t2->count++;  // conn
+			t2 = insert(&ctx->timers[3], &ctx->t, array[3]); t2->count++;  // resp
+
+			v = array[4] - array[0] - array[1] - array[2] - array[3]; // data time
+			if (v < 0 && !(filter & FILT_QUIET))
+				ctx_err(ctx, 0, "ERR: %s (%d %d %d %d %d => %d)\n",
+					rec ? binlog_to_text(rec) : line,
+					array[0], array[1], array[2], array[3], array[4], v);
+			t2 = insert(&ctx->timers[4], &ctx->t, v); t2->count++;
+			ctx->tot++;
+		}
+		return;
+	}
+
+	test ^= filter_invert;
+	if (!test)
+		return;
+
+	if (filter & (FILT_COUNT_URL|FILT_COUNT_SRV)) {
+		count_key(ctx, line, rec);
+		return;
+	}
+
+	if (filter & FILT_LIVE) {
+		count_live(ctx, line);
+		return;
+	}
+
+	/* all other cases mean we just want to count lines */
+	if (rec && !(filter & FILT_COUNT_ONLY)) {
+		line = binlog_to_text(rec);
+		if (!line) {
+			ctx->parse_err++;
+			return;
+		}
+	}
+
+	ctx->tot++;
+	if (!(filter & FILT_COUNT_ONLY))
+		ctx_puts(ctx, line);
+}
+
+/* Moves all the timers of tree <src> to tree <dst>, adding up the counts of
+ * the timers already present there.
+ */
+void merge_timers(struct eb_root *dst, struct eb_root *src)
+{
+	struct eb32_node *n, *next, *old;
+
+	for (n = eb32_first(src); n; n = next) {
+		next = eb32_next(n);
+		eb32_delete(n);
+		old = eb32i_insert(dst, n);
+		if (old != n) {
+			container_of(old, struct timer, node)->count +=
+				container_of(n, struct timer, node)->count;
+			free(container_of(n, struct timer, node));
+		}
+	}
+}
+
+/* Moves all the statistics of tree <src> to tree <dst>, adding them up to
+ * those of the same keys already present there.
+ */
+void merge_keys(struct eb_root *dst, struct eb_root *src)
+{
+	struct eb32_node *n, *next;
+	struct key_stat *st, *old;
+
+	for (n = eb32_first(src); n; n = next) {
+		next = eb32_next(n);
+		eb32_delete(n);
+		st = container_of(n, struct key_stat, node);
+		old = find_key(dst, st->key, st->len, n->key);
+		if (!old) {
+			eb32_insert(dst, n);
+			continue;
+		}
+		old->hits += st->hits;
+		old->errors += st->errors;
+		old->timed += st->timed;
+		old->total += st->total;
+		merge_timers(&old->resp, &st->resp);
+		free(st);
+	}
+}
+
+/* Returns the smallest response time of <st> above which there are less than
+ * <pct> percent of its requests, or -1 if none has a response time.
+ */
+int key_percentile(struct key_stat *st, int pct)
+{
+	struct eb32_node *n;
+	unsigned long long cum = 0;
+	unsigned long long thres = ((unsigned long long)st->timed * pct + 99) / 100;
+
+	for (n = eb32_first(&st->resp); n; n = eb32_next(n)) {
+		cum += container_of(n, struct timer, node)->count;
+		if (cum >= thres)
+			return n->key;
+	}
+	return -1;
+}
+
+/* Prints the statistics of all the keys of tree <root>, sorted by decreasing
+ * order of <sort_order>, limited to the first <top_keys> ones if not zero.
+ * Returns the number of lines printed.
+ */
+int print_keys(struct eb_root *root)
+{
+	struct eb_root sorted = EB_ROOT;
+	struct eb32_node *n;
+	struct eb64_node *s;
+	struct key_stat *st;
+	int lines = 0;
+
+	for (n = eb32_first(root); n; n = eb32_next(n)) {
+		st = container_of(n, struct key_stat, node);
+		switch (sort_order) {
+		case SORT_TIME:   st->sort.key = ~st->total; break;
+		case SORT_ERRORS: st->sort.key = ~(u64)st->errors; break;
+		default:          st->sort.key = ~(u64)st->hits; break;
+		}
+		eb64_insert(&sorted, &st->sort);
+	}
+
+	printf("#req err ttot tavg t50 t90 t99 %s\n",
+	       (filter & FILT_COUNT_URL) ? "url" : "server");
+
+	for (s = eb64_first(&sorted); s; s = eb64_next(s)) {
+		if (top_keys && lines >= top_keys)
+			break;
+		st = container_of(s, struct key_stat, sort);
+		printf("%u %u %llu %d %d %d %d %s\n",
+		       st->hits, st->errors, st->total,
+		       st->timed ? (int)(st->total / st->timed) : -1,
+		       key_percentile(st, 50), key_percentile(st, 90),
+		       key_percentile(st, 99), st->key);
+		lines++;
+	}
+	return lines;
+}
+
+/* Prints the rate, error ratio and response time percentiles over the last
+ * <secs> seconds up to and including second <now>.
+ */
+void print_live_window(time_t now, int secs)
+{
+	static unsigned int bins[LIVE_BINS];
+	unsigned long long req = 0, err = 0, timed = 0, cum, thres;
+	const struct live_slot *slot;
+	int s, b, p;
+	static const int pct[3] = { 50, 90, 99 };
+
+	memset(bins, 0, sizeof(bins));
+	for (s = 0; s < secs; s++) {
+		slot = &live_slots[(now - s) % LIVE_SLOTS];
+		if (slot->sec != now - s)
+			continue;
+		req += slot->req;
+		err += slot->err;
+		timed += slot->timed;
+		for (b = 0; b < LIVE_BINS; b++)
+			bins[b] += slot->bins[b];
+	}
+
+	printf(" %.1f %.2f", (double)req / secs, req ? err * 100.0 / req : 0.0);
+
+	for (p = 0, b = 0, cum = 0; p < 3; p++) {
+		if (!timed) {
+			printf(" -1");
+			continue;
+		}
+		thres = (timed * pct[p] + 99) / 100;
+		while (cum + bins[b] < thres)
+			cum += bins[b++];
+		printf(" %u", live_bin_value(b));
+	}
+}
+
+/* Prints the report line of second <now>. */
+void print_live(time_t now)
+{
+	printf("%ld", (long)now);
+	print_live_window(now, LIVE_SHORT);
+	print_live_window(now, LIVE_SLOTS);
+	putchar('\n');
+	fflush(stdout);
+}
+
+/* Reads the lines from stdin as they come, and reports the last windows once
+ * per second, including when no line arrives, until the end of the input.
+ */
+void parse_live(struct ctx *ctx)
+{
+	static char buf[LIVE_BUFSIZE + 1];
+	struct pollfd pfd = { .fd = 0, .events = POLLIN };
+	struct timeval tv;
+	time_t last, now;
+	size_t len = 0;
+	char *line, *end;
+	ssize_t ret;
+	int eof = 0, skip = 0;
+
+	printf("#time rate%d err%d t50 t90 t99 rate%d err%d t50 t90 t99\n",
+	       LIVE_SHORT, LIVE_SHORT, LIVE_SLOTS, LIVE_SLOTS);
+
+	gettimeofday(&tv, NULL);
+	last = now = tv.tv_sec;
+
+	while (!eof) {
+		ret = poll(&pfd, 1, 1000 - tv.tv_usec / 1000);
+		gettimeofday(&tv, NULL);
+		now = live_now = tv.tv_sec;
+
+		/* report the seconds which are over before accounting the new lines */
+		for (; last < now; last++)
+			print_live(last);
+
+		if (ret <= 0)
+			continue;
+
+		ret = read(0, buf + len, LIVE_BUFSIZE - len);
+		if (ret < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			perror("read");
+			ret = 0;
+		}
+		if (ret == 0) {
+			/* account an unterminated last line */
+			eof = 1;
+			if (len)
+				buf[len++] = '\n';
+		}
+		len += ret;
+
+		for (line = buf; (end = memchr(line, '\n', buf + len - line)); line = end + 1) {
+			*end = 0;
+			if (skip)
+				skip = 0;
+			else
+				process_line(ctx, line, NULL);
+		}
+
+		len -= line - buf;
+		memmove(buf, line, len);
+		if (len == LIVE_BUFSIZE) {
+			/* too long line, only its beginning is accounted */
+			buf[len] = 0;
+			if (!skip)
+				process_line(ctx, buf, NULL);
+			skip = 1;
+			len = 0;
+		}
+	}
+	print_live(now);
+}
+
+/* mapped input, shared by all threads */
+static const char *map_area;
+static size_t map_size;
+static struct chunk *chunks;
+static int nb_chunks, next_chunk, printed_chunks, chunks_ahead;
+static pthread_mutex_t chunk_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t chunk_cond = PTHREAD_COND_INITIALIZER;
+
+/* Returns the first line of the mapped input which starts at or after <pos>. */
+const char *line_at(size_t pos)
+{
+	const char *p;
+
+	if (pos == 0)
+		return map_area;
+	if (pos >= map_size)
+		return map_area + map_size;
+	p = memchr(map_area + pos - 1, '\n', map_size - pos + 1);
+	return p ? p + 1 : map_area + map_size;
+}
+
+/* Parses all the lines of chunk <c> of the mapped input, which are the lines
+ * starting within its CHUNK_SIZE bytes. Lines are copied to the context's
+ * buffer so that they are zero-terminated, those longer than the buffer being
+ * cut.
+ */
+void parse_chunk(struct ctx *ctx, int c)
+{
+	const char *p = line_at((size_t)c * CHUNK_SIZE);
+	const char *end = line_at((size_t)(c + 1) * CHUNK_SIZE);
+	const char *e;
+	size_t len;
+
+	ctx->out = &chunks[c].out;
+	ctx->err = &chunks[c].err;
+	ctx->linenum = 0;
+
+	while (p < end) {
+		e = memchr(p, '\n', end - p);
+		if (!e)
+			e = end;
+		len = e - p;
+		if (len > MAXLINE - 1)
+			len = MAXLINE - 1;
+		memcpy(ctx->line, p, len);
+		ctx->line[len] = '\0';
+		process_line(ctx, ctx->line, NULL);
+		p = e + 1;
+	}
+	chunks[c].lines = ctx->linenum;
+}
+
+/* Parsing thread : takes the next chunk as long as it is not too far ahead of
+ * the printed ones.
+ */
+void *chunk_worker(void *arg)
+{
+	struct ctx *ctx = arg;
+	int c;
+
+	while (1) {
+		pthread_mutex_lock(&chunk_lock);
+		while (next_chunk < nb_chunks && next_chunk >= printed_chunks + chunks_ahead)
+			pthread_cond_wait(&chunk_cond, &chunk_lock);
+		c = next_chunk++;
+		pthread_mutex_unlock(&chunk_lock);
+
+		if (c >= nb_chunks)
+			return NULL;
+
+		parse_chunk(ctx, c);
+
+		pthread_mutex_lock(&chunk_lock);
+		chunks[c].done = 1;
+		pthread_cond_broadcast(&chunk_cond);
+		pthread_mutex_unlock(&chunk_lock);
+	}
+}
+
+/* Prints the output of chunk <c> once it is parsed, then releases it. Line
+ * numbers of the messages are shifted by <linenum>, the number of lines of the
+ * previous chunks.
+ */
+void print_chunk(int c, int linenum)
+{
+	struct chunk *chk = &chunks[c];
+	const char *p;
+	int num;
+
+	pthread_mutex_lock(&chunk_lock);
+	while (!chk->done)
+		pthread_cond_wait(&chunk_cond, &chunk_lock);
+	pthread_mutex_unlock(&chunk_lock);
+
+	fwrite(chk->out.area, 1, chk->out.len, stdout);
+	for (p = chk->err.area; p < chk->err.area + chk->err.len; p += strlen(p) + 1) {
+		memcpy(&num, p, sizeof(num));
+		p += sizeof(num);
+		if (num)
+			fprintf(stderr, "Truncated line %d: ", linenum + num);
+		fputs(p, stderr);
+	}
+	free(chk->out.area);
+	free(chk->err.area);
+
+	pthread_mutex_lock(&chunk_lock);
+	printed_chunks++;
+	pthread_cond_broadcast(&chunk_cond);
+	pthread_mutex_unlock(&chunk_lock);
+}
+
+/* Parses the whole input with <nbthr> threads, and merges their results into
+ * <ctx>. Returns 0 if the input cannot be mapped, in which case nothing was
+ * done.
+ */
+int parse_mapped(struct ctx *ctx, int nbthr)
+{
+	static struct ctx thr_ctx[MAX_THREADS];
+	pthread_t thr[MAX_THREADS];
+	struct stat st;
+	void *area;
+	int c, f, i;
+
+	if (fstat(0, &st) == -1 || !S_ISREG(st.st_mode) || st.st_size == 0 ||
+	    (off_t)(size_t)st.st_size != st.st_size)
+		return 0;
+
+	area = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, 0, 0);
+	if (area == MAP_FAILED)
+		return 0;
+
+	map_area = area;
+	map_size = st.st_size;
+	nb_chunks = (map_size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+	chunks_ahead = nbthr * CHUNK_AHEAD;
+	chunks = calloc(nb_chunks, sizeof(*chunks));
+	if (!chunks) {
+		fprintf(stderr, "%s: not enough memory\n", __FUNCTION__);
+		exit(1);
+	}
+
+	for (i = 0; i < nbthr; i++) {
+		for (f = 0; f < 5; f++)
+			thr_ctx[i].timers[f] = (struct eb_root)EB_ROOT_UNIQUE;
+		thr_ctx[i].keys = (struct eb_root)EB_ROOT;
+		thr_ctx[i].line = malloc(MAXLINE);
+		if (!thr_ctx[i].line ||
+		    pthread_create(&thr[i], NULL, chunk_worker, &thr_ctx[i]) != 0) {
+			fprintf(stderr, "%s: cannot start thread\n", __FUNCTION__);
+			exit(1);
+		}
+	}
+
+	for (c = 0; c < nb_chunks; c++) {
+		print_chunk(c, ctx->linenum);
+		ctx->linenum += chunks[c].lines;
+	}
+
+	for (i = 0; i < nbthr; i++) {
+		pthread_join(thr[i], NULL);
+		for (f = 0; f < 5; f++)
+			merge_timers(&ctx->timers[f], &thr_ctx[i].timers[f]);
+		merge_keys(&ctx->keys, &thr_ctx[i].keys);
+		ctx->tot += thr_ctx[i].tot;
+		ctx->parse_err += thr_ctx[i].parse_err;
+		free(thr_ctx[i].t);
+		free(thr_ctx[i].line);
+	}
+
+	free(chunks);
+	munmap(area, map_size);
+	return 1;
 }
 
 int main(int argc, char **argv)
 {
-	const char *b, *e, *p;
 	const char *output_file = NULL;
-	int f, tot, last, linenum, err, parse_err;
-	struct timer *t = NULL, *t2;
+	int f, tot, last, linenum, parse_err;
+	struct timer *t = NULL;
 	struct eb32_node *n;
-	int val, test;
-	int array[5];
-	int filter_acc_delay = 0, filter_acc_count = 0;
-	int filter_time_resp = 0;
-	int skip_fields = 1;
+	int binary = 0;
+	int nbthr = 1;
+	const struct binlog_rec *rec;
+	const char *line;
+	struct eb_root *timers;
+	static char recbuf[BINLOG_MAX_LEN];
+	static struct ctx ctx = {
+		.timers = {
+			EB_ROOT_UNIQUE, EB_ROOT_UNIQUE, EB_ROOT_UNIQUE,
+			EB_ROOT_UNIQUE, EB_ROOT_UNIQUE,
+		},
+		.keys = EB_ROOT,
+	};
 
 	argc--; argv++;
 	while (argc > 0) {
@@ -394,6 +1610,42 @@ int main(int argc, char **argv)
 			argc--; argv++;
 			skip_fields = atol(*argv);
 		}
+		else if (strcmp(argv[0], "-j") == 0) {
+			if (argc < 2) die("missing option for -j");
+			argc--; argv++;
+			nbthr = atol(*argv);
+			if (nbthr <= 0)
+				nbthr = sysconf(_SC_NPROCESSORS_ONLN);
+			if (nbthr <= 0)
+				nbthr = 1;
+			if (nbthr > MAX_THREADS)
+				nbthr = MAX_THREADS;
+		}
+		else if (strcmp(argv[0], "-sort") == 0) {
+			if (argc < 2) die("missing option for -sort");
+			argc--; argv++;
+			if (strcmp(*argv, "hits") == 0)
+				sort_order = SORT_HITS;
+			else if (strcmp(*argv, "time") == 0)
+				sort_order = SORT_TIME;
+			else if (strcmp(*argv, "err") == 0)
+				sort_order = SORT_ERRORS;
+			else
+				die("-sort expects 'hits', 'time' or 'err'\n");
+		}
+		else if (strcmp(argv[0], "-top") == 0) {
+			if (argc < 2) die("missing option for -top");
+			argc--; argv++;
+			top_keys = atol(*argv);
+		}
+		else if (strcmp(argv[0], "-u") == 0)
+			filter |= FILT_COUNT_URL;
+		else if (strcmp(argv[0], "-srv") == 0)
+			filter |= FILT_COUNT_SRV;
+		else if (strcmp(argv[0], "-live") == 0)
+			filter |= FILT_LIVE;
+		else if (strcmp(argv[0], "-b") == 0)
+			binary = 1;
 		else if (strcmp(argv[0], "-e") == 0)
 			filter |= FILT_ERRORS_ONLY;
 		else if (strcmp(argv[0], "-E") == 0)
@@ -422,179 +1674,40 @@ int main(int argc, char **argv)
 	if (!filter)
 		die("No action specified.\n");
 
+	if ((filter & FILT_COUNT_URL) && (filter & FILT_COUNT_SRV))
+		die("-u and -srv cannot be used together.\n");
+
+	if ((filter & FILT_LIVE) &&
+	    (binary || (filter & (FILT_COUNT_ONLY|FILT_COUNT_URL|FILT_COUNT_SRV|FILT_GRAPH_TIMERS|
+				  FILT_PERCENTILE|FILT_ACC_COUNT|FILT_ACC_DELAY))))
+		die("-live only supports text logs and the -e, -E, -rt, -RT and -v filters.\n");
+
 	if (filter & FILT_ACC_COUNT && !filter_acc_count)
 		filter_acc_count=1;
 
 	if (filter & FILT_ACC_DELAY && !filter_acc_delay)
 		filter_acc_delay = 1;
 
-	linenum = 0;
-	tot = 0;
-	parse_err = 0;
-
-	while ((line = fgets2(stdin)) != NULL) {
-		linenum++;
-
-		test = 1;
-		if (filter & FILT_TIME_RESP) {
-			int tps;
-
-			/* only report lines with response times larger than filter_time_resp */
-			b = field_start(line, TIME_FIELD + skip_fields);
-			if (!*b) {
-				truncated_line(linenum, line);
-				continue;
-			}
-
-			e = field_stop(b + 1);
-			/* we have field TIME_FIELD in [b]..[e-1] */
-
-			p = b;
-			err = 0;
-			for (f = 0; f < 4 && *p; f++) {
-				tps = str2ic(p);
-				if (tps < 0) {
-					tps = -1;
-					err = 1;
-				}
-
-				SKIP_CHAR(p, '/');
-			}
-
-			if (f < 4) {
-				parse_err++;
-				continue;
-			}
-
-			test &= (tps >= filter_time_resp) ^ !!(filter & FILT_INVERT_TIME_RESP);
-		}
-
-		if (filter & FILT_ERRORS_ONLY) {
-			/* only report erroneous status codes */
-			b = field_start(line, STATUS_FIELD + skip_fields);
-			if (!*b) {
-				truncated_line(linenum, line);
-				continue;
-			}
-			if (*b == '-') {
-				test &= !!(filter & FILT_INVERT_ERRORS);
-			} else {
-				val = strl2ui(b, 3);
-				test &= (val >= 500 && val <= 599) ^ !!(filter & FILT_INVERT_ERRORS);
-			}
+	/* binary records and unmappable inputs are read sequentially */
+	if (filter & FILT_LIVE)
+		parse_live(&ctx);
+	else if (binary || nbthr < 2 || !parse_mapped(&ctx, nbthr)) {
+		if (binary) {
+			while ((rec = read_binlog(stdin, recbuf)) != NULL)
+				process_line(&ctx, NULL, rec);
 		}
-
-		if (filter & (FILT_ACC_COUNT|FILT_ACC_DELAY)) {
-			b = field_start(line, ACCEPT_FIELD + skip_fields);
-			if (!*b) {
-				truncated_line(linenum, line);
-				continue;
-			}
-
-			tot++;
-			val = convert_date(b);
-			//printf("date=%s => %d\n", b, val);
-			if (val < 0) {
-				parse_err++;
-				continue;
-			}
-
-			t2 = insert_value(&timers[0], &t, val);
-			t2->count++;
-			continue;
+		else {
+			while ((line = fgets2(stdin)) != NULL)
+				process_line(&ctx, line, NULL);
 		}
-
-		if (filter & (FILT_GRAPH_TIMERS|FILT_PERCENTILE)) {
-			int f;
-
-			b = field_start(line, TIME_FIELD + skip_fields);
-			if (!*b) {
-				truncated_line(linenum, line);
-				continue;
-			}
-
-			e = field_stop(b + 1);
-			/* we have field TIME_FIELD in [b]..[e-1] */
-
-			p = b;
-			err = 0;
-			for (f = 0; f < 5 && *p; f++) {
-				array[f] = str2ic(p);
-				if (array[f] < 0) {
-					array[f] = -1;
-					err = 1;
-				}
-
-				SKIP_CHAR(p, '/');
-			}
-
-			if (f < 5) {
-				parse_err++;
-				continue;
-			}
-
-			/* if we find at least one negative time, we count one error
-			 * with a time equal to the total session time. This will
-			 * emphasize quantum timing effects associated to known
-			 * timeouts. Note that on some buggy machines, it is possible
-			 * that the total time is negative, hence the reason to reset
-			 * it.
-			 */
-
-			if (filter & FILT_GRAPH_TIMERS) {
-				if (err) {
-					if (array[4] < 0)
-						array[4] = -1;
-					t2 = insert_timer(&timers[0], &t, array[4]);  // total time
-					t2->count++;
-				} else {
-					int v;
-
-					t2 = insert_timer(&timers[1], &t, array[0]); t2->count++;  // req
-					t2 = insert_timer(&timers[2], &t, array[2]); t2->count++;  // conn
-					t2 = insert_timer(&timers[3], &t, array[3]); t2->count++;  // resp
-
-					v = array[4] - array[0] - array[1] - array[2] - array[3]; // data time
-					if (v < 0 && !(filter & FILT_QUIET))
-						fprintf(stderr, "ERR: %s (%d %d %d %d %d => %d)\n",
-							line, array[0], array[1], array[2], array[3], array[4], v);
-					t2 = insert_timer(&timers[4], &t, v); t2->count++;
-					tot++;
-				}
-			} else { /* percentile */
-				if (err) {
-					if (array[4] < 0)
-						array[4] = -1;
-					t2 = insert_value(&timers[0], &t, array[4]);  // total time
-					t2->count++;
-				} else {
-					int v;
-
-					t2 = insert_value(&timers[1], &t, array[0]); t2->count++;  // req
-					t2 = insert_value(&timers[2], &t, array[2]); t2->count++;  // conn
-					t2 = insert_value(&timers[3], &t, array[3]); t2->count++;  // resp
-
-					v = array[4] - array[0] - array[1] - array[2] - array[3]; // data time
-					if (v < 0 && !(filter & FILT_QUIET))
-						fprintf(stderr, "ERR: %s (%d %d %d %d %d => %d)\n",
-							line, array[0], array[1], array[2], array[3], array[4], v);
-					t2 = insert_value(&timers[4], &t, v); t2->count++;
-					tot++;
-				}
-			}
-			continue;
-		}
-
-		test ^= filter_invert;
-		if (!test)
-			continue;
-
-		/* all other cases mean we just want to count lines */
-		tot++;
-		if (!(filter & FILT_COUNT_ONLY))
-			puts(line);
 	}
 
+	t = ctx.t;
+	tot = ctx.tot;
+	linenum = ctx.linenum;
+	parse_err = ctx.parse_err;
+	timers = ctx.timers;
+
 	if (t)
 		free(t);
 
@@ -603,6 +1716,14 @@ int main(int argc, char **argv)
 		exit(0);
 	}
 
+	if (filter & (FILT_COUNT_URL|FILT_COUNT_SRV)) {
+		print_keys(&ctx.keys);
+		goto out;
+	}
+
+	if (filter & FILT_LIVE)
+		goto out;
+
 	if (filter & FILT_ERRORS_ONLY)
 		exit(0);
 
@@ -707,6 +1828,7 @@ int main(int argc, char **argv)
 		}
 	}
 
+ out:
 	if (!(filter & FILT_QUIET))
 		fprintf(stderr, "%d lines in, %d lines out, %d parsing errors\n",
 			linenum, tot, parse_err);
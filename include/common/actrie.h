@@ -0,0 +1,122 @@
+/*
+  include/common/actrie.h
+  Byte tries and Aho-Corasick automatons for multi-string matching.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _COMMON_ACTRIE_H
+#define _COMMON_ACTRIE_H
+
+#include <ctype.h>
+
+#include <common/config.h>
+#include <common/mini-clist.h>
+
+/* A trie stores strings byte by byte, folded to lower case. Each node lists
+ * the entries of the strings ending there in <entries>, so that callers can
+ * check them precisely (eg: for case sensitivity). Once all strings are
+ * inserted, ac_build() computes the failure links, which turns the trie into
+ * an Aho-Corasick automaton able to find all the strings contained in a text
+ * in a single pass. Tries used only for prefix lookups do not need this.
+ */
+struct ac_node {
+	struct ac_node *child;          /* first child */
+	struct ac_node *next;           /* next sibling */
+	struct ac_node *fail;           /* longest proper suffix present in the trie */
+	struct ac_node *out;            /* closest node on the fail chain with entries */
+	struct list entries;            /* user entries for strings ending here */
+	unsigned int depth;             /* length of the string ending here */
+	unsigned char c;                /* folded byte leading to this node */
+};
+
+struct ac_trie {
+	struct ac_node *root;           /* root node, NULL if empty */
+	struct ac_node **root_next;     /* direct transitions from the root, after ac_build() */
+	unsigned int count;             /* number of strings inserted */
+	unsigned int nodes;             /* number of nodes, including the root */
+};
+
+/* Initializes an empty trie. */
+static inline void ac_init(struct ac_trie *trie)
+{
+	trie->root = NULL;
+	trie->root_next = NULL;
+	trie->count = 0;
+	trie->nodes = 0;
+}
+
+/* Returns non-zero if the trie <trie> is empty. */
+static inline int ac_is_empty(const struct ac_trie *trie)
+{
+	return trie->root == NULL;
+}
+
+/* Returns the child of <node> reached with byte <c>, or NULL. */
+static inline struct ac_node *ac_child(const struct ac_node *node, unsigned char c)
+{
+	struct ac_node *child;
+
+	c = tolower(c);
+	for (child = node->child; child; child = child->next)
+		if (child->c == c)
+			return child;
+	return NULL;
+}
+
+/* Inserts the <len> bytes of <str> into <trie>, in reverse order if <rev> is
+ * non-zero, and returns the node where the string ends. The caller should
+ * then append its entry to the node's <entries> list. Returns NULL if memory
+ * is lacking.
+ */
+struct ac_node *ac_insert(struct ac_trie *trie, const char *str, int len, int rev);
+
+/* Computes the failure links of <trie> so that ac_next() may be used. Must be
+ * called again after any insertion. Returns 0 if memory is lacking, otherwise
+ * non-zero.
+ */
+int ac_build(struct ac_trie *trie);
+
+/* Returns the state of the automaton <trie> reached from <node> after byte
+ * <c>. ac_build() must have been called.
+ */
+static inline struct ac_node *ac_next(const struct ac_trie *trie, struct ac_node *node, unsigned char c)
+{
+	struct ac_node *child;
+
+	while (node != trie->root) {
+		child = ac_child(node, c);
+		if (child)
+			return child;
+		node = node->fail;
+	}
+	return trie->root_next[tolower(c)];
+}
+
+/* Releases all nodes of <trie>, calling <free_entries> on each list of
+ * entries if it is not NULL. The trie is empty upon return.
+ */
+void ac_free(struct ac_trie *trie, void (*free_entries)(struct list *));
+
+#endif /* _COMMON_ACTRIE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
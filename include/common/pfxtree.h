@@ -0,0 +1,86 @@
+/*
+  include/common/pfxtree.h
+  Binary prefix trees for longest-prefix matching (eg: IP networks).
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _COMMON_PFXTREE_H
+#define _COMMON_PFXTREE_H
+
+#include <common/compat.h>
+#include <common/config.h>
+
+/* A prefix tree is a path-compressed binary radix tree (Patricia tree) whose
+ * keys are bit strings of a fixed length, such as IPv4 or IPv6 addresses
+ * stored in network byte order. Each node holds a prefix of <plen> bits.
+ * Nodes with <set> cleared only exist to join two branches and do not match
+ * anything by themselves. A lookup walks at most as many nodes as there are
+ * bits in the key, regardless of the number of prefixes in the tree.
+ */
+struct pfx_node {
+	struct pfx_node *child[2];      /* branches for next bit 0 and 1 */
+	void *data;                     /* user data attached to this prefix */
+	unsigned short plen;            /* prefix length in bits */
+	unsigned char set;              /* non-zero if this prefix was inserted */
+	unsigned char key[VAR_ARRAY];   /* prefix bits, following bits are zero */
+};
+
+struct pfx_root {
+	struct pfx_node *node;          /* top of the tree, NULL if empty */
+	unsigned int key_len;           /* key length in bytes */
+	unsigned int count;             /* number of prefixes in the tree */
+};
+
+/* Initializes an empty prefix tree for keys of <key_len> bytes. */
+static inline void pfx_init(struct pfx_root *root, unsigned int key_len)
+{
+	root->node = NULL;
+	root->key_len = key_len;
+	root->count = 0;
+}
+
+/* Returns non-zero if the prefix tree <root> is empty. */
+static inline int pfx_is_empty(const struct pfx_root *root)
+{
+	return root->node == NULL;
+}
+
+/* Inserts the first <plen> bits of <key> into <root> and returns the
+ * corresponding node, which may already have existed. <data> is attached to
+ * the node if it was not already set. Returns NULL if memory is lacking.
+ */
+struct pfx_node *pfx_insert(struct pfx_root *root, const void *key, unsigned int plen, void *data);
+
+/* Returns the node holding the longest prefix of <root> which matches <key>,
+ * or NULL if no prefix matches. <key> must be <root>->key_len bytes long.
+ */
+struct pfx_node *pfx_lookup_longest(const struct pfx_root *root, const void *key);
+
+/* Releases all nodes of <root>, calling <free_data> on each attached data if
+ * it is not NULL. The tree is empty upon return.
+ */
+void pfx_free(struct pfx_root *root, void (*free_data)(void *));
+
+#endif /* _COMMON_PFXTREE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
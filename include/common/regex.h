@@ -40,19 +40,26 @@
 #define ACT_TARPIT	5	/* tarpit the connection matching this request */
 #define ACT_SETBE	6	/* switch the backend */
 
+/* limit above which all the scores of a chain are halved */
+#define EXP_SCORE_MAX	(1U << 24)
+
 struct hdr_exp {
     struct hdr_exp *next;
     const regex_t *preg;		/* expression to look for */
     int action;				/* ACT_ALLOW, ACT_REPLACE, ACT_REMOVE, ACT_DENY */
     const char *replace;		/* expression to set instead */
+    const char *str;			/* source of the expression, for reporting */
+    unsigned int hits;			/* number of times this expression matched */
+    unsigned int score;			/* decaying hit count used to reorder the chain */
 };
 
 extern regmatch_t pmatch[MAX_MATCH];
 
 int exp_replace(char *dst, char *src, const char *str,	const regmatch_t *matches);
 const char *check_replace_string(const char *str);
-const char *chain_regex(struct hdr_exp **head, const regex_t *preg,
+const char *chain_regex(struct hdr_exp **head, const regex_t *preg, const char *str,
 			int action, const char *replace);
+void promote_regex(struct hdr_exp *head, struct hdr_exp *prev, struct hdr_exp *exp);
 
 #endif /* _COMMON_REGEX_H */
 
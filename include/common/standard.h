@@ -22,6 +22,7 @@
 #ifndef _COMMON_STANDARD_H
 #define _COMMON_STANDARD_H
 
+#include <ctype.h>
 #include <limits.h>
 #include <time.h>
 #include <sys/types.h>
@@ -86,6 +87,23 @@ static inline const char *ultoa(unsigned long n)
 	return ultoa_r(n, itoa_str[0], sizeof(itoa_str[0]));
 }
 
+/*
+ * Writes the ascii representation for number 'n' in decimal at <dst>, which
+ * may receive at most <size> chars including the trailing zero. Returns a
+ * pointer to the trailing zero, or NULL if there is not enough room. The
+ * signed versions prepend a minus sign to negative numbers.
+ */
+extern char *ultoa_o(unsigned long n, char *dst, int size);
+extern char *ltoa_o(long n, char *dst, int size);
+extern char *lltoa_o(long long n, char *dst, int size);
+
+/*
+ * Writes the <size-1> lowest decimal digits of number 'n' at <dst>, padded
+ * with zeroes on the left, followed by a trailing zero. Returns a pointer to
+ * the trailing zero.
+ */
+extern char *utoa_pad(unsigned int n, char *dst, int size);
+
 /* Fast macros to convert up to 10 different parameters inside a same call of
  * expression.
  */
@@ -187,6 +205,14 @@ struct sockaddr_in *str2sa_range(char *str, int *low, int *high);
  */
 int str2net(const char *str, struct in_addr *addr, struct in_addr *mask);
 
+/*
+ * converts <str> to a struct in6_addr and a prefix length, which must be
+ * pre-allocated. The format is "addr[/len]", where "addr" cannot be empty
+ * and "len" is between 0 and 128 (defaults to 128). Hostnames are not
+ * supported. Returns 1 if OK, 0 if error.
+ */
+int str62net(const char *str, struct in6_addr *addr, int *plen);
+
 /*
  * Parse IP address found in url.
  */
@@ -309,6 +335,13 @@ extern const char *parse_time_err(const char *text, unsigned *ret, unsigned unit
 #define TIME_UNIT_DAY  0x0005
 #define TIME_UNIT_MASK 0x0007
 
+/* This function parses a size in bytes optionally followed by a unit suffix
+ * among "k", "m" or "g" (powers of 1024). The value is returned in <ret> if
+ * everything is fine, and a NULL is returned by the function. In case of
+ * error, a pointer to the error is returned and <ret> is left untouched.
+ */
+extern const char *parse_size_err(const char *text, unsigned *ret);
+
 /* Multiply the two 32-bit operands and shift the 64-bit result right 32 bits.
  * This is used to compute fixed ratios by setting one of the operands to
  * (2^32*ratio).
@@ -318,6 +351,18 @@ static inline unsigned int mul32hi(unsigned int a, unsigned int b)
 	return ((unsigned long long)a * b) >> 32;
 }
 
+/* Returns a hash of the first <len> bytes of <str>, ignoring case. */
+static inline unsigned int hash_nocase(const char *str, int len)
+{
+	unsigned int hash = 0;
+
+	while (len--) {
+		hash = tolower((unsigned char)*str) + (hash << 6) + (hash << 16) - hash;
+		str++;
+	}
+	return hash;
+}
+
 /* copies at most <n> characters from <src> and always terminates with '\0' */
 char *my_strndup(const char *src, int n);
 
@@ -22,6 +22,8 @@
 #ifndef _PROTO_ACL_H
 #define _PROTO_ACL_H
 
+#include <string.h>
+
 #include <common/config.h>
 #include <types/acl.h>
 
@@ -29,6 +31,9 @@
  * FIXME: we need destructor functions too !
  */
 
+extern struct pool_head *pool2_acl_cache;
+extern unsigned int acl_cache_size;
+
 /* Negate an acl result. This turns (ACL_PAT_FAIL, ACL_PAT_MISS, ACL_PAT_PASS)
  * into (ACL_PAT_PASS, ACL_PAT_MISS, ACL_PAT_FAIL).
  */
@@ -43,6 +48,34 @@ static inline int acl_pass(int res)
 	return (res >> 1);
 }
 
+/* Drops the ACL results cached for the current request of session <s>. If
+ * <vol_only> is non-zero, only the results which depend on rewritable parts
+ * of the request are dropped. This must be called after any modification of
+ * the request which may be seen by an ACL.
+ */
+static inline void acl_cache_flush(struct session *s, int vol_only)
+{
+	unsigned int i;
+
+	if (!s->acl_cache)
+		return;
+
+	if (!vol_only) {
+		memset(s->acl_cache, 0, acl_cache_size);
+		return;
+	}
+
+	for (i = 0; i < acl_cache_size; i++)
+		if (s->acl_cache[i] & ACL_CACHE_VOLATILE)
+			s->acl_cache[i] = 0;
+}
+
+/* Assigns a slot in the per-session ACL result cache to every ACL of proxy
+ * <px> referenced by more than one condition, since only those may be
+ * evaluated more than once per request. Returns the number of slots assigned.
+ */
+int acl_assign_cache_idx(struct proxy *px);
+
 /* Return a pointer to the ACL <name> within the list starting at <head>, or
  * NULL if not found.
  */
@@ -87,6 +120,12 @@ struct acl_cond *parse_acl_cond(const char **args, struct list *known_acl, int p
  */
 int acl_exec_cond(struct acl_cond *cond, struct proxy *px, struct session *l4, void *l7, int dir);
 
+/* To be called when condition <cond> from the list of equivalent conditions
+ * starting at <head> has just matched. It moves the condition one step closer
+ * to the head if it matches more often than its predecessor.
+ */
+void promote_acl_cond(struct list *head, struct acl_cond *cond);
+
 /* Reports a pointer to the first ACL used in condition <cond> which requires
  * at least one of the USE_FLAGS in <require>. Returns NULL if none matches.
  */
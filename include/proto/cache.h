@@ -0,0 +1,72 @@
+/*
+  include/proto/cache.h
+  This file contains functions prototypes for the HTTP objects cache.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _PROTO_CACHE_H
+#define _PROTO_CACHE_H
+
+#include <common/config.h>
+#include <types/cache.h>
+
+/* Returns a new empty cache limited to <size> bytes, storing responses of at
+ * most <max_obj> bytes for at most <max_age> milliseconds, or NULL if memory
+ * is lacking.
+ */
+struct cache *cache_new(unsigned int size, unsigned int max_obj, unsigned int max_age);
+
+/* Releases cache <cache> and all of its objects. */
+void cache_free(struct cache *cache);
+
+/* Returns a new object for the <len> bytes of key <key>, with no data yet, or
+ * NULL if memory is lacking. It is not part of any cache.
+ */
+struct cache_obj *cache_obj_new(const char *key, int len);
+
+/* Reallocates object <obj> so that it may store a response of <len> bytes.
+ * The object must not be part of any cache. Returns the new object, or NULL
+ * after releasing the old one if memory is lacking.
+ */
+struct cache_obj *cache_obj_resize(struct cache_obj *obj, int len);
+
+/* Returns the object of <cache> stored under the <len> bytes of <key> and
+ * marks it as the most recently used one, or NULL if there is none or if it
+ * has expired.
+ */
+struct cache_obj *cache_lookup(struct cache *cache, const char *key, int len);
+
+/* Stores object <obj> into <cache>, replacing any object with the same key,
+ * and evicting the least recently used ones if memory is lacking. The object
+ * is released if it cannot fit.
+ */
+void cache_insert(struct cache *cache, struct cache_obj *obj);
+
+/* Removes from <cache> the object stored under the <len> bytes of <key>, if
+ * any.
+ */
+void cache_delete(struct cache *cache, const char *key, int len);
+
+#endif /* _PROTO_CACHE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
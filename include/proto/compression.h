@@ -0,0 +1,71 @@
+/*
+  include/proto/compression.h
+  This file contains functions prototypes for HTTP response compression.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _PROTO_COMPRESSION_H
+#define _PROTO_COMPRESSION_H
+
+#include <common/config.h>
+#include <types/buffers.h>
+#include <types/compression.h>
+
+/* Returns the algorithm named by the <len> bytes of <name>, or COMP_ALGO_NONE. */
+int comp_find_algo(const char *name, int len);
+
+/* Returns the content-coding name of algorithm <algo>. */
+const char *comp_algo_name(int algo);
+
+/* Returns non-zero if the <len> bytes of content type <type> are one of the
+ * types of <comp>, or of the default ones if it has none.
+ */
+int comp_type_match(const struct comp *comp, const char *type, int len);
+
+#ifdef USE_ZLIB
+extern struct pool_head *pool2_comp_ctx;
+
+/* Initializes the compression subsystem. Returns 0 in case of failure. */
+int init_compression();
+
+/* Returns a new compression context for algorithm <algo>, or NULL if memory
+ * is lacking, or if the compression rate or memory limits are reached.
+ */
+struct comp_ctx *comp_ctx_new(int algo);
+
+/* Releases compression context <ctx>, which may be NULL. */
+void comp_ctx_free(struct comp_ctx *ctx);
+
+/* Compresses the raw body data following the scheduled data of buffer <buf>,
+ * up to <*left> bytes, and replaces them with chunks of compressed data which
+ * are scheduled for sending. <*left> is decreased by the amount of data
+ * consumed. Once it reaches zero, the compressed stream is terminated along
+ * with the chunked encoding. Returns 1 once everything has been scheduled, 0
+ * if more room or data are needed, or -1 in case of error.
+ */
+int comp_forward(struct comp_ctx *ctx, struct buffer *buf, unsigned long long *left);
+#endif
+
+#endif /* _PROTO_COMPRESSION_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -50,6 +50,8 @@ int stats_dump_http(struct session *s, struct buffer *rep, struct uri_auth *uri)
 int stats_dump_proxy(struct session *s, struct proxy *px, struct uri_auth *uri);
 void stats_dump_sess_to_buffer(struct session *s, struct buffer *rep);
 void stats_dump_errors_to_buffer(struct session *s, struct buffer *rep);
+void stats_dump_filters_to_buffer(struct session *s, struct buffer *rep);
+void stats_dump_histo_to_buffer(struct session *s, struct buffer *rep);
 
 
 #endif /* _PROTO_DUMPSTATS_H */
@@ -0,0 +1,82 @@
+/*
+  include/proto/histo.h
+  This file contains functions prototypes for timer histograms.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _PROTO_HISTO_H
+#define _PROTO_HISTO_H
+
+#include <common/config.h>
+#include <common/ebtree.h>
+#include <common/standard.h>
+#include <types/histo.h>
+
+/* Returns the bin of histograms in which value <v> is accounted. */
+static inline int histo_bin(unsigned int v)
+{
+	int shift;
+
+	if (v < (1 << HISTO_BITS))
+		return v;
+	if (v >= (1U << HISTO_MAX_BITS))
+		return HISTO_BINS - 1;
+	shift = flsnz(v) - HISTO_BITS;
+	return (shift << (HISTO_BITS - 1)) + (v >> shift);
+}
+
+/* Returns the lowest value accounted in bin <bin>. */
+static inline unsigned int histo_bin_value(int bin)
+{
+	if (bin < (1 << HISTO_BITS))
+		return bin;
+	return ((bin & ((1 << (HISTO_BITS - 1)) - 1)) | (1 << (HISTO_BITS - 1))) <<
+		((bin >> (HISTO_BITS - 1)) - 1);
+}
+
+/* Halves all the bins of histogram <h> so that it does not overflow, and so
+ * that old values weigh less than new ones.
+ */
+void histo_halve(struct histo *h);
+
+/* Accounts value <v> in histogram <h>. Negative values, which designate
+ * timers that were not reached, are ignored.
+ */
+static inline void histo_add(struct histo *h, int v)
+{
+	if (v < 0)
+		return;
+	if (unlikely(h->count >= HISTO_MAX_COUNT))
+		histo_halve(h);
+	h->bins[histo_bin(v)]++;
+	h->count++;
+}
+
+/* Returns the lowest value of the bin of histogram <h> below which <pct>
+ * percent of its values are, or -1 if it is empty.
+ */
+int histo_percentile(const struct histo *h, int pct);
+
+#endif /* _PROTO_HISTO_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -24,10 +24,14 @@
 #define _PROTO_LOG_H
 
 #include <stdio.h>
+#include <string.h>
 #include <syslog.h>
+#include <sys/socket.h>
+#include <sys/time.h>
 
 #include <common/config.h>
 #include <common/memory.h>
+#include <common/standard.h>
 #include <types/log.h>
 #include <types/proxy.h>
 #include <types/session.h>
@@ -62,6 +66,125 @@ void qfprintf(FILE *out, const char *fmt, ...)
 void send_log(struct proxy *p, int level, const char *message, ...)
 	__attribute__ ((format(printf, 3, 4)));
 
+/*
+ * Returns the address where the data of the next log message may be written,
+ * right after the syslog header, and stores into <size> the number of bytes
+ * available there. The message is then sent with send_log_buffer().
+ */
+char *get_log_buffer(int *size);
+
+/*
+ * Queues the <len> bytes of data written at the address returned by
+ * get_log_buffer() for both log servers of a proxy, or for global log servers
+ * if the proxy is NULL. The last byte is forced to a line feed.
+ */
+void send_log_buffer(struct proxy *p, int level, int len);
+
+/*
+ * Sends the log messages waiting in the ring, in the order they were queued,
+ * grouping those sent from the same socket. Messages which cannot be sent
+ * yet are kept for the next call.
+ */
+void flush_log_ring();
+
+/* number of log messages dropped because the ring was full */
+extern unsigned int log_drops;
+
+/* number of log messages dropped by the stream log targets, which are also
+ * accounted for in <log_drops>.
+ */
+extern unsigned int log_stream_drops;
+
+/*
+ * Returns the stream log target of type <type> (LOG_STREAM_*) for <path>,
+ * which is created if it does not exist yet. Returns NULL if the path is too
+ * long or if memory is lacking.
+ */
+struct log_stream *get_log_stream(int type, const char *path);
+
+/*
+ * Writes the messages waiting for the stream log targets which are not polled
+ * yet, opening them if needed. <next> is updated, if not NULL, so that targets
+ * which could not be opened are retried in time.
+ */
+void flush_log_streams(int *next);
+
+/*
+ * Opens the files of the "file@" log targets. Returns the path of the first
+ * file which could not be opened, or NULL if all of them were opened.
+ */
+const char *open_log_files();
+
+/*
+ * Writes what can still be written to the stream log targets, then closes
+ * their sockets, dropping the messages which remain. Files are left open if
+ * <keep_files> is set.
+ */
+void close_log_streams(int keep_files);
+
+/*
+ * The lf_* functions below write a log field at <dst>, followed by a trailing
+ * zero, provided that it fits before <end>. They return a pointer to the
+ * trailing zero, or NULL if there is not enough room or if <dst> is NULL, so
+ * that a whole line may be written without checking each field.
+ */
+
+/* Writes the date of <tv> in the "dd/Mon/yyyy:hh:mm:ss.mmm" format. */
+char *lf_date(char *dst, const char *end, const struct timeval *tv);
+
+/* Writes the address and port of <addr> as "ip:port". */
+char *lf_addr(char *dst, const char *end, const struct sockaddr_storage *addr);
+
+static inline char *lf_char(char *dst, const char *end, char c)
+{
+	if (!dst || end - dst < 2)
+		return NULL;
+	*dst++ = c;
+	*dst = '\0';
+	return dst;
+}
+
+static inline char *lf_text(char *dst, const char *end, const char *text)
+{
+	int len;
+
+	if (!dst)
+		return NULL;
+	len = strlen(text);
+	if (len >= end - dst)
+		return NULL;
+	memcpy(dst, text, len + 1);
+	return dst + len;
+}
+
+static inline char *lf_ulong(char *dst, const char *end, unsigned long n)
+{
+	return dst ? ultoa_o(n, dst, end - dst) : NULL;
+}
+
+static inline char *lf_long(char *dst, const char *end, long n)
+{
+	return dst ? ltoa_o(n, dst, end - dst) : NULL;
+}
+
+static inline char *lf_llong(char *dst, const char *end, long long n)
+{
+	return dst ? lltoa_o(n, dst, end - dst) : NULL;
+}
+
+/*
+ * Sends a binary record of type <type> (BINLOG_TCP or BINLOG_HTTP) describing
+ * session <s> to the "log-binary" collector. <svid> is the server name as it
+ * appears in the text logs, and <t_request> the request time for HTTP.
+ */
+void send_binlog(struct session *s, int type, const char *svid, int t_request);
+
+/*
+ * Returns non-zero if the log of session <s>, which terminated normally, must
+ * be skipped because of the sampling or the log rate limit of frontend <fe>.
+ */
+int skip_normal_log(struct session *s, struct proxy *fe);
+
 /*
  * send a log for the session when we have enough info about it
  */
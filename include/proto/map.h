@@ -0,0 +1,58 @@
+/*
+  include/proto/map.h
+  This file contains functions prototypes for key/value maps.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _PROTO_MAP_H
+#define _PROTO_MAP_H
+
+#include <common/config.h>
+#include <types/map.h>
+
+/* Loads the map from file <file>, using lookup method <match> and flags
+ * <flags>. Each non-empty line not starting with '#' must contain a key and
+ * a value separated by spaces. ERR_WARN is added to <err_code> when a warning
+ * is emitted. Returns the map, or NULL after emitting an alert in case of
+ * error.
+ */
+struct map *map_load(const char *file, int match, int flags, int *err_code);
+
+/* Returns the entry of <map> matching the <len> bytes at <key> according to
+ * the map's lookup method, or NULL.
+ */
+struct map_entry *map_lookup(struct map *map, const char *key, int len);
+
+/* Releases map <map> and all of its entries. */
+void map_free(struct map *map);
+
+/* Parses a map key designation such as "map(hdr(host))" or "map_beg(path)"
+ * from <str> into <key>, and sets <match> to the lookup method it implies.
+ * Returns 1 if OK, 0 if <str> does not designate a map, or -1 if it is
+ * invalid.
+ */
+int map_parse_key(const char *str, struct map_key *key, int *match);
+
+#endif /* _PROTO_MAP_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
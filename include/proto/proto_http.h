@@ -57,6 +57,12 @@ extern const char http_is_ver_token[256];
 #define HTTP_IS_TOKEN(x) (http_is_token[(unsigned char)(x)])
 #define HTTP_IS_VER_TOKEN(x) (http_is_ver_token[(unsigned char)(x)])
 
+extern const char sess_cookie[4];
+extern const char sess_set_cookie[8];
+
+extern struct pool_head *pool2_body_spill;
+extern unsigned int body_spill_size;
+
 int event_accept(int fd);
 int process_cli(struct session *t);
 int process_srv_data(struct session *t);
@@ -64,7 +70,10 @@ int process_srv_conn(struct session *t);
 int http_process_request(struct session *t, struct buffer *req);
 int http_process_tarpit(struct session *s, struct buffer *req);
 int http_process_request_body(struct session *s, struct buffer *req);
+int http_request_forward_body(struct session *s, struct buffer *req);
 int process_response(struct session *t);
+int http_response_forward_body(struct session *s, struct buffer *rep);
+int http_parse_chunk_size(const struct buffer *buf, const char *ptr, int avail, unsigned int *res);
 
 void produce_content(struct session *s, struct buffer *rep);
 int produce_content_stats(struct session *s);
@@ -73,8 +82,8 @@ void debug_hdr(const char *dir, struct session *t, const char *start, const char
 void get_srv_from_appsession(struct session *t, const char *begin, int len);
 int apply_filter_to_req_headers(struct session *t, struct buffer *req, struct hdr_exp *exp);
 int apply_filter_to_req_line(struct session *t, struct buffer *req, struct hdr_exp *exp);
-int apply_filters_to_request(struct session *t, struct buffer *req, struct hdr_exp *exp);
-int apply_filters_to_response(struct session *t, struct buffer *rtr, struct hdr_exp *exp);
+int apply_filters_to_request(struct session *t, struct buffer *req, struct proxy *px);
+int apply_filters_to_response(struct session *t, struct buffer *rtr, struct proxy *px);
 void manage_client_side_cookies(struct session *t, struct buffer *req);
 void manage_server_side_cookies(struct session *t, struct buffer *rtr);
 void check_response_for_cacheability(struct session *t, struct buffer *rtr);
@@ -85,6 +94,8 @@ int http_find_header2(const char *name, int len,
 		      struct hdr_ctx *ctx);
 void http_sess_log(struct session *s);
 void perform_http_redirect(struct session *s, struct stream_interface *si);
+struct redirect_msg *http_make_redirect(int code, const char *location, int loc_len,
+					const char *cookie, int cookie_len);
 void http_return_srv_error(struct session *s, struct stream_interface *si);
 void http_capture_bad_message(struct error_snapshot *es, struct session *s,
                               struct buffer *buf, struct http_msg *msg,
@@ -35,6 +35,7 @@ void session_free(struct session *s);
 int init_session();
 
 void session_process_counters(struct session *s);
+void session_process_timers(struct session *s);
 void sess_change_server(struct session *sess, struct server *newsrv);
 struct task *process_session(struct task *t);
 void sess_set_term_flags(struct session *s);
@@ -22,9 +22,12 @@
 #ifndef _TYPES_ACL_H
 #define _TYPES_ACL_H
 
+#include <common/actrie.h>
 #include <common/compat.h>
 #include <common/config.h>
+#include <common/eb32tree.h>
 #include <common/mini-clist.h>
+#include <common/pfxtree.h>
 
 #include <types/proxy.h>
 #include <types/session.h>
@@ -86,6 +89,17 @@ enum {
 	ACL_TEST_F_SET_RES_FAIL = (ACL_TEST_F_RES_SET),                      /* sets result to FAIL */
 };
 
+/* Entries of the per-session ACL result cache. There is one byte per cacheable
+ * ACL, holding the ACL_PAT_* result in the lower bits. Entries marked VOLATILE
+ * depend on contents which may be rewritten (eg: headers) and are flushed when
+ * the request is modified.
+ */
+enum {
+	ACL_CACHE_RES_MASK = 0x03,      /* ACL_PAT_FAIL, ACL_PAT_MISS or ACL_PAT_PASS */
+	ACL_CACHE_VALID    = 1 << 2,    /* a result is present */
+	ACL_CACHE_VOLATILE = 1 << 3,    /* result must be flushed when the request is rewritten */
+};
+
 /* ACLs can be evaluated on requests and on responses, and on partial or complete data */
 enum {
 	ACL_DIR_REQ = 0,        /* ACL evaluated on request */
@@ -98,6 +112,7 @@ enum {
 enum {
 	ACL_PAT_F_IGNORE_CASE = 1 << 0,       /* ignore case */
 	ACL_PAT_F_FROM_FILE   = 1 << 1,       /* pattern comes from a file */
+	ACL_PAT_F_IPV6        = 1 << 2,       /* pattern is an IPv6 network */
 };
 
 /* what capabilities an ACL uses. These flags are set during parsing, which
@@ -196,6 +211,7 @@ struct acl_time {
 /* The acl will be linked to from the proxy where it is declared */
 struct acl_pattern {
 	struct list list;                       /* chaining */
+	struct eb32_node node;                  /* indexing by string hash, when not in list */
 	union {
 		int i;                          /* integer value */
 		struct {
@@ -207,6 +223,10 @@ struct acl_pattern {
 			struct in_addr addr;
 			struct in_addr mask;
 		} ipv4;                         /* IPv4 address */
+		struct {
+			struct in6_addr addr;
+			int plen;
+		} ipv6;                         /* IPv6 network (with ACL_PAT_F_IPV6) */
 		struct acl_time time;           /* valid hours and days */
 	} val;                                  /* direct value */
 	union {
@@ -293,14 +313,19 @@ struct acl_expr {
 	} arg;
 	int arg_len;                /* optional argument length */
 	struct list patterns;       /* list of acl_patterns */
+	struct pfx_root ip4_tree;   /* IPv4 networks indexed for prefix lookups */
+	struct pfx_root ip6_tree;   /* IPv6 networks indexed for prefix lookups */
+	struct eb_root str_tree;    /* exact strings indexed by their hash */
+	struct ac_trie str_trie;    /* prefixes, reversed suffixes or substrings */
 };
 
 struct acl {
 	struct list list;           /* chaining */
 	char *name;		    /* acl name */
 	struct list expr;	    /* list of acl_exprs */
-	int cache_idx;              /* ACL index in cache */
+	int cache_idx;              /* ACL index in cache, -1 if not cached */
 	unsigned int requires;      /* or'ed bit mask of all acl_expr's ACL_USE_* */
+	unsigned int use_cnt;       /* number of condition terms referencing this ACL */
 };
 
 /* the condition will be linked to from an action in a proxy */
@@ -321,6 +346,8 @@ struct acl_cond {
 	int pol;                    /* polarity: ACL_COND_IF / ACL_COND_UNLESS */
 	unsigned int requires;      /* or'ed bit mask of all acl's ACL_USE_* */
 	int line;                   /* line in the config file where the condition is declared */
+	unsigned int hits;          /* number of times this condition matched */
+	unsigned int score;         /* decaying hit count used to reorder rules */
 };
 
 
@@ -0,0 +1,64 @@
+/*
+  include/types/cache.h
+  This file contains structure declarations for the HTTP objects cache.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _TYPES_CACHE_H
+#define _TYPES_CACHE_H
+
+#include <common/config.h>
+#include <common/eb32tree.h>
+#include <common/mini-clist.h>
+
+/* A cached object is a complete response, exactly as it was sent to the
+ * client which caused it to be stored. The key and the response are stored
+ * in the same allocation, right after the structure.
+ */
+struct cache_obj {
+	struct list list;       /* chaining of all objects of the cache */
+	struct eb32_node node;  /* indexing by hash of the key */
+	struct eb32_node lru;   /* indexing by date of last use */
+	int expire;             /* expiration date in ticks */
+	int status;             /* HTTP status of the response, for the logs */
+	int key_len;            /* key length */
+	int hdr_len;            /* length of the headers, including the empty line */
+	int len;                /* length of the whole response */
+	char *key;              /* key : host followed by the URI */
+	char *data;             /* response : headers followed by the body */
+};
+
+struct cache {
+	unsigned int size;      /* maximum memory usage, in bytes */
+	unsigned int used;      /* current memory usage, in bytes */
+	unsigned int max_obj;   /* maximum response size, in bytes */
+	unsigned int max_age;   /* maximum lifetime of an object, in ms */
+	unsigned int last_use;  /* use date given to the last used object */
+	struct list objects;    /* all objects */
+	struct eb_root by_hash; /* objects indexed by hash of their key */
+	struct eb_root by_use;  /* objects indexed by date of last use */
+};
+
+#endif /* _TYPES_CACHE_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
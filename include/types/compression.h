@@ -0,0 +1,73 @@
+/*
+  include/types/compression.h
+  This file contains structure declarations for HTTP response compression.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _TYPES_COMPRESSION_H
+#define _TYPES_COMPRESSION_H
+
+#include <common/config.h>
+
+#ifdef USE_ZLIB
+#include <zlib.h>
+#endif
+
+/* Supported content-codings */
+enum {
+	COMP_ALGO_NONE = 0,
+	COMP_ALGO_GZIP,         /* "gzip" : deflate stream with a gzip wrapper */
+	COMP_ALGO_DEFLATE,      /* "deflate" : deflate stream with a zlib wrapper */
+	COMP_ALGOS              /* number of algorithms, including NONE */
+};
+
+/* A content type to compress */
+struct comp_type {
+	char *name;             /* type, such as "text/html" */
+	int len;                /* type length */
+	struct comp_type *next;
+};
+
+/* Compression settings of a proxy */
+struct comp {
+	int algos[COMP_ALGOS - 1];      /* configured algorithms, in order of preference */
+	int nb_algos;                   /* number of configured algorithms */
+	struct comp_type *types;        /* types to compress, NULL = all "text/" types */
+};
+
+#ifdef USE_ZLIB
+/* Compression state of a response. Compressed data wait in <out> until they
+ * can be inserted into the response buffer.
+ */
+struct comp_ctx {
+	z_stream strm;          /* zlib stream */
+	int finished;           /* the compressed stream is complete */
+	int pending;            /* bytes fed since the last flush */
+	int out_len;            /* number of bytes waiting in <out> */
+	char out[BUFSIZE];      /* compressed data not sent yet */
+};
+#endif
+
+#endif /* _TYPES_COMPRESSION_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -62,6 +62,8 @@ struct global {
 	int nbproc;
 	int maxconn;
 	int maxpipes;		/* max # of pipes */
+	int maxzlibmem;		/* max memory for compression, in MB, 0=unlimited */
+	int maxcomprate;	/* max compression input rate, in kB/s, 0=unlimited */
 	int maxsock;		/* max # of sockets */
 	int rlimit_nofile;	/* default ulimit-n value : 0=unset */
 	int rlimit_memmax;	/* default ulimit-d in megs value : 0=unset */
@@ -75,6 +77,8 @@ struct global {
 	int loglev1, loglev2;
 	int minlvl1, minlvl2;
 	struct logsrv logsrv1, logsrv2;
+	struct logsrv binlog_srv;	/* "log-binary" socket */
+	int binlog_type;		/* SOCK_DGRAM or SOCK_STREAM, 0=disabled */
 	struct {
 		int maxpollevents; /* max number of poll events at once */
 		int maxaccept;     /* max number of consecutive accept() */
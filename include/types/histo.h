@@ -0,0 +1,60 @@
+/*
+  include/types/histo.h
+  This file contains structure declarations for timer histograms.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _TYPES_HISTO_H
+#define _TYPES_HISTO_H
+
+#include <common/config.h>
+
+/* Values below 1 << HISTO_BITS have their own bin. Larger ones only keep their
+ * HISTO_BITS higher bits, which gives a precision of 12.5% with 8 bins per
+ * power of two. Values of HISTO_MAX_BITS bits or more (about 17 minutes) are
+ * accounted in the last bin.
+ */
+#define HISTO_BITS      4
+#define HISTO_MAX_BITS  20
+#define HISTO_BINS      (((HISTO_MAX_BITS - HISTO_BITS) << (HISTO_BITS - 1)) + (1 << HISTO_BITS))
+
+/* once a histogram holds that many values, all of its bins are halved */
+#define HISTO_MAX_COUNT 0x80000000U
+
+/* Timers of a request accounted in the histograms of its backend and server */
+enum {
+	HISTO_QUEUE = 0,        /* "Tw" : time spent in the queues */
+	HISTO_CONNECT,          /* "Tc" : time to connect to the server */
+	HISTO_RESPONSE,         /* "Tr" : time to get the response headers */
+	HISTO_TIMERS            /* number of timers */
+};
+
+/* Distribution of a timer, in milliseconds */
+struct histo {
+	unsigned int count;             /* number of values accounted */
+	unsigned int bins[HISTO_BINS];  /* number of values per bin */
+};
+
+#endif /* _TYPES_HISTO_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -32,6 +32,25 @@
 #define NB_LOG_LEVELS           8
 #define SYSLOG_PORT             514
 
+/* Log messages are queued in a ring of LOG_RING_SIZE messages, which is
+ * flushed at most LOG_BATCH messages per system call.
+ */
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE           256
+#endif
+#ifndef LOG_BATCH
+#define LOG_BATCH               32
+#endif
+
+/* Stream log targets buffer up to LOG_STREAM_BUFSIZE bytes of messages. */
+#ifndef LOG_STREAM_BUFSIZE
+#define LOG_STREAM_BUFSIZE      65536
+#endif
+
+/* stream log target types */
+#define LOG_STREAM_UNIX         1       /* "stream@<path>" : UNIX stream socket */
+#define LOG_STREAM_FILE         2       /* "file@<path>" : regular file */
+
 
 /* fields that need to be logged. They appear as flags in session->logs.logwait */
 #define LW_DATE		1	/* date */
@@ -47,12 +66,93 @@
 #define LW_REQHDR	1024	/* request header(s) */
 #define LW_RSPHDR	2048	/* response header(s) */
 
+/* A stream log target receives the messages of all the loggers which use its
+ * path, newline-terminated, through a bounded buffer. Messages which do not
+ * fit in the buffer are dropped and counted.
+ */
+struct log_stream {
+	struct log_stream *next;	/* next stream target */
+	int type;			/* LOG_STREAM_* */
+	int fd;				/* -1 if not connected/opened */
+	int retry;			/* date of the next connection attempt (ticks) */
+	unsigned int drops;		/* messages dropped */
+	int o;				/* offset of the pending data in <buf> */
+	int l;				/* length of the pending data */
+	int partial;			/* a message was partially written */
+	struct sockaddr_un addr;	/* path of the socket or file */
+	char buf[LOG_STREAM_BUFSIZE];	/* pending messages */
+};
+
 struct logsrv {
 	union {
 		struct sockaddr addr;
 		struct sockaddr_un un;	/* AF_UNIX */
 		struct sockaddr_in in;	/* AF_INET */
 	} u;
+	struct log_stream *stream;	/* stream target, NULL for datagrams */
+};
+
+/* Binary log records, sent to the "log-binary" socket. A record starts with
+ * a fixed-size header, followed by length-prefixed strings. All integers are
+ * in network byte order. Each string is preceded by its length on 16 bits,
+ * and strings appear in this order : frontend, backend, server, request
+ * cookie, response cookie, <nb_req_cap> request captures, <nb_rsp_cap>
+ * response captures and URI. Absent strings have a zero length. The timers
+ * and counters have the same meaning as in the text logs, -1 meaning that the
+ * event did not happen.
+ */
+#define BINLOG_VERSION          1
+#define BINLOG_MAX_LEN          8192    /* maximum record length */
+
+/* record types */
+#define BINLOG_TCP              1       /* "option tcplog" session */
+#define BINLOG_HTTP             2       /* "option httplog" session */
+
+/* record flags */
+#define BINLOG_F_IPV6           0x01    /* cli_addr is an IPv6 address */
+#define BINLOG_F_REDISP         0x02    /* the session was redispatched */
+#define BINLOG_F_PARTIAL        0x04    /* Tt and bytes are not final ("+") */
+
+struct binlog_rec {
+	unsigned short len;		/* record length, strings included */
+	unsigned char version;		/* BINLOG_VERSION */
+	unsigned char type;		/* BINLOG_TCP or BINLOG_HTTP */
+	unsigned int accept_sec;	/* accept date (seconds since the epoch) */
+	unsigned int accept_usec;	/* accept date (microseconds) */
+	int t_request;			/* Tq */
+	int t_queue;			/* Tw */
+	int t_connect;			/* Tc */
+	int t_data;			/* Tr */
+	int t_close;			/* Tt */
+	unsigned int bytes_hi;		/* bytes read from the server, high ... */
+	unsigned int bytes_lo;		/* ... and low 32 bits */
+	unsigned int actconn;		/* process' active connections */
+	unsigned int feconn;		/* frontend's active connections */
+	unsigned int beconn;		/* backend's active connections */
+	unsigned int srv_conn;		/* server's active connections */
+	unsigned int srv_queue;		/* server's queue size at accept() */
+	unsigned int prx_queue;		/* backend's queue size at accept() */
+	unsigned short status;		/* HTTP status, 0 for TCP */
+	unsigned short cli_port;	/* client's port */
+	unsigned short retries;		/* connection retries */
+	unsigned char flags;		/* BINLOG_F_* */
+	char term_cond;			/* session termination code ... */
+	char fin_state;			/* ... and session state at termination */
+	char cli_ck;			/* request cookie flag ... */
+	char srv_ck;			/* ... and response cookie flag, '-' if none */
+	unsigned char nb_req_cap;	/* number of request captures */
+	unsigned char nb_rsp_cap;	/* number of response captures */
+	unsigned char pad[3];
+	unsigned char cli_addr[16];	/* client's IPv4 (4 first bytes) or IPv6 address */
+};
+
+/* a log message waiting in the ring to be sent */
+struct log_entry {
+	const struct logsrv *srv;	/* destination */
+	int fd;				/* socket to send it from */
+	int logger;			/* logger number, for the error messages */
+	int len;			/* message length */
+	char msg[MAX_SYSLOG_LEN];	/* message, including the syslog header */
 };
 
 #endif /* _TYPES_LOG_H */
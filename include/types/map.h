@@ -0,0 +1,85 @@
+/*
+  include/types/map.h
+  This file contains structure declarations for key/value maps.
+
+  Copyright (C) 2026 agent - agent@local
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation, version 2.1
+  exclusively.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _TYPES_MAP_H
+#define _TYPES_MAP_H
+
+#include <common/actrie.h>
+#include <common/config.h>
+#include <common/eb32tree.h>
+#include <common/mini-clist.h>
+
+/* How keys are looked up in a map */
+enum {
+	MAP_MATCH_STR = 0,      /* the whole key must match */
+	MAP_MATCH_BEG,          /* the key must begin with the entry */
+};
+
+/* map flags */
+#define MAP_F_ICASE	0x0001	/* keys are compared ignoring case */
+
+/* Where to find the key of a map lookup in an HTTP request */
+enum {
+	MAP_KEY_NONE = 0,
+	MAP_KEY_HDR,            /* value of a request header, without the port for "host" */
+	MAP_KEY_PATH,           /* path part of the URI, without the query string */
+};
+
+/* A map associates keys with values, both read from a file where each line
+ * holds a key followed by its value. Values are kept as text, and the user
+ * may store what they resolve to (eg: a backend) in <ptr>.
+ */
+struct map_entry {
+	struct list list;       /* chaining in declaration order */
+	struct eb32_node node;  /* indexing by hash of the key */
+	struct list trie;       /* chaining at the trie node where the key ends */
+	char *key;              /* key, zero-terminated */
+	int len;                /* key length */
+	char *value;            /* value as read from the file */
+	void *ptr;              /* resolved value, set by the user */
+	int line;               /* line in the file, for error reporting */
+};
+
+struct map {
+	char *file;             /* file the map was loaded from */
+	int match;              /* MAP_MATCH_* */
+	int flags;              /* MAP_F_* */
+	unsigned int count;     /* number of entries */
+	struct list entries;    /* all entries in declaration order */
+	struct eb_root by_hash; /* entries indexed by hash of their key */
+	struct ac_trie trie;    /* entries indexed by prefix, for MAP_MATCH_BEG */
+};
+
+/* Designates the part of a request used as a map key */
+struct map_key {
+	int type;               /* MAP_KEY_* */
+	char *name;             /* header name for MAP_KEY_HDR */
+	int name_len;           /* header name length */
+};
+
+#endif /* _TYPES_MAP_H */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -25,6 +25,7 @@
 #include <common/config.h>
 
 #include <types/buffers.h>
+#include <types/cache.h>
 #include <types/hdr_idx.h>
 
 /*
@@ -80,6 +81,18 @@
 #define TX_CACHE_COOK	0x00002000	/* a cookie in the response is cacheable */
 #define TX_CACHE_SHIFT	12		/* bit shift */
 
+#define TX_RES_CHNK	0x00004000	/* the response body is chunk-encoded */
+
+/* content-codings accepted by the client, bit values 0x8000 to 0x10000 */
+#define TX_ACCEPT_GZIP	0x00008000	/* the client accepts "gzip" */
+#define TX_ACCEPT_DEFLATE	0x00010000	/* the client accepts "deflate" */
+#define TX_ACCEPT_SHIFT	14		/* bit shift, plus the COMP_ALGO_* value */
+
+/* pipelining */
+#define TX_REQ_CHNK	0x00020000	/* the request body is chunk-encoded */
+#define TX_PIPELINE	0x00040000	/* another request may follow this one on the connection */
+#define TX_PIPELINED	0x00080000	/* this request followed another one on the connection */
+
 
 /* The HTTP parser is more complex than it looks like, because we have to
  * support multi-line headers and any number of spaces between the colon and
@@ -139,6 +152,17 @@
 #define HTTP_MSG_BODY         26 // parsing body at end of headers
 #define HTTP_MSG_ERROR        27 // an error occurred
 
+/* body states, once the headers have been processed (RFC2616 #3.6.1) */
+#define HTTP_MSG_CHUNK_SIZE   28 // parsing a chunk size line
+#define HTTP_MSG_DATA         29 // forwarding chunk data or a known-length body
+#define HTTP_MSG_DATA_CRLF    30 // parsing the CRLF after chunk data
+#define HTTP_MSG_TRAILERS     31 // parsing trailers after the last chunk
+#define HTTP_MSG_DONE         32 // the whole message has been forwarded
+#define HTTP_MSG_HDR_SKIP     33 // skipping headers up to the empty line, without indexing
+
+/* http_msg flags */
+#define HTTP_MSGF_NO_HDR_IDX  0x00000001 // nobody needs the headers, do not index them
+
 
 /* various data sources for the responses */
 #define DATA_SRC_NONE	0
@@ -176,6 +200,19 @@ enum {
 	REDIRECT_TYPE_NONE = 0,         /* no redirection */
 	REDIRECT_TYPE_LOCATION,         /* location redirect */
 	REDIRECT_TYPE_PREFIX,           /* prefix redirect */
+	REDIRECT_TYPE_MAP,              /* location looked up in a map */
+};
+
+/* A redirect response built once for all at configuration time, so that it
+ * may be sent without any formatting. The only part which may vary at runtime,
+ * such as the request path after a prefix, is inserted between <head> and
+ * <tail>. Both are in the same allocation, <tail> right after <head>, so that
+ * a response without any variable part is sent at once from <head>.
+ */
+struct redirect_msg {
+	int code;                       /* HTTP status code */
+	struct chunk head;              /* status line and headers, up to the location prefix */
+	struct chunk tail;              /* end of the location, other headers and the empty line */
 };
 
 /* Known HTTP methods */
@@ -231,6 +268,8 @@ struct http_msg {
 		} st;                          /* status line : field, length */
 	} sl;                                  /* start line */
 	unsigned long long hdr_content_len;    /* cache for parsed header value */
+	unsigned long long chunk_len;          /* body bytes left to forward in the current chunk */
+	unsigned int flags;                    /* HTTP_MSGF_* */
 	int err_pos;                           /* err handling: -2=block, -1=pass, 0+=detected */
 };
 
@@ -246,10 +285,27 @@ struct http_txn {
 	char *uri;			/* first line if log needed, NULL otherwise */
 	char *cli_cookie;		/* cookie presented by the client, in capture mode */
 	char *srv_cookie;		/* cookie presented by the server, in capture mode */
+	struct cache_obj *cache_obj;	/* response being stored into the backend's cache */
+	struct comp_ctx *comp_ctx;	/* compression state of the response, if compressed */
+	struct body_spill *spill;	/* request body which did not fit in the buffer, if any */
 	int status;			/* HTTP status from the server, negative if from proxy */
 	unsigned int flags;             /* transaction flags */
 };
 
+/* Request body data which did not fit in the request buffer while waiting for
+ * enough of the body to be analysed. They are given back to the buffer in the
+ * same order once the analysis is over.
+ */
+struct body_spill {
+	long long limit;                /* amount of body data waited for */
+	int len;                        /* number of bytes stored in <data> */
+	int sent;                       /* number of bytes given back to the buffer */
+	int replay;                     /* the analysis is over, data are being given back */
+	int max_len;                    /* buffer's read limit, kept aside while giving back */
+	unsigned int to_forward;        /* buffer's to_forward, kept aside while giving back */
+	char data[0];                   /* body_spill_size bytes of body data */
+};
+
 /* This structure is used by http_find_header() to return values of headers.
  * The header starts at <line>, the value at <line>+<val> for <vlen> bytes.
  */
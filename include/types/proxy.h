@@ -37,9 +37,13 @@
 
 #include <types/acl.h>
 #include <types/buffers.h>
+#include <types/cache.h>
+#include <types/compression.h>
 #include <types/freq_ctr.h>
+#include <types/histo.h>
 #include <types/httperr.h>
 #include <types/log.h>
+#include <types/map.h>
 #include <types/protocols.h>
 #include <types/session.h>
 #include <types/server.h>
@@ -119,6 +123,8 @@
 #define PR_O2_LOGERRORS	0x00000040      /* log errors and retries at level LOG_ERR */
 /* 0x80..0x800 already used in 1.4 */
 #define PR_O2_INDEPSTR	0x00001000	/* independant streams, don't update rex on write */
+#define PR_O2_REORDER	0x00002000	/* reorder equivalent filters by hit count */
+#define PR_O2_PIPELINE	0x00004000	/* process pipelined requests over one server connection */
 
 /* This structure is used to apply fast weighted round robin on a server group */
 struct fwrr_group {
@@ -155,6 +161,7 @@ struct proxy {
 		char *name;			/* default backend name during config parse */
 	} defbe;
 	struct list acl;                        /* ACL declared on this proxy */
+	unsigned int requires;                  /* ACL_USE_* needed by request processing, including reachable backends */
 	struct list block_cond;                 /* early blocking conditions (chained) */
 	struct list redirect_rules;             /* content redirecting rules (chained) */
 	struct list switching_rules;            /* content switching rules (chained) */
@@ -212,6 +219,8 @@ struct proxy {
 	int  capture_namelen;			/* length of the cookie name to match */
 	int  capture_len;			/* length of the string to be captured */
 	struct uri_auth *uri_auth;		/* if non-NULL, the (list of) per-URI authentications */
+	struct cache *cache;			/* if non-NULL, responses are cached there */
+	struct comp *comp;			/* if non-NULL, responses may be compressed */
 	char *monitor_uri;			/* a special URI to which we respond with HTTP/200 OK */
 	int monitor_uri_len;			/* length of the string above. 0 if unused */
 	struct list mon_fail_cond;              /* list of conditions to fail monitoring requests (chained) */
@@ -237,8 +246,14 @@ struct proxy {
 	unsigned int be_sps_max;		/* maximum of new sessions per second seen on the backend */
 	long long cum_feconn, cum_beconn;	/* cumulated number of processed sessions */
 	long long cum_lbconn;			/* cumulated number of sessions processed by load balancing */
+	struct histo histo[HISTO_TIMERS];	/* queue, connect and response times on the backend */
 	unsigned int maxconn;			/* max # of active sessions on the frontend */
 	unsigned int fe_sps_lim;		/* limit on new sessions per second on the frontend */
+	unsigned int log_sample_num;		/* log <num> out of <den> normal sessions ... */
+	unsigned int log_sample_den;		/* ... or all of them if <den> is 0 */
+	unsigned int log_rate_lim;		/* limit on normal sessions logged per second, 0=none */
+	unsigned int log_slow;			/* sessions lasting at least this (ms) are always logged, 0=none */
+	struct freq_ctr log_per_sec;		/* normal sessions logged per second */
 	unsigned int fullconn;			/* #conns on backend above which servers are used at full load */
 	struct in_addr except_net, except_mask; /* don't x-forward-for for this address. FIXME: should support IPv6 */
 	struct in_addr except_to;		/* don't x-original-to for this address. */
@@ -296,16 +311,19 @@ struct proxy {
 
 struct switching_rule {
 	struct list list;			/* list linked to from the proxy */
-	struct acl_cond *cond;			/* acl condition to meet */
+	struct acl_cond *cond;			/* acl condition to meet, may be NULL with a map */
 	union {
 		struct proxy *backend;		/* target backend */
 		char *name;			/* target backend name during config parsing */
 	} be;
+	struct map *map;			/* if not NULL, backends are looked up there */
+	struct map_key key;			/* request part used as the map key */
+	int line;				/* config line, for error reporting */
 };
 
 struct redirect_rule {
 	struct list list;                       /* list linked to from the proxy */
-	struct acl_cond *cond;                  /* acl condition to meet */
+	struct acl_cond *cond;                  /* acl condition to meet, may be NULL with a map */
 	int type;
 	int rdr_len;
 	char *rdr_str;
@@ -313,6 +331,9 @@ struct redirect_rule {
 	unsigned int flags;
 	int cookie_len;
 	char *cookie_str;
+	struct redirect_msg *msg;               /* response built from the above, except for maps */
+	struct map *map;                        /* for REDIRECT_TYPE_MAP, entries point to redirect_msg */
+	struct map_key key;                     /* request part used as the map key */
 };
 
 extern struct proxy *proxy;
@@ -31,6 +31,7 @@
 
 #include <types/buffers.h>
 #include <types/freq_ctr.h>
+#include <types/histo.h>
 #include <types/port_range.h>
 #include <types/proxy.h>
 #include <types/queue.h>
@@ -78,6 +79,7 @@ struct server {
 	int rdr_len;				/* the length of the redirection prefix */
 	char *cookie;				/* the id set in the cookie */
 	char *rdr_pfx;				/* the redirection prefix */
+	struct redirect_msg *rdr_msg;		/* the redirection, built from the prefix */
 
 	struct proxy *proxy;			/* the proxy this server belongs to */
 	int served;				/* # of active sessions currently being served (ie not pending) */
@@ -132,6 +134,7 @@ struct server {
 
 	long long bytes_in;			/* number of bytes transferred from the client to the server */
 	long long bytes_out;			/* number of bytes transferred from the server to the client */
+	struct histo histo[HISTO_TIMERS];	/* queue, connect and response times */
 	int puid;				/* proxy-unique server ID, used for SNMP */
 };
 
@@ -173,6 +173,7 @@ struct session {
 	struct server *prev_srv;		/* the server the was running on, after a redispatch, otherwise NULL */
 	struct pendconn *pend_pos;		/* if not NULL, points to the position in the pending queue */
 	struct http_txn txn;			/* current HTTP transaction being processed. Should become a list. */
+	unsigned char *acl_cache;		/* ACL results for the current request, indexed by acl->cache_idx */
 	int ana_state;				/* analyser state, used by analysers, always set to zero between them */
 	struct {
 		int logwait;			/* log fields waiting to be collected : LW_* */
@@ -212,6 +213,19 @@ struct session {
 			int ptr;		/* <0: headers, >=0 : text pointer to restart from */
 			int bol;		/* pointer to beginning of current line */
 		} errors;
+		struct {
+			int iid;		/* if >= 0, ID of the proxy to filter on */
+			struct proxy *px;	/* current proxy being dumped, NULL = not started yet. */
+			unsigned int chain;	/* chain being dumped, 0 = block, 1 = req, 2 = rsp */
+			unsigned int pos;	/* position of the next rule to dump in the chain */
+		} filters;
+		struct {
+			int iid;		/* if >= 0, ID of the proxy to filter on */
+			struct proxy *px;	/* current proxy being dumped, NULL = not started yet. */
+			struct server *sv;	/* current server being dumped, if <in_srv> is set */
+			unsigned int in_srv;	/* 0 = dumping the backend, 1 = dumping the servers */
+			unsigned int timer;	/* next timer to dump, HISTO_QUEUE...HISTO_RESPONSE */
+		} histo;
 	} data_ctx;				/* used by produce_content to dump the stats right now */
 	unsigned int uniq_id;			/* unique ID used for the traces */
 };
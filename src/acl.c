@@ -11,11 +11,16 @@
  */
 
 #include <ctype.h>
+#include <errno.h>
 #include <stdio.h>
 #include <string.h>
 
+#include <common/actrie.h>
 #include <common/config.h>
+#include <common/memory.h>
 #include <common/mini-clist.h>
+#include <common/pfxtree.h>
+#include <common/regex.h>
 #include <common/standard.h>
 
 #include <proto/acl.h>
@@ -43,6 +48,10 @@ const unsigned int filt_cap[] = {
 	[ACL_HOOK_RTR_FE_HTTP_OUT]    = ACL_USE_REQ_PERMANENT|ACL_USE_REQ_CACHEABLE|ACL_USE_L4RTR_ANY|ACL_USE_L7RTR_ANY,
 };
 
+/* pool of per-session ACL result caches, and size of each of them */
+struct pool_head *pool2_acl_cache = NULL;
+unsigned int acl_cache_size = 0;
+
 /* List head of all known ACL keywords */
 static struct acl_kw_list acl_keywords = {
 	.list = LIST_HEAD_INIT(acl_keywords.list)
@@ -164,6 +173,31 @@ int acl_match_reg(struct acl_test *test, struct acl_pattern *pattern)
 	return ret;
 }
 
+/* Looks up the string in <test> among the exact strings indexed in <expr>.
+ * Returns ACL_PAT_PASS if one of them matches, otherwise ACL_PAT_FAIL. The
+ * hash ignores case so that patterns with and without ACL_PAT_F_IGNORE_CASE
+ * may share the same index.
+ */
+static int acl_lookup_str(struct acl_test *test, struct acl_expr *expr)
+{
+	struct eb32_node *node;
+	struct acl_pattern *pattern;
+	unsigned int hash;
+
+	if (!expr->str_tree.b[EB_LEFT])
+		return ACL_PAT_FAIL;
+
+	hash = hash_nocase(test->ptr, test->len);
+	for (node = eb32_lookup(&expr->str_tree, hash);
+	     node && node->key == hash;
+	     node = eb32_next(node)) {
+		pattern = eb32_entry(node, struct acl_pattern, node);
+		if (acl_match_str(test, pattern) == ACL_PAT_PASS)
+			return ACL_PAT_PASS;
+	}
+	return ACL_PAT_FAIL;
+}
+
 /* Checks that the pattern matches the beginning of the tested string. */
 int acl_match_beg(struct acl_test *test, struct acl_pattern *pattern)
 {
@@ -225,6 +259,76 @@ int acl_match_sub(struct acl_test *test, struct acl_pattern *pattern)
 	return ACL_PAT_FAIL;
 }
 
+/* Looks up the string in <test> among the prefixes indexed in the trie of
+ * <expr>. Only the patterns met along the path are checked.
+ */
+static int acl_lookup_beg(struct acl_test *test, struct acl_expr *expr)
+{
+	struct ac_node *node = expr->str_trie.root;
+	struct acl_pattern *pattern;
+	int i;
+
+	for (i = 0; node && i < test->len; i++) {
+		node = ac_child(node, test->ptr[i]);
+		if (!node)
+			break;
+		list_for_each_entry(pattern, &node->entries, list)
+			if (acl_match_beg(test, pattern) == ACL_PAT_PASS)
+				return ACL_PAT_PASS;
+	}
+	return ACL_PAT_FAIL;
+}
+
+/* Looks up the string in <test> among the suffixes indexed in reverse order
+ * in the trie of <expr>.
+ */
+static int acl_lookup_end(struct acl_test *test, struct acl_expr *expr)
+{
+	struct ac_node *node = expr->str_trie.root;
+	struct acl_pattern *pattern;
+	int i;
+
+	for (i = test->len - 1; node && i >= 0; i--) {
+		node = ac_child(node, test->ptr[i]);
+		if (!node)
+			break;
+		list_for_each_entry(pattern, &node->entries, list)
+			if (acl_match_end(test, pattern) == ACL_PAT_PASS)
+				return ACL_PAT_PASS;
+	}
+	return ACL_PAT_FAIL;
+}
+
+/* Runs the string in <test> through the Aho-Corasick automaton built from
+ * the substrings of <expr>, so that all of them are searched in one pass.
+ * The automaton ignores case, so matches of case-sensitive patterns are
+ * checked again.
+ */
+static int acl_lookup_sub(struct acl_test *test, struct acl_expr *expr)
+{
+	struct ac_trie *trie = &expr->str_trie;
+	struct ac_node *node, *out;
+	struct acl_pattern *pattern;
+	int i;
+
+	if (ac_is_empty(trie))
+		return ACL_PAT_FAIL;
+
+	node = trie->root;
+	for (i = 0; i < test->len; i++) {
+		node = ac_next(trie, node, test->ptr[i]);
+		out = LIST_ISEMPTY(&node->entries) ? node->out : node;
+		for (; out; out = out->out) {
+			list_for_each_entry(pattern, &out->entries, list) {
+				if ((pattern->flags & ACL_PAT_F_IGNORE_CASE) ||
+				    memcmp(pattern->ptr.str, test->ptr + i + 1 - pattern->len, pattern->len) == 0)
+					return ACL_PAT_PASS;
+			}
+		}
+	}
+	return ACL_PAT_FAIL;
+}
+
 /* This one is used by other real functions. It checks that the pattern is
  * included inside the tested string, but enclosed between the specified
  * delimitor, or a '/' or a '?' or at the beginning or end of the string.
@@ -310,6 +414,22 @@ int acl_match_ip(struct acl_test *test, struct acl_pattern *pattern)
 {
 	struct in_addr *s;
 
+	if (pattern->flags & ACL_PAT_F_IPV6) {
+		const unsigned char *a, *p;
+		int plen = pattern->val.ipv6.plen;
+
+		if (test->i != AF_INET6)
+			return ACL_PAT_FAIL;
+
+		a = (const unsigned char *)test->ptr;
+		p = pattern->val.ipv6.addr.s6_addr;
+		if (memcmp(a, p, plen >> 3) != 0)
+			return ACL_PAT_FAIL;
+		if ((plen & 7) && ((a[plen >> 3] ^ p[plen >> 3]) & (0xFF << (8 - (plen & 7)))))
+			return ACL_PAT_FAIL;
+		return ACL_PAT_PASS;
+	}
+
 	if (test->i != AF_INET)
 		return ACL_PAT_FAIL;
 
@@ -319,6 +439,26 @@ int acl_match_ip(struct acl_test *test, struct acl_pattern *pattern)
 	return ACL_PAT_FAIL;
 }
 
+/* Looks up the address in <test> among the networks indexed in the prefix
+ * trees of <expr>. Returns ACL_PAT_PASS if any of them contains it, otherwise
+ * ACL_PAT_FAIL. Patterns which could not be indexed are still in the list.
+ */
+static int acl_lookup_ip(struct acl_test *test, struct acl_expr *expr)
+{
+	struct pfx_root *tree;
+
+	if (test->i == AF_INET)
+		tree = &expr->ip4_tree;
+	else if (test->i == AF_INET6)
+		tree = &expr->ip6_tree;
+	else
+		return ACL_PAT_FAIL;
+
+	if (!pfx_is_empty(tree) && pfx_lookup_longest(tree, test->ptr))
+		return ACL_PAT_PASS;
+	return ACL_PAT_FAIL;
+}
+
 /* Parse a string. It is allocated and duplicated. */
 int acl_parse_str(const char **text, struct acl_pattern *pattern, int *opaque)
 {
@@ -536,19 +676,49 @@ int acl_parse_dotted_ver(const char **text, struct acl_pattern *pattern, int *op
 	return skip + 1;
 }
 
-/* Parse an IP address and an optional mask in the form addr[/mask].
- * The addr may either be an IPv4 address or a hostname. The mask
- * may either be a dotted mask or a number of bits. Returns 1 if OK,
- * otherwise 0.
+/* Parse an IP network in the form addr[/mask]. If the text contains a colon,
+ * it is an IPv6 address with an optional prefix length. Otherwise the addr may
+ * either be an IPv4 address or a hostname, and the mask may either be a dotted
+ * mask or a number of bits. Returns 1 if OK, otherwise 0.
  */
 int acl_parse_ip(const char **text, struct acl_pattern *pattern, int *opaque)
 {
+	if (strchr(*text, ':') != NULL) {
+		if (!str62net(*text, &pattern->val.ipv6.addr, &pattern->val.ipv6.plen))
+			return 0;
+		pattern->flags |= ACL_PAT_F_IPV6;
+		return 1;
+	}
+
 	if (str2net(*text, &pattern->val.ipv4.addr, &pattern->val.ipv4.mask))
 		return 1;
 	else
 		return 0;
 }
 
+/* Inserts the IP network of <pattern> into the relevant prefix tree of
+ * <expr>. Returns 1 if it was indexed, in which case the pattern is not
+ * needed anymore, or 0 if it must be kept in the pattern list (eg: the
+ * netmask is not contiguous, or memory is lacking).
+ */
+static int acl_index_ip(struct acl_expr *expr, struct acl_pattern *pattern)
+{
+	unsigned int mask;
+	int plen;
+
+	if (pattern->flags & ACL_PAT_F_IPV6)
+		return pfx_insert(&expr->ip6_tree, &pattern->val.ipv6.addr,
+				  pattern->val.ipv6.plen, NULL) != NULL;
+
+	mask = ntohl(pattern->val.ipv4.mask.s_addr);
+	for (plen = 0; mask & 0x80000000; plen++)
+		mask <<= 1;
+	if (mask)
+		return 0;
+
+	return pfx_insert(&expr->ip4_tree, &pattern->val.ipv4.addr, plen, NULL) != NULL;
+}
+
 /*
  * Registers the ACL keyword list <kwl> as a list of valid keywords for next
  * parsing sessions.
@@ -623,16 +793,150 @@ static void free_pattern_list(struct list *head)
 		free_pattern(pat);
 }
 
+/* Looks up the value in <test> among the patterns of <expr> which were indexed
+ * at parse time. Returns ACL_PAT_PASS if one of them matches, otherwise
+ * ACL_PAT_FAIL. The patterns left in the list must still be checked.
+ */
+static int acl_lookup_indexed(struct acl_test *test, struct acl_expr *expr)
+{
+	if (expr->kw->match == acl_match_ip)
+		return acl_lookup_ip(test, expr);
+	else if (expr->kw->match == acl_match_str)
+		return acl_lookup_str(test, expr);
+	else if (expr->kw->match == acl_match_beg)
+		return acl_lookup_beg(test, expr);
+	else if (expr->kw->match == acl_match_end)
+		return acl_lookup_end(test, expr);
+	else if (expr->kw->match == acl_match_sub)
+		return acl_lookup_sub(test, expr);
+	return ACL_PAT_FAIL;
+}
+
+static void free_pattern_tree(struct eb_root *root)
+{
+	struct eb32_node *node, *next;
+
+	node = eb32_first(root);
+	while (node) {
+		next = eb32_next(node);
+		eb32_delete(node);
+		free_pattern(eb32_entry(node, struct acl_pattern, node));
+		node = next;
+	}
+}
+
 static struct acl_expr *prune_acl_expr(struct acl_expr *expr)
 {
 	free_pattern_list(&expr->patterns);
 	LIST_INIT(&expr->patterns);
+	free_pattern_tree(&expr->str_tree);
+	ac_free(&expr->str_trie, free_pattern_list);
+	pfx_free(&expr->ip4_tree, NULL);
+	pfx_free(&expr->ip6_tree, NULL);
 	if (expr->arg.str)
 		free(expr->arg.str);
 	expr->kw->use_cnt--;
 	return expr;
 }
 
+/* Adds the freshly parsed <pattern> to expression <expr>. Patterns which can
+ * be looked up without scanning the whole list are indexed, the other ones
+ * are appended to the list.
+ */
+static void acl_add_pattern(struct acl_expr *expr, struct acl_pattern *pattern)
+{
+	if (expr->kw->match == acl_match_ip && acl_index_ip(expr, pattern)) {
+		free_pattern(pattern);
+		return;
+	}
+
+	if (expr->kw->match == acl_match_str) {
+		pattern->node.key = hash_nocase(pattern->ptr.str, pattern->len);
+		eb32_insert(&expr->str_tree, &pattern->node);
+		return;
+	}
+
+	if ((expr->kw->match == acl_match_beg || expr->kw->match == acl_match_end ||
+	     expr->kw->match == acl_match_sub) && pattern->len > 0) {
+		struct ac_node *node;
+
+		/* suffixes are stored reversed so that they can be looked up
+		 * from the end of the string.
+		 */
+		node = ac_insert(&expr->str_trie, pattern->ptr.str, pattern->len,
+				 expr->kw->match == acl_match_end);
+		if (node) {
+			LIST_ADDQ(&node->entries, &pattern->list);
+			return;
+		}
+	}
+
+	LIST_ADDQ(&expr->patterns, &pattern->list);
+}
+
+/* Reads patterns from file <filename> for expression <expr>, one per line.
+ * Leading and trailing spaces are ignored, as well as empty lines and lines
+ * starting with a '#'. Each pattern gets <patflags>. Returns 1 if OK, or 0
+ * after emitting an alert if the file cannot be read or contains an invalid
+ * pattern.
+ */
+static int acl_read_patterns_from_file(struct acl_expr *expr, const char *filename, int patflags)
+{
+	struct acl_pattern *pattern;
+	const char *args[2];
+	char line[LINESIZE];
+	char *beg, *end;
+	int opaque = 0;
+	int linenum = 0;
+	FILE *file;
+
+	file = fopen(filename, "r");
+	if (!file) {
+		Alert("failed to open ACL pattern file <%s> : %s.\n", filename, strerror(errno));
+		return 0;
+	}
+
+	while (fgets(line, sizeof(line), file) != NULL) {
+		linenum++;
+
+		beg = line;
+		while (*beg == ' ' || *beg == '\t')
+			beg++;
+		end = beg + strlen(beg);
+		while (end > beg && isspace((unsigned char)end[-1]))
+			end--;
+		*end = '\0';
+
+		if (!*beg || *beg == '#')
+			continue;
+
+		pattern = (struct acl_pattern *)calloc(1, sizeof(*pattern));
+		if (!pattern) {
+			Alert("out of memory while loading ACL pattern file <%s>.\n", filename);
+			goto out_close;
+		}
+		pattern->flags = patflags;
+
+		/* patterns from files are always made of one single word */
+		args[0] = beg;
+		args[1] = "";
+		if (expr->kw->parse(args, pattern, &opaque) != 1) {
+			Alert("invalid pattern '%s' at line %d of ACL pattern file <%s>.\n",
+			      beg, linenum, filename);
+			free_pattern(pattern);
+			goto out_close;
+		}
+		acl_add_pattern(expr, pattern);
+	}
+
+	fclose(file);
+	return 1;
+
+ out_close:
+	fclose(file);
+	return 0;
+}
+
 /* Parse an ACL expression starting at <args>[0], and return it.
  * Right now, the only accepted syntax is :
  * <subject> [<value>...]
@@ -657,6 +961,10 @@ struct acl_expr *parse_acl_expr(const char **args)
 	expr->kw = aclkw;
 	aclkw->use_cnt++;
 	LIST_INIT(&expr->patterns);
+	pfx_init(&expr->ip4_tree, sizeof(struct in_addr));
+	pfx_init(&expr->ip6_tree, sizeof(struct in6_addr));
+	expr->str_tree = EB_ROOT;
+	ac_init(&expr->str_trie);
 	expr->arg.str = NULL;
 	expr->arg_len = 0;
 
@@ -681,15 +989,20 @@ struct acl_expr *parse_acl_expr(const char **args)
 
 	/* check for options before patterns. Supported options are :
 	 *   -i : ignore case for all patterns by default
-	 *   -f : read patterns from those files
+	 *   -f : read patterns from the file which follows
 	 *   -- : everything after this is not an option
 	 */
 	patflags = 0;
 	while (**args == '-') {
 		if ((*args)[1] == 'i')
 			patflags |= ACL_PAT_F_IGNORE_CASE;
-		else if ((*args)[1] == 'f')
-			patflags |= ACL_PAT_F_FROM_FILE;
+		else if ((*args)[1] == 'f') {
+			if (!*args[1])
+				goto out_free_expr;
+			if (!acl_read_patterns_from_file(expr, args[1], patflags | ACL_PAT_F_FROM_FILE))
+				goto out_free_expr;
+			args++;
+		}
 		else if ((*args)[1] == '-') {
 			args++;
 			break;
@@ -711,10 +1024,14 @@ struct acl_expr *parse_acl_expr(const char **args)
 		ret = aclkw->parse(args, pattern, &opaque);
 		if (!ret)
 			goto out_free_pattern;
-		LIST_ADDQ(&expr->patterns, &pattern->list);
 		args += ret;
+		acl_add_pattern(expr, pattern);
 	}
 
+	/* substrings are searched all at once by an Aho-Corasick automaton */
+	if (aclkw->match == acl_match_sub && !ac_build(&expr->str_trie))
+		goto out_free_expr;
+
 	return expr;
 
  out_free_pattern:
@@ -786,6 +1103,7 @@ struct acl *parse_acl(const char **args, struct list *known_acl)
 		LIST_INIT(&cur_acl->expr);
 		LIST_ADDQ(known_acl, &cur_acl->list);
 		cur_acl->name = name;
+		cur_acl->cache_idx = -1;
 	}
 
 	cur_acl->requires |= acl_expr->kw->requires;
@@ -860,6 +1178,7 @@ struct acl *find_acl_default(const char *acl_name, struct list *known_acl)
 		goto out_free_name;
 
 	cur_acl->name = name;
+	cur_acl->cache_idx = -1;
 	cur_acl->requires |= acl_expr->kw->requires;
 	LIST_INIT(&cur_acl->expr);
 	LIST_ADDQ(&cur_acl->expr, &acl_expr->list);
@@ -885,8 +1204,10 @@ struct acl_cond *prune_acl_cond(struct acl_cond *cond)
 
 	/* iterate through all term suites and free all terms and all suites */
 	list_for_each_entry_safe(suite, tmp_suite, &cond->suites, list) {
-		list_for_each_entry_safe(term, tmp_term, &suite->terms, list)
+		list_for_each_entry_safe(term, tmp_term, &suite->terms, list) {
+			term->acl->use_cnt--;
 			free(term);
+		}
 		free(suite);
 	}
 	return cond;
@@ -956,6 +1277,7 @@ struct acl_cond *parse_acl_cond(const char **args, struct list *known_acl, int p
 
 		cur_term->acl = cur_acl;
 		cur_term->neg = neg;
+		cur_acl->use_cnt++;
 		cond->requires |= cur_acl->requires;
 
 		if (!cur_suite) {
@@ -1004,6 +1326,11 @@ int acl_exec_cond(struct acl_cond *cond, struct proxy *px, struct session *l4, v
 	struct acl_pattern *pattern;
 	struct acl_test test;
 	int acl_res, suite_res, cond_res;
+	unsigned char *cache;
+	unsigned int test_flags;
+
+	/* results are never cached while data are still incomplete */
+	cache = (l4 && !(dir & ACL_PARTIAL)) ? l4->acl_cache : NULL;
 
 	/* We're doing a logical OR between conditions so we initialize to FAIL.
 	 * The MISS status is propagated down from the suites.
@@ -1022,24 +1349,29 @@ int acl_exec_cond(struct acl_cond *cond, struct proxy *px, struct session *l4, v
 		list_for_each_entry(term, &suite->terms, list) {
 			acl = term->acl;
 
-			/* FIXME: use cache !
-			 * check acl->cache_idx for this.
-			 */
+			if (cache && acl->cache_idx >= 0 &&
+			    (cache[acl->cache_idx] & ACL_CACHE_VALID)) {
+				acl_res = cache[acl->cache_idx] & ACL_CACHE_RES_MASK;
+				goto cached;
+			}
 
 			/* ACL result not cached. Let's scan all the expressions
 			 * and use the first one to match.
 			 */
 			acl_res = ACL_PAT_FAIL;
+			test_flags = 0;
 			list_for_each_entry(expr, &acl->expr, list) {
 				/* we need to reset context and flags */
 				memset(&test, 0, sizeof(test));
 			fetch_next:
 				if (!expr->kw->fetch(px, l4, l7, dir, expr, &test)) {
+					test_flags |= test.flags;
 					/* maybe we could not fetch because of missing data */
 					if (test.flags & ACL_TEST_F_MAY_CHANGE && dir & ACL_PARTIAL)
 						acl_res |= ACL_PAT_MISS;
 					continue;
 				}
+				test_flags |= test.flags;
 
 				if (test.flags & ACL_TEST_F_RES_SET) {
 					if (test.flags & ACL_TEST_F_RES_PASS)
@@ -1048,22 +1380,19 @@ int acl_exec_cond(struct acl_cond *cond, struct proxy *px, struct session *l4, v
 						acl_res |= ACL_PAT_FAIL;
 				}
 				else {
+					/* indexed patterns are looked up first */
+					acl_res |= acl_lookup_indexed(&test, expr);
+
 					/* call the match() function for all tests on this value */
 					list_for_each_entry(pattern, &expr->patterns, list) {
-						acl_res |= expr->kw->match(&test, pattern);
 						if (acl_res == ACL_PAT_PASS)
 							break;
+						acl_res |= expr->kw->match(&test, pattern);
 					}
 				}
 				/*
 				 * OK now acl_res holds the result of this expression
 				 * as one of ACL_PAT_FAIL, ACL_PAT_MISS or ACL_PAT_PASS.
-				 *
-				 * Then if (!MISS) we can cache the result, and put
-				 * (test.flags & ACL_TEST_F_VOLATILE) in the cache flags.
-				 *
-				 * FIXME: implement cache.
-				 *
 				 */
 
 				/* now we may have some cleanup to do */
@@ -1086,6 +1415,23 @@ int acl_exec_cond(struct acl_cond *cond, struct proxy *px, struct session *l4, v
 				if (test.flags & ACL_TEST_F_MAY_CHANGE && dir & ACL_PARTIAL)
 					acl_res |= ACL_PAT_MISS;
 			}
+
+			/* If (!MISS) we can cache the result, unless it is only
+			 * valid for this test (eg: time, counters). Results which
+			 * depend on rewritable contents are marked volatile so that
+			 * they get flushed upon rewrite.
+			 */
+			if (cache && acl->cache_idx >= 0 && acl_res != ACL_PAT_MISS &&
+			    !(test_flags & (ACL_TEST_F_VOL_TEST | ACL_TEST_F_MAY_CHANGE)) &&
+			    !(acl->requires & (ACL_USE_TCP4_VOLATILE | ACL_USE_TCP6_VOLATILE | ACL_USE_TCP_VOLATILE))) {
+				cache[acl->cache_idx] = acl_res | ACL_CACHE_VALID;
+				if ((test_flags & (ACL_TEST_F_VOL_HDR | ACL_TEST_F_VOL_1ST | ACL_TEST_F_VOL_TXN)) ||
+				    (acl->requires & (ACL_USE_L4REQ_VOLATILE | ACL_USE_L7REQ_VOLATILE |
+						      ACL_USE_L4RTR_VOLATILE | ACL_USE_L7RTR_VOLATILE |
+						      ACL_USE_HDR_VOLATILE)))
+					cache[acl->cache_idx] |= ACL_CACHE_VOLATILE;
+			}
+		cached:
 			/*
 			 * Here we have the result of an ACL (cached or not).
 			 * ACLs are combined, negated or not, to form conditions.
@@ -1109,6 +1455,53 @@ int acl_exec_cond(struct acl_cond *cond, struct proxy *px, struct session *l4, v
 	return cond_res;
 }
 
+/* Assigns a slot in the per-session ACL result cache to every ACL of proxy
+ * <px> referenced by more than one condition, since only those may be
+ * evaluated more than once per request. Returns the number of slots assigned.
+ */
+int acl_assign_cache_idx(struct proxy *px)
+{
+	struct acl *acl;
+	int assigned = 0;
+
+	list_for_each_entry(acl, &px->acl, list) {
+		if (acl->use_cnt > 1) {
+			acl->cache_idx = acl_cache_size++;
+			assigned++;
+		}
+		else
+			acl->cache_idx = -1;
+	}
+	return assigned;
+}
+
+/* To be called when condition <cond> from the list starting at <head> has just
+ * matched. The list must only hold conditions leading to the same action (eg:
+ * "block" rules), so that their order does not matter. The condition is moved
+ * before its predecessor if it matches more often, and scores are halved for
+ * the whole list when one of them reaches EXP_SCORE_MAX. The caller must not
+ * continue to iterate over the list after calling this function.
+ */
+void promote_acl_cond(struct list *head, struct acl_cond *cond)
+{
+	struct acl_cond *prev;
+
+	if (++cond->score >= EXP_SCORE_MAX) {
+		list_for_each_entry(prev, head, list)
+			prev->score >>= 1;
+	}
+
+	if (cond->list.p == head)
+		return;
+
+	prev = LIST_ELEM(cond->list.p, struct acl_cond *, list);
+	if (cond->score <= prev->score)
+		return;
+
+	LIST_DEL(&cond->list);
+	LIST_ADDQ(&prev->list, &cond->list);
+}
+
 
 /* Reports a pointer to the first ACL used in condition <cond> which requires
  * at least one of the USE_FLAGS in <require>. Returns NULL if none matches.
@@ -0,0 +1,163 @@
+/*
+ * Byte tries and Aho-Corasick automatons for multi-string matching.
+ *
+ * Copyright 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+
+#include <common/actrie.h>
+#include <common/config.h>
+
+/* allocates a node for byte <c> at depth <depth> */
+static struct ac_node *ac_new_node(unsigned char c, unsigned int depth)
+{
+	struct ac_node *node;
+
+	node = calloc(1, sizeof(*node));
+	if (!node)
+		return NULL;
+	LIST_INIT(&node->entries);
+	node->c = c;
+	node->depth = depth;
+	return node;
+}
+
+/* Inserts the <len> bytes of <str> into <trie>, in reverse order if <rev> is
+ * non-zero, and returns the node where the string ends. The caller should
+ * then append its entry to the node's <entries> list. Returns NULL if memory
+ * is lacking.
+ */
+struct ac_node *ac_insert(struct ac_trie *trie, const char *str, int len, int rev)
+{
+	struct ac_node *node, *child;
+	unsigned char c;
+	int i;
+
+	if (!trie->root) {
+		trie->root = ac_new_node(0, 0);
+		if (!trie->root)
+			return NULL;
+		trie->nodes = 1;
+	}
+
+	node = trie->root;
+	for (i = 0; i < len; i++) {
+		c = tolower((unsigned char)str[rev ? len - 1 - i : i]);
+		child = ac_child(node, c);
+		if (!child) {
+			child = ac_new_node(c, node->depth + 1);
+			if (!child)
+				return NULL;
+			child->next = node->child;
+			node->child = child;
+			trie->nodes++;
+		}
+		node = child;
+	}
+	trie->count++;
+	return node;
+}
+
+/* Computes the failure links of <trie> so that ac_next() may be used. Must be
+ * called again after any insertion. Returns 0 if memory is lacking, otherwise
+ * non-zero.
+ */
+int ac_build(struct ac_trie *trie)
+{
+	struct ac_node *root = trie->root;
+	struct ac_node **queue, *node, *child, *fail, *next;
+	unsigned int head, tail;
+	int c;
+
+	if (!root)
+		return 1;
+
+	if (!trie->root_next) {
+		trie->root_next = calloc(256, sizeof(*trie->root_next));
+		if (!trie->root_next)
+			return 0;
+	}
+
+	/* every node is queued exactly once during the breadth-first walk */
+	queue = malloc(trie->nodes * sizeof(*queue));
+	if (!queue)
+		return 0;
+
+	for (c = 0; c < 256; c++)
+		trie->root_next[c] = root;
+
+	root->fail = root;
+	root->out = NULL;
+	head = tail = 0;
+	for (child = root->child; child; child = child->next) {
+		trie->root_next[child->c] = child;
+		child->fail = root;
+		child->out = NULL;
+		queue[tail++] = child;
+	}
+
+	while (head < tail) {
+		node = queue[head++];
+		for (child = node->child; child; child = child->next) {
+			/* the longest proper suffix of the child's string is
+			 * found by following the parent's failure links.
+			 */
+			fail = node->fail;
+			while (1) {
+				next = ac_child(fail, child->c);
+				if (next) {
+					fail = next;
+					break;
+				}
+				if (fail == root)
+					break;
+				fail = fail->fail;
+			}
+			child->fail = fail;
+			child->out = LIST_ISEMPTY(&fail->entries) ? fail->out : fail;
+			queue[tail++] = child;
+		}
+	}
+	free(queue);
+	return 1;
+}
+
+/* recursively frees <node>, its children and its siblings */
+static void ac_free_node(struct ac_node *node, void (*free_entries)(struct list *))
+{
+	struct ac_node *next;
+
+	while (node) {
+		next = node->next;
+		ac_free_node(node->child, free_entries);
+		if (free_entries)
+			free_entries(&node->entries);
+		free(node);
+		node = next;
+	}
+}
+
+/* Releases all nodes of <trie>, calling <free_entries> on each list of
+ * entries if it is not NULL. The trie is empty upon return.
+ */
+void ac_free(struct ac_trie *trie, void (*free_entries)(struct list *))
+{
+	ac_free_node(trie->root, free_entries);
+	free(trie->root_next);
+	ac_init(trie);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -1210,9 +1210,16 @@ struct server *get_server_ph_post(struct session *s)
 	if (px->lbprm.tot_weight == 0)
 		return NULL;
 
-        body = msg->sol[msg->eoh] == '\r' ? msg->eoh + 2 : msg->eoh + 1;
-        len  = req->l - body;
-        params = req->data + body;
+	if (txn->spill) {
+		/* the body did not fit in the buffer */
+		len = txn->spill->len;
+		params = txn->spill->data;
+	}
+	else {
+		body = msg->sol[msg->eoh] == '\r' ? msg->eoh + 2 : msg->eoh + 1;
+		len  = req->l - body;
+		params = req->data + body;
+	}
 
 	if ( len == 0 )
 		return NULL;
@@ -1225,27 +1232,17 @@ struct server *get_server_ph_post(struct session *s)
 	/* if the message is chunked, we skip the chunk size, but use the value as len */
 	http_find_header2("Transfer-Encoding", 17, msg->sol, &txn->hdr_idx, &ctx);
 	if (ctx.idx && ctx.vlen >= 7 && strncasecmp(ctx.line+ctx.val, "chunked", 7) == 0) {
-		unsigned int chunk = 0;
-		while ( params < (req->data+req->max_len) && !HTTP_IS_CRLF(*params)) {
-			char c = *params;
-			if (ishex(c)) {
-				unsigned int hex = toupper(c) - '0';
-				if ( hex > 9 )
-					hex -= 'A' - '9' - 1;
-				chunk = (chunk << 4) | hex;
-			}
-			else
-				return NULL;
-			params++;
-			len--;
-		}
-		/* spec says we get CRLF */
-		if (HTTP_IS_CRLF(*params) && HTTP_IS_CRLF(params[1]))
-			params += 2;
-		else
+		unsigned int chunk;
+		int ret;
+
+		ret = http_parse_chunk_size(req, params, len, &chunk);
+		if (ret <= 0)
 			return NULL;
+		params += ret;
+		len -= ret;
 		/* ok we have some encoded length, just inspect the first chunk */
-		len = chunk;
+		if (chunk < len)
+			len = chunk;
 	}
 
 	p = params;
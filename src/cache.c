@@ -0,0 +1,227 @@
+/*
+ * HTTP objects cache.
+ *
+ * Copyright 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/config.h>
+#include <common/eb32tree.h>
+#include <common/mini-clist.h>
+#include <common/standard.h>
+#include <common/ticks.h>
+#include <common/time.h>
+
+#include <types/cache.h>
+
+#include <proto/cache.h>
+
+/* Returns the memory used by object <obj>. */
+static inline unsigned int cache_obj_size(const struct cache_obj *obj)
+{
+	return sizeof(*obj) + obj->key_len + obj->len;
+}
+
+/* Removes object <obj> from <cache> and releases it. */
+static void cache_remove(struct cache *cache, struct cache_obj *obj)
+{
+	LIST_DEL(&obj->list);
+	eb32_delete(&obj->node);
+	eb32_delete(&obj->lru);
+	cache->used -= cache_obj_size(obj);
+	free(obj);
+}
+
+/* Gives object <obj> of <cache> the most recent use date. Dates wrap, so
+ * the least recently used object is the first one after the last date, if
+ * any, otherwise the first one of the tree.
+ */
+static void cache_touch(struct cache *cache, struct cache_obj *obj)
+{
+	eb32_delete(&obj->lru);
+	obj->lru.key = ++cache->last_use;
+	eb32_insert(&cache->by_use, &obj->lru);
+}
+
+/* Returns the least recently used object of <cache>, or NULL if it is empty. */
+static struct cache_obj *cache_oldest(struct cache *cache)
+{
+	struct eb32_node *node;
+
+	node = eb32_lookup_ge(&cache->by_use, cache->last_use + 1);
+	if (!node)
+		node = eb32_first(&cache->by_use);
+	if (!node)
+		return NULL;
+	return eb32_entry(node, struct cache_obj, lru);
+}
+
+/* Returns the object of <cache> stored under the <len> bytes of <key>, or
+ * NULL, without checking its expiration date.
+ */
+static struct cache_obj *cache_find(struct cache *cache, const char *key, int len)
+{
+	struct eb32_node *node;
+	struct cache_obj *obj;
+	unsigned int hash;
+
+	hash = hash_nocase(key, len);
+	for (node = eb32_lookup(&cache->by_hash, hash);
+	     node && node->key == hash;
+	     node = eb32_next(node)) {
+		obj = eb32_entry(node, struct cache_obj, node);
+		if (obj->key_len == len && memcmp(obj->key, key, len) == 0)
+			return obj;
+	}
+	return NULL;
+}
+
+/* Returns a new empty cache limited to <size> bytes, storing responses of at
+ * most <max_obj> bytes for at most <max_age> milliseconds, or NULL if memory
+ * is lacking.
+ */
+struct cache *cache_new(unsigned int size, unsigned int max_obj, unsigned int max_age)
+{
+	struct cache *cache;
+
+	cache = calloc(1, sizeof(*cache));
+	if (!cache)
+		return NULL;
+
+	cache->size = size;
+	cache->max_obj = max_obj;
+	cache->max_age = max_age;
+	cache->by_hash = EB_ROOT;
+	cache->by_use = EB_ROOT;
+	LIST_INIT(&cache->objects);
+	return cache;
+}
+
+/* Releases cache <cache> and all of its objects. */
+void cache_free(struct cache *cache)
+{
+	struct cache_obj *obj, *back;
+
+	if (!cache)
+		return;
+
+	list_for_each_entry_safe(obj, back, &cache->objects, list)
+		cache_remove(cache, obj);
+	free(cache);
+}
+
+/* Returns a new object for the <len> bytes of key <key>, with no data yet, or
+ * NULL if memory is lacking. It is not part of any cache.
+ */
+struct cache_obj *cache_obj_new(const char *key, int len)
+{
+	struct cache_obj *obj;
+
+	obj = malloc(sizeof(*obj) + len);
+	if (!obj)
+		return NULL;
+
+	memset(obj, 0, sizeof(*obj));
+	obj->key = (char *)(obj + 1);
+	obj->key_len = len;
+	obj->data = obj->key + len;
+	memcpy(obj->key, key, len);
+	return obj;
+}
+
+/* Reallocates object <obj> so that it may store a response of <len> bytes.
+ * The object must not be part of any cache. Returns the new object, or NULL
+ * after releasing the old one if memory is lacking.
+ */
+struct cache_obj *cache_obj_resize(struct cache_obj *obj, int len)
+{
+	struct cache_obj *new;
+
+	new = realloc(obj, sizeof(*obj) + obj->key_len + len);
+	if (!new) {
+		free(obj);
+		return NULL;
+	}
+
+	new->key = (char *)(new + 1);
+	new->data = new->key + new->key_len;
+	new->len = len;
+	return new;
+}
+
+/* Returns the object of <cache> stored under the <len> bytes of <key> and
+ * marks it as the most recently used one, or NULL if there is none or if it
+ * has expired.
+ */
+struct cache_obj *cache_lookup(struct cache *cache, const char *key, int len)
+{
+	struct cache_obj *obj;
+
+	obj = cache_find(cache, key, len);
+	if (!obj)
+		return NULL;
+
+	if (tick_is_expired(obj->expire, now_ms)) {
+		cache_remove(cache, obj);
+		return NULL;
+	}
+
+	cache_touch(cache, obj);
+	return obj;
+}
+
+/* Stores object <obj> into <cache>, replacing any object with the same key,
+ * and evicting the least recently used ones if memory is lacking. The object
+ * is released if it cannot fit.
+ */
+void cache_insert(struct cache *cache, struct cache_obj *obj)
+{
+	struct cache_obj *old;
+	unsigned int size = cache_obj_size(obj);
+
+	old = cache_find(cache, obj->key, obj->key_len);
+	if (old)
+		cache_remove(cache, old);
+
+	if (size > cache->size) {
+		free(obj);
+		return;
+	}
+
+	while (cache->used + size > cache->size)
+		cache_remove(cache, cache_oldest(cache));
+
+	obj->node.key = hash_nocase(obj->key, obj->key_len);
+	eb32_insert(&cache->by_hash, &obj->node);
+	obj->lru.key = ++cache->last_use;
+	eb32_insert(&cache->by_use, &obj->lru);
+	LIST_ADDQ(&cache->objects, &obj->list);
+	cache->used += size;
+}
+
+/* Removes from <cache> the object stored under the <len> bytes of <key>, if
+ * any.
+ */
+void cache_delete(struct cache *cache, const char *key, int len)
+{
+	struct cache_obj *obj;
+
+	obj = cache_find(cache, key, len);
+	if (obj)
+		cache_remove(cache, obj);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
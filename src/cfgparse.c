@@ -37,10 +37,13 @@
 #include <proto/acl.h>
 #include <proto/backend.h>
 #include <proto/buffers.h>
+#include <proto/cache.h>
 #include <proto/checks.h>
+#include <proto/compression.h>
 #include <proto/dumpstats.h>
 #include <proto/httperr.h>
 #include <proto/log.h>
+#include <proto/map.h>
 #include <proto/port_range.h>
 #include <proto/protocols.h>
 #include <proto/proto_tcp.h>
@@ -130,6 +133,8 @@ static const struct cfg_opt cfg_opts2[] =
 	{ "dontlog-normal",               PR_O2_NOLOGNORM, PR_CAP_FE, 0 },
 	{ "log-separate-errors",          PR_O2_LOGERRORS, PR_CAP_FE, 0 },
 	{ "independant-streams",          PR_O2_INDEPSTR,  PR_CAP_FE|PR_CAP_BE, 0 },
+	{ "reorder-filters",              PR_O2_REORDER,   PR_CAP_FE|PR_CAP_BE, 0 },
+	{ "http-pipelining",              PR_O2_PIPELINE,  PR_CAP_FE|PR_CAP_BE, 0 },
 	{ NULL, 0, 0, 0 }
 };
 
@@ -370,6 +375,47 @@ int warnif_misplaced_reqadd(struct proxy *proxy, const char *file, int line, cha
 		warnif_rule_after_use_backend(proxy, file, line, arg);
 }
 
+/* Builds the response of each entry of <map>, whose values are a location
+ * optionally followed by a redirect code. The code and cookie of redirect rule
+ * <rule> apply by default. Returns 0 if OK, otherwise non-zero after emitting
+ * an alert.
+ */
+static int redirect_map_build(struct map *map, struct redirect_rule *rule)
+{
+	struct map_entry *entry;
+	char *loc, *end;
+	int code;
+
+	list_for_each_entry(entry, &map->entries, list) {
+		loc = entry->value;
+		end = loc;
+		while (*end && !isspace((unsigned char)*end))
+			end++;
+
+		code = rule->code;
+		if (*end) {
+			char *arg = end;
+
+			while (isspace((unsigned char)*arg))
+				arg++;
+			code = atol(arg);
+			if (code < 301 || code > 303) {
+				Alert("parsing [%s:%d] : unsupported HTTP code '%s'.\n",
+				      map->file, entry->line, arg);
+				return 1;
+			}
+		}
+
+		entry->ptr = http_make_redirect(code, loc, end - loc,
+						rule->cookie_str, rule->cookie_len);
+		if (!entry->ptr) {
+			Alert("parsing [%s:%d] : out of memory.\n", map->file, entry->line);
+			return 1;
+		}
+	}
+	return 0;
+}
+
 /*
  * parse a line in a <global> section. Returns the error code, 0 if OK, or
  * any combination of :
@@ -546,6 +592,22 @@ int cfg_parse_global(const char *file, int linenum, char **args, int inv)
 		}
 		global.maxpipes = atol(args[1]);
 	}
+	else if (!strcmp(args[0], "maxzlibmem")) {
+		if (*(args[1]) == 0) {
+			Alert("parsing [%s:%d] : '%s' expects an integer argument (in megabytes).\n", file, linenum, args[0]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		}
+		global.maxzlibmem = atol(args[1]);
+	}
+	else if (!strcmp(args[0], "maxcomprate")) {
+		if (*(args[1]) == 0) {
+			Alert("parsing [%s:%d] : '%s' expects an integer argument (in kB/s).\n", file, linenum, args[0]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		}
+		global.maxcomprate = atol(args[1]);
+	}
 	else if (!strcmp(args[0], "ulimit-n")) {
 		if (global.rlimit_nofile != 0) {
 			Alert("parsing [%s:%d] : '%s' already specified. Continuing.\n", file, linenum, args[0]);
@@ -668,7 +730,26 @@ int cfg_parse_global(const char *file, int linenum, char **args, int inv)
 			}
 		}
 
-		if (args[1][0] == '/') {
+		logsrv.stream = NULL;
+		if (!strncmp(args[1], "stream@", 7) || !strncmp(args[1], "file@", 5)) {
+			char *path = strchr(args[1], '@') + 1;
+
+			if (*path != '/') {
+				Alert("parsing [%s:%d] : '%s' expects an absolute path after '%.*s'.\n",
+				      file, linenum, args[0], (int)(path - args[1]), args[1]);
+				err_code |= ERR_ALERT | ERR_FATAL;
+				goto out;
+			}
+			logsrv.stream = get_log_stream((*args[1] == 's') ? LOG_STREAM_UNIX : LOG_STREAM_FILE, path);
+			if (!logsrv.stream) {
+				Alert("parsing [%s:%d] : cannot use log target '%s' (path too long or out of memory).\n",
+				      file, linenum, args[1]);
+				err_code |= ERR_ALERT | ERR_FATAL;
+				goto out;
+			}
+			logsrv.u.un = logsrv.stream->addr;
+		}
+		else if (args[1][0] == '/') {
 			logsrv.u.addr.sa_family = AF_UNIX;
 			logsrv.u.un = *str2sun(args[1]);
 		} else {
@@ -695,6 +776,26 @@ int cfg_parse_global(const char *file, int linenum, char **args, int inv)
 			err_code |= ERR_ALERT | ERR_FATAL;
 		}
 	}
+	else if (!strcmp(args[0], "log-binary")) {  /* binary log collector */
+		if (global.binlog_type) {
+			Alert("parsing [%s:%d] : '%s' already specified. Continuing.\n", file, linenum, args[0]);
+			err_code |= ERR_ALERT;
+			goto out;
+		}
+		if (args[1][0] != '/') {
+			Alert("parsing [%s:%d] : '%s' expects the path of a UNIX socket as an argument.\n", file, linenum, args[0]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		}
+		if (*args[2] && strcmp(args[2], "stream") != 0 && strcmp(args[2], "dgram") != 0) {
+			Alert("parsing [%s:%d] : '%s' only supports 'stream' or 'dgram' after the path.\n", file, linenum, args[0]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		}
+		global.binlog_srv.u.addr.sa_family = AF_UNIX;
+		global.binlog_srv.u.un = *str2sun(args[1]);
+		global.binlog_type = strcmp(args[2], "stream") == 0 ? SOCK_STREAM : SOCK_DGRAM;
+	}
 	else if (!strcmp(args[0], "spread-checks")) {  /* random time between checks (0-50) */
 		if (global.spread_checks != 0) {
 			Alert("parsing [%s:%d]: spread-checks already specified. Continuing.\n", file, linenum);
@@ -889,6 +990,10 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			curproxy->maxconn = defproxy.maxconn;
 			curproxy->backlog = defproxy.backlog;
 			curproxy->fe_sps_lim = defproxy.fe_sps_lim;
+			curproxy->log_sample_num = defproxy.log_sample_num;
+			curproxy->log_sample_den = defproxy.log_sample_den;
+			curproxy->log_rate_lim = defproxy.log_rate_lim;
+			curproxy->log_slow = defproxy.log_slow;
 
 			/* initialize error relocations */
 			for (rc = 0; rc < HTTP_ERR_SIZE; rc++) {
@@ -956,6 +1061,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 		}
 
 		curproxy->mode = defproxy.mode;
+		curproxy->comp = defproxy.comp;
 		curproxy->logfac1 = defproxy.logfac1;
 		curproxy->logsrv1 = defproxy.logsrv1;
 		curproxy->loglev1 = defproxy.loglev1;
@@ -1356,6 +1462,136 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	} /* Url App Session */
+	else if (!strcmp(args[0], "cache")) {  /* HTTP objects cache */
+		unsigned int size, max_obj = BUFSIZE, max_age = 60000;
+		int cur_arg;
+
+		if (curproxy == &defproxy) {
+			Alert("parsing [%s:%d] : '%s' not allowed in 'defaults' section.\n", file, linenum, args[0]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		}
+
+		if (warnifnotcap(curproxy, PR_CAP_BE, file, linenum, args[0], NULL))
+			err_code |= ERR_WARN;
+
+		if (!*args[1] || parse_size_err(args[1], &size) || !size) {
+			Alert("parsing [%s:%d] : '%s' expects <size> [max-object <size>] [max-age <time>].\n",
+			      file, linenum, args[0]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		}
+
+		for (cur_arg = 2; *args[cur_arg]; cur_arg += 2) {
+			if (!strcmp(args[cur_arg], "max-object")) {
+				if (!*args[cur_arg + 1] || parse_size_err(args[cur_arg + 1], &max_obj)) {
+					Alert("parsing [%s:%d] : '%s %s' expects a size in bytes.\n",
+					      file, linenum, args[0], args[cur_arg]);
+					err_code |= ERR_ALERT | ERR_FATAL;
+					goto out;
+				}
+				if (max_obj > BUFSIZE) {
+					Warning("parsing [%s:%d] : '%s' : objects larger than a buffer cannot be cached, limiting '%s' to %d bytes.\n",
+						file, linenum, args[0], args[cur_arg], BUFSIZE);
+					err_code |= ERR_WARN;
+					max_obj = BUFSIZE;
+				}
+			}
+			else if (!strcmp(args[cur_arg], "max-age")) {
+				err = *args[cur_arg + 1] ? parse_time_err(args[cur_arg + 1], &max_age, TIME_UNIT_MS) : args[cur_arg + 1];
+				if (err) {
+					Alert("parsing [%s:%d] : '%s %s' expects a time, found '%s'.\n",
+					      file, linenum, args[0], args[cur_arg], args[cur_arg + 1]);
+					err_code |= ERR_ALERT | ERR_FATAL;
+					goto out;
+				}
+			}
+			else {
+				Alert("parsing [%s:%d] : '%s' only supports 'max-object' and 'max-age', found '%s'.\n",
+				      file, linenum, args[0], args[cur_arg]);
+				err_code |= ERR_ALERT | ERR_FATAL;
+				goto out;
+			}
+		}
+
+		cache_free(curproxy->cache);
+		curproxy->cache = cache_new(size, max_obj, max_age);
+		if (!curproxy->cache) {
+			Alert("parsing [%s:%d] : out of memory.\n", file, linenum);
+			err_code |= ERR_ALERT | ERR_ABORT;
+			goto out;
+		}
+	}
+	else if (!strcmp(args[0], "compression")) {  /* response compression */
+		struct comp *comp;
+		int cur_arg;
+
+#ifndef USE_ZLIB
+		Alert("parsing [%s:%d] : '%s' is not supported, haproxy was built without USE_ZLIB.\n",
+		      file, linenum, args[0]);
+		err_code |= ERR_ALERT | ERR_FATAL;
+		goto out;
+#endif
+		if (strcmp(args[1], "algo") != 0 && strcmp(args[1], "type") != 0) {
+			Alert("parsing [%s:%d] : '%s' expects 'algo' or 'type'.\n", file, linenum, args[0]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		}
+
+		if (!*args[2]) {
+			Alert("parsing [%s:%d] : '%s %s' expects at least one argument.\n",
+			      file, linenum, args[0], args[1]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		}
+
+		/* settings inherited from the defaults section are copied
+		 * before being changed.
+		 */
+		comp = curproxy->comp;
+		if (!comp || (curproxy != &defproxy && comp == defproxy.comp)) {
+			comp = calloc(1, sizeof(*comp));
+			if (!comp) {
+				Alert("parsing [%s:%d] : out of memory.\n", file, linenum);
+				err_code |= ERR_ALERT | ERR_ABORT;
+				goto out;
+			}
+			if (curproxy->comp)
+				*comp = *curproxy->comp;
+			curproxy->comp = comp;
+		}
+
+		if (!strcmp(args[1], "algo")) {
+			comp->nb_algos = 0;
+			for (cur_arg = 2; *args[cur_arg]; cur_arg++) {
+				int algo = comp_find_algo(args[cur_arg], strlen(args[cur_arg]));
+
+				if (algo == COMP_ALGO_NONE) {
+					Alert("parsing [%s:%d] : '%s %s' only supports 'gzip' and 'deflate', found '%s'.\n",
+					      file, linenum, args[0], args[1], args[cur_arg]);
+					err_code |= ERR_ALERT | ERR_FATAL;
+					goto out;
+				}
+				if (comp->nb_algos < COMP_ALGOS - 1)
+					comp->algos[comp->nb_algos++] = algo;
+			}
+		}
+		else {
+			for (cur_arg = 2; *args[cur_arg]; cur_arg++) {
+				struct comp_type *type = calloc(1, sizeof(*type));
+
+				if (!type || !(type->name = strdup(args[cur_arg]))) {
+					free(type);
+					Alert("parsing [%s:%d] : out of memory.\n", file, linenum);
+					err_code |= ERR_ALERT | ERR_ABORT;
+					goto out;
+				}
+				type->len = strlen(type->name);
+				type->next = comp->types;
+				comp->types = type;
+			}
+		}
+	}
 	else if (!strcmp(args[0], "capture")) {
 		if (warnifnotcap(curproxy, PR_CAP_FE, file, linenum, args[0], NULL))
 			err_code |= ERR_WARN;
@@ -1483,8 +1719,12 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 	}
 	else if (!strcmp(args[0], "redirect")) {
 		int pol = ACL_COND_NONE;
-		struct acl_cond *cond;
+		struct acl_cond *cond = NULL;
 		struct redirect_rule *rule;
+		struct map *map = NULL;
+		struct map_key key;
+		int match = MAP_MATCH_STR;
+		int map_ret;
 		int cur_arg;
 		int type = REDIRECT_TYPE_NONE;
 		int code = 302;
@@ -1562,6 +1802,26 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			else if (!strcmp(args[cur_arg],"drop-query")) {
 				flags |= REDIRECT_FLAG_DROP_QS;
 			}
+			else if (type == REDIRECT_TYPE_NONE &&
+				 (map_ret = map_parse_key(args[cur_arg], &key, &match)) != 0) {
+				if (map_ret < 0) {
+					Alert("parsing [%s:%d] : '%s': unsupported map key '%s'.\n",
+					      file, linenum, args[0], args[cur_arg]);
+					err_code |= ERR_ALERT | ERR_FATAL;
+					goto out;
+				}
+				if (!*args[cur_arg + 1]) {
+					Alert("parsing [%s:%d] : '%s': missing map file name after '%s'.\n",
+					      file, linenum, args[0], args[cur_arg]);
+					err_code |= ERR_ALERT | ERR_FATAL;
+					free(key.name);
+					goto out;
+				}
+
+				type = REDIRECT_TYPE_MAP;
+				cur_arg++;
+				destination = args[cur_arg];
+			}
 			else if (!strcmp(args[cur_arg], "if")) {
 				pol = ACL_COND_IF;
 				cur_arg++;
@@ -1582,27 +1842,31 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 		}
 
 		if (type == REDIRECT_TYPE_NONE) {
-			Alert("parsing [%s:%d] : '%s' expects a redirection type ('prefix' or 'location').\n",
+			Alert("parsing [%s:%d] : '%s' expects a redirection type ('prefix', 'location' or 'map').\n",
 			      file, linenum, args[0]);
 			err_code |= ERR_ALERT | ERR_FATAL;
 			goto out;
 		}
 
-		if (pol == ACL_COND_NONE) {
+		if (pol == ACL_COND_NONE && type != REDIRECT_TYPE_MAP) {
 			Alert("parsing [%s:%d] : '%s' requires either 'if' or 'unless' followed by a condition.\n",
 			      file, linenum, args[0]);
 			err_code |= ERR_ALERT | ERR_FATAL;
 			goto out;
 		}
 
-		if ((cond = parse_acl_cond((const char **)args + cur_arg, &curproxy->acl, pol)) == NULL) {
+		if (pol != ACL_COND_NONE &&
+		    (cond = parse_acl_cond((const char **)args + cur_arg, &curproxy->acl, pol)) == NULL) {
 			Alert("parsing [%s:%d] : '%s': error detected while parsing redirect condition.\n",
 			      file, linenum, args[0]);
 			err_code |= ERR_ALERT | ERR_FATAL;
+			if (type == REDIRECT_TYPE_MAP)
+				free(key.name);
 			goto out;
 		}
 
-		cond->line = linenum;
+		if (cond)
+			cond->line = linenum;
 		rule = (struct redirect_rule *)calloc(1, sizeof(*rule));
 		rule->cond = cond;
 		rule->rdr_str = strdup(destination);
@@ -1627,11 +1891,45 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 		LIST_INIT(&rule->list);
 		LIST_ADDQ(&curproxy->redirect_rules, &rule->list);
 		warnif_rule_after_use_backend(curproxy, file, linenum, args[0]);
+
+		if (type == REDIRECT_TYPE_MAP) {
+			rule->key = key;
+			map = map_load(destination, match, key.type == MAP_KEY_HDR ? MAP_F_ICASE : 0, &err_code);
+			if (!map) {
+				Alert("parsing [%s:%d] : '%s': error detected while loading map file '%s'.\n",
+				      file, linenum, args[0], destination);
+				err_code |= ERR_ALERT | ERR_FATAL;
+				goto out;
+			}
+			rule->map = map;
+			if (redirect_map_build(map, rule) != 0)
+				err_code |= ERR_ALERT | ERR_FATAL;
+		}
+		else {
+			/* the whole response is built now. A prefix of "/" is not
+			 * added, otherwise it would be hard to configure a
+			 * self-redirection.
+			 */
+			int len = rule->rdr_len;
+
+			if (type == REDIRECT_TYPE_PREFIX && len == 1 && *rule->rdr_str == '/')
+				len = 0;
+			rule->msg = http_make_redirect(code, rule->rdr_str, len,
+						       rule->cookie_str, rule->cookie_len);
+			if (!rule->msg) {
+				Alert("parsing [%s:%d] : out of memory.\n", file, linenum);
+				err_code |= ERR_ALERT | ERR_ABORT;
+				goto out;
+			}
+		}
 	}
 	else if (!strcmp(args[0], "use_backend")) {
 		int pol = ACL_COND_NONE;
-		struct acl_cond *cond;
+		struct acl_cond *cond = NULL;
 		struct switching_rule *rule;
+		struct map *map = NULL;
+		struct map_key key;
+		int match, cur_arg = 2;
 
 		if (curproxy == &defproxy) {
 			Alert("parsing [%s:%d] : '%s' not allowed in 'defaults' section.\n", file, linenum, args[0]);
@@ -1648,42 +1946,83 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 
-		if (!strcmp(args[2], "if"))
+		switch (map_parse_key(args[1], &key, &match)) {
+		case -1:
+			Alert("parsing [%s:%d] : '%s' : unsupported map key '%s'.\n",
+			      file, linenum, args[0], args[1]);
+			err_code |= ERR_ALERT | ERR_FATAL;
+			goto out;
+		case 1:
+			if (*(args[2]) == 0) {
+				Alert("parsing [%s:%d] : '%s %s' expects a map file name.\n",
+				      file, linenum, args[0], args[1]);
+				err_code |= ERR_ALERT | ERR_FATAL;
+				free(key.name);
+				goto out;
+			}
+			map = map_load(args[2], match, key.type == MAP_KEY_HDR ? MAP_F_ICASE : 0, &err_code);
+			if (!map) {
+				Alert("parsing [%s:%d] : '%s' : error detected while loading map file '%s'.\n",
+				      file, linenum, args[0], args[2]);
+				err_code |= ERR_ALERT | ERR_FATAL;
+				free(key.name);
+				goto out;
+			}
+			cur_arg = 3;
+			break;
+		}
+
+		if (!strcmp(args[cur_arg], "if"))
 			pol = ACL_COND_IF;
-		else if (!strcmp(args[2], "unless"))
+		else if (!strcmp(args[cur_arg], "unless"))
 			pol = ACL_COND_UNLESS;
 
-		if (pol == ACL_COND_NONE) {
+		if (pol == ACL_COND_NONE && (!map || *args[cur_arg])) {
 			Alert("parsing [%s:%d] : '%s' requires either 'if' or 'unless' followed by a condition.\n",
 			      file, linenum, args[0]);
 			err_code |= ERR_ALERT | ERR_FATAL;
-			goto out;
+			goto out_free_map;
 		}
 
-		if ((cond = parse_acl_cond((const char **)args + 3, &curproxy->acl, pol)) == NULL) {
+		if (pol != ACL_COND_NONE &&
+		    (cond = parse_acl_cond((const char **)args + cur_arg + 1, &curproxy->acl, pol)) == NULL) {
 			Alert("parsing [%s:%d] : error detected while parsing switching rule.\n",
 			      file, linenum);
 			err_code |= ERR_ALERT | ERR_FATAL;
-			goto out;
+			goto out_free_map;
 		}
 
-		cond->line = linenum;
-		if (cond->requires & ACL_USE_RTR_ANY) {
-			struct acl *acl;
-			const char *name;
-
-			acl = cond_find_require(cond, ACL_USE_RTR_ANY);
-			name = acl ? acl->name : "(unknown)";
-			Warning("parsing [%s:%d] : acl '%s' involves some response-only criteria which will be ignored.\n",
-				file, linenum, name);
-			err_code |= ERR_WARN;
+		if (cond) {
+			cond->line = linenum;
+			if (cond->requires & ACL_USE_RTR_ANY) {
+				struct acl *acl;
+				const char *name;
+
+				acl = cond_find_require(cond, ACL_USE_RTR_ANY);
+				name = acl ? acl->name : "(unknown)";
+				Warning("parsing [%s:%d] : acl '%s' involves some response-only criteria which will be ignored.\n",
+					file, linenum, name);
+				err_code |= ERR_WARN;
+			}
 		}
 
 		rule = (struct switching_rule *)calloc(1, sizeof(*rule));
 		rule->cond = cond;
-		rule->be.name = strdup(args[1]);
+		rule->line = linenum;
+		if (map) {
+			rule->map = map;
+			rule->key = key;
+		}
+		else
+			rule->be.name = strdup(args[1]);
 		LIST_INIT(&rule->list);
 		LIST_ADDQ(&curproxy->switching_rules, &rule->list);
+		goto out;
+	out_free_map:
+		if (map) {
+			map_free(map);
+			free(key.name);
+		}
 	}
 	else if (!strcmp(args[0], "stats")) {
 		if (warnifnotcap(curproxy, PR_CAP_BE, file, linenum, args[0], NULL))
@@ -2334,6 +2673,12 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			else if (!strcmp(args[cur_arg], "redir")) {
 				newsrv->rdr_pfx = strdup(args[cur_arg + 1]);
 				newsrv->rdr_len = strlen(args[cur_arg + 1]);
+				newsrv->rdr_msg = http_make_redirect(302, newsrv->rdr_pfx, newsrv->rdr_len, NULL, 0);
+				if (!newsrv->rdr_msg) {
+					Alert("parsing [%s:%d] : out of memory.\n", file, linenum);
+					err_code |= ERR_ALERT | ERR_ABORT;
+					goto out;
+				}
 				cur_arg += 2;
 			}
 			else if (!strcmp(args[cur_arg], "rise")) {
@@ -2694,7 +3039,26 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 				}
 			}
 
-			if (args[1][0] == '/') {
+			logsrv.stream = NULL;
+			if (!strncmp(args[1], "stream@", 7) || !strncmp(args[1], "file@", 5)) {
+				char *path = strchr(args[1], '@') + 1;
+
+				if (*path != '/') {
+					Alert("parsing [%s:%d] : '%s' expects an absolute path after '%.*s'.\n",
+					      file, linenum, args[0], (int)(path - args[1]), args[1]);
+					err_code |= ERR_ALERT | ERR_FATAL;
+					goto out;
+				}
+				logsrv.stream = get_log_stream((*args[1] == 's') ? LOG_STREAM_UNIX : LOG_STREAM_FILE, path);
+				if (!logsrv.stream) {
+					Alert("parsing [%s:%d] : cannot use log target '%s' (path too long or out of memory).\n",
+					      file, linenum, args[1]);
+					err_code |= ERR_ALERT | ERR_FATAL;
+					goto out;
+				}
+				logsrv.u.un = logsrv.stream->addr;
+			}
+			else if (args[1][0] == '/') {
 				logsrv.u.addr.sa_family = AF_UNIX;
 				logsrv.u.un = *str2sun(args[1]);
 			} else {
@@ -2853,7 +3217,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		err = chain_regex(&curproxy->req_exp, preg, ACT_REPLACE, strdup(args[2]));
+		err = chain_regex(&curproxy->req_exp, preg, args[1], ACT_REPLACE, strdup(args[2]));
 		if (err) {
 			Alert("parsing [%s:%d] : invalid character or unterminated sequence in replacement string near '%c'.\n",
 			      file, linenum, *err);
@@ -2884,7 +3248,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_REMOVE, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_REMOVE, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqdeny")) {  /* deny a request if a header matches this regex */
@@ -2910,7 +3274,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_DENY, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_DENY, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqpass")) {  /* pass this header without allowing or denying the request */
@@ -2936,7 +3300,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_PASS, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_PASS, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqallow")) {  /* allow a request if a header matches this regex */
@@ -2962,7 +3326,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_ALLOW, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_ALLOW, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqtarpit")) {  /* tarpit a request if a header matches this regex */
@@ -2988,7 +3352,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_TARPIT, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_TARPIT, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqsetbe")) { /* switch the backend from a regex, respecting case */
@@ -3015,7 +3379,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 
-		chain_regex(&curproxy->req_exp, preg, ACT_SETBE, strdup(args[2]));
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_SETBE, strdup(args[2]));
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqisetbe")) { /* switch the backend from a regex, ignoring case */
@@ -3042,7 +3406,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 
-		chain_regex(&curproxy->req_exp, preg, ACT_SETBE, strdup(args[2]));
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_SETBE, strdup(args[2]));
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqirep")) {  /* replace request header from a regex, ignoring case */
@@ -3069,7 +3433,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		err = chain_regex(&curproxy->req_exp, preg, ACT_REPLACE, strdup(args[2]));
+		err = chain_regex(&curproxy->req_exp, preg, args[1], ACT_REPLACE, strdup(args[2]));
 		if (err) {
 			Alert("parsing [%s:%d] : invalid character or unterminated sequence in replacement string near '%c'.\n",
 			      file, linenum, *err);
@@ -3101,7 +3465,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_REMOVE, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_REMOVE, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqideny")) {  /* deny a request if a header matches this regex ignoring case */
@@ -3127,7 +3491,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_DENY, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_DENY, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqipass")) {  /* pass this header without allowing or denying the request */
@@ -3153,7 +3517,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_PASS, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_PASS, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqiallow")) {  /* allow a request if a header matches this regex ignoring case */
@@ -3179,7 +3543,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_ALLOW, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_ALLOW, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqitarpit")) {  /* tarpit a request if a header matches this regex ignoring case */
@@ -3205,7 +3569,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		chain_regex(&curproxy->req_exp, preg, ACT_TARPIT, NULL);
+		chain_regex(&curproxy->req_exp, preg, args[1], ACT_TARPIT, NULL);
 		warnif_misplaced_reqxxx(curproxy, file, linenum, args[0]);
 	}
 	else if (!strcmp(args[0], "reqadd")) {  /* add request header */
@@ -3251,7 +3615,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		err = chain_regex(&curproxy->rsp_exp, preg, ACT_REPLACE, strdup(args[2]));
+		err = chain_regex(&curproxy->rsp_exp, preg, args[1], ACT_REPLACE, strdup(args[2]));
 		if (err) {
 			Alert("parsing [%s:%d] : invalid character or unterminated sequence in replacement string near '%c'.\n",
 			      file, linenum, *err);
@@ -3283,7 +3647,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		err = chain_regex(&curproxy->rsp_exp, preg, ACT_REMOVE, strdup(args[2]));
+		err = chain_regex(&curproxy->rsp_exp, preg, args[1], ACT_REMOVE, strdup(args[2]));
 		if (err) {
 			Alert("parsing [%s:%d] : invalid character or unterminated sequence in replacement string near '%c'.\n",
 			      file, linenum, *err);
@@ -3314,7 +3678,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		err = chain_regex(&curproxy->rsp_exp, preg, ACT_DENY, strdup(args[2]));
+		err = chain_regex(&curproxy->rsp_exp, preg, args[1], ACT_DENY, strdup(args[2]));
 		if (err) {
 			Alert("parsing [%s:%d] : invalid character or unterminated sequence in replacement string near '%c'.\n",
 			      file, linenum, *err);
@@ -3346,7 +3710,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	    
-		err = chain_regex(&curproxy->rsp_exp, preg, ACT_REPLACE, strdup(args[2]));
+		err = chain_regex(&curproxy->rsp_exp, preg, args[1], ACT_REPLACE, strdup(args[2]));
 		if (err) {
 			Alert("parsing [%s:%d] : invalid character or unterminated sequence in replacement string near '%c'.\n",
 			      file, linenum, *err);
@@ -3377,7 +3741,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		err = chain_regex(&curproxy->rsp_exp, preg, ACT_REMOVE, strdup(args[2]));
+		err = chain_regex(&curproxy->rsp_exp, preg, args[1], ACT_REMOVE, strdup(args[2]));
 		if (err) {
 			Alert("parsing [%s:%d] : invalid character or unterminated sequence in replacement string near '%c'.\n",
 			      file, linenum, *err);
@@ -3408,7 +3772,7 @@ int cfg_parse_listen(const char *file, int linenum, char **args, int inv)
 			goto out;
 		}
 	
-		err = chain_regex(&curproxy->rsp_exp, preg, ACT_DENY, strdup(args[2]));
+		err = chain_regex(&curproxy->rsp_exp, preg, args[1], ACT_DENY, strdup(args[2]));
 		if (err) {
 			Alert("parsing [%s:%d] : invalid character or unterminated sequence in replacement string near '%c'.\n",
 			      file, linenum, *err);
@@ -3743,6 +4107,40 @@ int readcfgfile(const char *file)
 	return err_code;
 }
 
+/* Returns the ACL_USE_* bits needed by the request processing of proxy <px>
+ * alone. ACL_USE_HDR_VOLATILE is set whenever something has to look at, or
+ * modify, the request headers, which then have to be indexed.
+ */
+static unsigned int proxy_own_requires(struct proxy *px)
+{
+	struct switching_rule *rule;
+	struct redirect_rule *rdr;
+	struct acl *acl;
+	unsigned int requires = 0;
+
+	list_for_each_entry(acl, &px->acl, list)
+		if (acl->use_cnt)
+			requires |= acl->requires;
+
+	list_for_each_entry(rule, &px->switching_rules, list)
+		if (rule->map && rule->key.type == MAP_KEY_HDR)
+			requires |= ACL_USE_HDR_VOLATILE;
+
+	list_for_each_entry(rdr, &px->redirect_rules, list)
+		if (rdr->map && rdr->key.type == MAP_KEY_HDR)
+			requires |= ACL_USE_HDR_VOLATILE;
+
+	if (px->req_exp || px->nb_reqadd || px->nb_req_cap || px->cache || px->comp ||
+	    px->cookie_name || px->appsession_name || px->capture_name || px->uri_auth ||
+	    (px->options & (PR_O_HTTP_CLOSE|PR_O_FORCE_CLO|PR_O_FWDFOR|PR_O_ORGTO)) ||
+	    (px->options2 & PR_O2_PIPELINE) ||
+	    (px->lbprm.algo & BE_LB_ALGO) == BE_LB_ALGO_HH ||
+	    ((px->lbprm.algo & BE_LB_ALGO) == BE_LB_ALGO_PH && px->url_param_post_limit))
+		requires |= ACL_USE_HDR_VOLATILE;
+
+	return requires;
+}
+
 /*
  * Returns the error code, 0 if OK, or any combination of :
  *  - ERR_ABORT: must abort ASAP
@@ -3926,6 +4324,35 @@ int check_config_validity()
 		list_for_each_entry(rule, &curproxy->switching_rules, list) {
 			struct proxy *target;
 
+			if (rule->map) {
+				struct map_entry *entry;
+
+				if (curproxy->mode != PR_MODE_HTTP) {
+					Alert("Proxy '%s': map-based use_backend at line %d requires HTTP mode.\n",
+					      curproxy->id, rule->line);
+					cfgerr++;
+					continue;
+				}
+
+				list_for_each_entry(entry, &rule->map->entries, list) {
+					target = findproxy(entry->value, PR_MODE_HTTP, PR_CAP_BE);
+					if (!target) {
+						Alert("Proxy '%s': unable to find backend '%s' referenced at [%s:%d].\n",
+						      curproxy->id, entry->value, rule->map->file, entry->line);
+						cfgerr++;
+					} else if (target == curproxy) {
+						Alert("Proxy '%s': loop detected for backend '%s' referenced at [%s:%d].\n",
+						      curproxy->id, entry->value, rule->map->file, entry->line);
+						cfgerr++;
+					} else {
+						entry->ptr = target;
+						target->bind_proc = curproxy->bind_proc ?
+							(target->bind_proc | curproxy->bind_proc) : 0;
+					}
+				}
+				continue;
+			}
+
 			target = findproxy(rule->be.name, curproxy->mode, PR_CAP_BE);
 
 			if (!target) {
@@ -4011,6 +4438,11 @@ int check_config_validity()
 						     MAX_HTTP_HDR * sizeof(struct hdr_idx_elem),
 						     MEM_F_SHARED);
 
+		/* ACLs used by several rules get a slot in the per-session
+		 * ACL result cache.
+		 */
+		acl_assign_cache_idx(curproxy);
+
 		/* for backwards compatibility with "listen" instances, if
 		 * fullconn is not set but maxconn is set, then maxconn
 		 * is used.
@@ -4177,6 +4609,49 @@ int check_config_validity()
 		curproxy = curproxy->next;
 	}
 
+	if (acl_cache_size)
+		pool2_acl_cache = create_pool("acl_cache", acl_cache_size, MEM_F_SHARED);
+
+	/* Backends balancing on POST parameters may wait for more body data
+	 * than the request buffer can hold. They then need a spill area large
+	 * enough for the largest limit, and for one more buffer.
+	 */
+	for (curproxy = proxy; curproxy; curproxy = curproxy->next) {
+		if ((curproxy->lbprm.algo & BE_LB_ALGO) == BE_LB_ALGO_PH &&
+		    curproxy->url_param_post_limit + BUFSIZE > body_spill_size)
+			body_spill_size = curproxy->url_param_post_limit + BUFSIZE;
+	}
+
+	if (body_spill_size)
+		pool2_body_spill = create_pool("body_spill", sizeof(struct body_spill) + body_spill_size,
+					       MEM_F_SHARED);
+
+	/*
+	 * A frontend only needs to index the request headers if itself or
+	 * any of the backends it may switch to needs them. Rules are only
+	 * resolved when no error was found.
+	 */
+	for (curproxy = proxy; !cfgerr && curproxy; curproxy = curproxy->next) {
+		struct switching_rule *rule;
+		struct map_entry *entry;
+
+		if (curproxy->mode != PR_MODE_HTTP)
+			continue;
+
+		curproxy->requires |= proxy_own_requires(curproxy);
+		if (curproxy->defbe.be)
+			curproxy->requires |= proxy_own_requires(curproxy->defbe.be);
+
+		list_for_each_entry(rule, &curproxy->switching_rules, list) {
+			if (!rule->map) {
+				curproxy->requires |= proxy_own_requires(rule->be.backend);
+				continue;
+			}
+			list_for_each_entry(entry, &rule->map->entries, list)
+				curproxy->requires |= proxy_own_requires(entry->ptr);
+		}
+	}
+
 	/*
 	 * Recount currently required checks.
 	 */
@@ -257,15 +257,23 @@ int event_accept(int fd) {
 		txn->srv_cookie = NULL;
 		txn->cli_cookie = NULL;
 		txn->uri = NULL;
+		txn->cache_obj = NULL;
+		txn->comp_ctx = NULL;
+		txn->spill = NULL;
 		txn->req.cap = NULL;
 		txn->rsp.cap = NULL;
 		txn->hdr_idx.v = NULL;
+		s->acl_cache = NULL;
 		txn->hdr_idx.size = txn->hdr_idx.used = 0;
 
 		if (p->mode == PR_MODE_HTTP) {
 			txn->status = -1;
 			txn->req.hdr_content_len = 0LL;
 			txn->rsp.hdr_content_len = 0LL;
+			txn->req.chunk_len = txn->rsp.chunk_len = 0LL;
+			txn->req.flags = txn->rsp.flags = 0;
+			if (!(p->requires & ACL_USE_HDR_ANY))
+				txn->req.flags |= HTTP_MSGF_NO_HDR_IDX;
 			txn->req.msg_state = HTTP_MSG_RQBEFORE; /* at the very beginning of the request */
 			txn->rsp.msg_state = HTTP_MSG_RPBEFORE; /* at the very beginning of the response */
 			txn->req.sol = txn->req.eol = NULL;
@@ -301,6 +309,13 @@ int event_accept(int fd) {
 			hdr_idx_init(&txn->hdr_idx);
 		}
 
+		if (pool2_acl_cache) {
+			if ((s->acl_cache = pool_alloc2(pool2_acl_cache)) == NULL)
+				goto out_fail_acl; /* no memory */
+
+			memset(s->acl_cache, 0, acl_cache_size);
+		}
+
 		if ((p->mode == PR_MODE_TCP || p->mode == PR_MODE_HTTP)
 		    && (p->logfac1 >= 0 || p->logfac2 >= 0)) {
 			if (p->to_log) {
@@ -476,6 +491,8 @@ int event_accept(int fd) {
  out_fail_rep:
 	pool_free2(pool2_buffer, s->req);
  out_fail_req:
+	pool_free2(pool2_acl_cache, s->acl_cache);
+ out_fail_acl:
 	pool_free2(p->hdr_idx_pool, txn->hdr_idx.v);
  out_fail_idx:
 	pool_free2(p->rsp_cap_pool, txn->rsp.cap);
@@ -567,6 +584,7 @@ static int
 acl_fetch_dconn(struct proxy *px, struct session *l4, void *l7, int dir,
                 struct acl_expr *expr, struct acl_test *test)
 {
+	test->flags = ACL_TEST_F_VOL_TEST;
 	test->i = l4->listener->nbconn;
 	return 1;
 }
@@ -0,0 +1,347 @@
+/*
+ * HTTP response compression.
+ *
+ * Copyright 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/config.h>
+#include <common/memory.h>
+#include <common/standard.h>
+
+#include <types/compression.h>
+#include <types/freq_ctr.h>
+#include <types/global.h>
+
+#include <proto/buffers.h>
+#include <proto/compression.h>
+#include <proto/freq_ctr.h>
+
+static const char *comp_algo_names[COMP_ALGOS] = {
+	[COMP_ALGO_NONE]    = "identity",
+	[COMP_ALGO_GZIP]    = "gzip",
+	[COMP_ALGO_DEFLATE] = "deflate",
+};
+
+/* Returns non-zero if the <nlen> bytes of configured type <name> designate
+ * the <len> bytes of content type <type>.
+ */
+static int comp_type_prefix(const char *name, int nlen, const char *type, int len)
+{
+	if (len < nlen || strncasecmp(name, type, nlen) != 0)
+		return 0;
+	return name[nlen - 1] == '/' || len == nlen ||
+		type[nlen] == ';' || type[nlen] == ' ' || type[nlen] == '\t';
+}
+
+/* Returns the algorithm named by the <len> bytes of <name>, or COMP_ALGO_NONE. */
+int comp_find_algo(const char *name, int len)
+{
+	int algo;
+
+	for (algo = COMP_ALGO_NONE + 1; algo < COMP_ALGOS; algo++) {
+		if (strlen(comp_algo_names[algo]) == len &&
+		    strncasecmp(comp_algo_names[algo], name, len) == 0)
+			return algo;
+	}
+	return COMP_ALGO_NONE;
+}
+
+/* Returns the content-coding name of algorithm <algo>. */
+const char *comp_algo_name(int algo)
+{
+	return comp_algo_names[algo];
+}
+
+/* Returns non-zero if the <len> bytes of content type <type> are one of the
+ * types of <comp>, or of the default ones if it has none. A type ending with a
+ * slash matches all the types it is a prefix of, others must match until the
+ * parameters.
+ */
+int comp_type_match(const struct comp *comp, const char *type, int len)
+{
+	static const char *default_types[] = {
+		"text/", "application/json", "application/javascript",
+		"application/x-javascript", "application/xml", NULL
+	};
+	const struct comp_type *ct;
+	const char **name;
+
+	if (!comp->types) {
+		for (name = default_types; *name; name++)
+			if (comp_type_prefix(*name, strlen(*name), type, len))
+				return 1;
+		return 0;
+	}
+
+	for (ct = comp->types; ct; ct = ct->next)
+		if (comp_type_prefix(ct->name, ct->len, type, len))
+			return 1;
+	return 0;
+}
+
+#ifdef USE_ZLIB
+
+struct pool_head *pool2_comp_ctx = NULL;
+
+/* memory currently used by compression contexts and zlib, in bytes */
+static unsigned int comp_used_mem = 0;
+
+/* uncompressed bytes per second fed to zlib */
+static struct freq_ctr comp_bps_in;
+
+/* zlib's allocator. Each area is prefixed with its size so that it can be
+ * accounted for when released, and the global memory limit is enforced.
+ */
+static void *comp_zalloc(void *opaque, unsigned int items, unsigned int size)
+{
+	unsigned long *area;
+	unsigned long len = (unsigned long)items * size + sizeof(*area) * 2;
+
+	if (global.maxzlibmem &&
+	    comp_used_mem + len > (unsigned long)global.maxzlibmem * 1048576)
+		return Z_NULL;
+
+	area = malloc(len);
+	if (!area)
+		return Z_NULL;
+
+	comp_used_mem += len;
+	area[0] = len;
+	return area + 2;
+}
+
+/* zlib's deallocator, which releases an area allocated by comp_zalloc(). */
+static void comp_zfree(void *opaque, void *ptr)
+{
+	unsigned long *area = (unsigned long *)ptr - 2;
+
+	comp_used_mem -= area[0];
+	free(area);
+}
+
+/* Initializes the compression subsystem. Returns 0 in case of failure. */
+int init_compression()
+{
+	pool2_comp_ctx = create_pool("comp_ctx", sizeof(struct comp_ctx), MEM_F_SHARED);
+	return pool2_comp_ctx != NULL;
+}
+
+/* Returns a new compression context for algorithm <algo>, or NULL if memory
+ * is lacking, or if the compression rate or memory limits are reached.
+ */
+struct comp_ctx *comp_ctx_new(int algo)
+{
+	struct comp_ctx *ctx;
+	int bits;
+
+	if (global.maxcomprate &&
+	    read_freq_ctr(&comp_bps_in) >= (unsigned int)global.maxcomprate * 1024)
+		return NULL;
+
+	if (global.maxzlibmem &&
+	    comp_used_mem + sizeof(*ctx) > (unsigned long)global.maxzlibmem * 1048576)
+		return NULL;
+
+	ctx = pool_alloc2(pool2_comp_ctx);
+	if (!ctx)
+		return NULL;
+
+	ctx->strm.zalloc = comp_zalloc;
+	ctx->strm.zfree = comp_zfree;
+	ctx->strm.opaque = Z_NULL;
+
+	/* a window of 2^15 bytes, plus 16 for a gzip wrapper, and the lowest
+	 * memory level as the output is flushed often anyway.
+	 */
+	bits = (algo == COMP_ALGO_GZIP) ? MAX_WBITS + 16 : MAX_WBITS;
+	if (deflateInit2(&ctx->strm, Z_BEST_SPEED, Z_DEFLATED, bits, 1, Z_DEFAULT_STRATEGY) != Z_OK) {
+		pool_free2(pool2_comp_ctx, ctx);
+		return NULL;
+	}
+
+	comp_used_mem += sizeof(*ctx);
+	ctx->finished = 0;
+	ctx->pending = 0;
+	ctx->out_len = 0;
+	return ctx;
+}
+
+/* Releases compression context <ctx>, which may be NULL. */
+void comp_ctx_free(struct comp_ctx *ctx)
+{
+	if (!ctx)
+		return;
+
+	deflateEnd(&ctx->strm);
+	comp_used_mem -= sizeof(*ctx);
+	pool_free2(pool2_comp_ctx, ctx);
+}
+
+/* Feeds the <len> bytes at <in> to the compressor of <ctx>, which stores its
+ * output after the data already in ctx->out. <flush> is passed to zlib for the
+ * last call. Returns the number of bytes consumed, which is lower than <len>
+ * when ctx->out is full, or -1 in case of error.
+ */
+static int comp_deflate(struct comp_ctx *ctx, char *in, int len, int flush)
+{
+	int ret;
+
+	ctx->strm.next_in = (Bytef *)in;
+	ctx->strm.avail_in = len;
+	ctx->strm.next_out = (Bytef *)ctx->out + ctx->out_len;
+	ctx->strm.avail_out = BUFSIZE - ctx->out_len;
+
+	ret = deflate(&ctx->strm, flush);
+	ctx->out_len = BUFSIZE - ctx->strm.avail_out;
+
+	if (ret == Z_STREAM_END)
+		ctx->finished = 1;
+	else if (ret != Z_OK && ret != Z_BUF_ERROR)
+		return -1;
+
+	return len - ctx->strm.avail_in;
+}
+
+/* Compresses the raw body data following the scheduled data of buffer <buf>,
+ * up to <*left> bytes, and replaces them with chunks of compressed data which
+ * are scheduled for sending. <*left> is decreased by the amount of data
+ * consumed. Once it reaches zero, the compressed stream is terminated along
+ * with the chunked encoding. Returns 1 once everything has been scheduled, 0
+ * if more room or data are needed, or -1 in case of error.
+ *
+ * Compressed data wait in the context until there is room for them in the
+ * buffer, so the raw data are only consumed when the context has room too.
+ * When the client has nothing left to send, whatever was compressed is
+ * flushed so that slowly produced responses are not delayed.
+ */
+int comp_forward(struct comp_ctx *ctx, struct buffer *buf, unsigned long long *left)
+{
+	char *end = buf->data + BUFSIZE;
+	char *ptr, *out;
+	int raw, len, done, sched, rest, room, chunk, term;
+
+	/* 1: feed the raw data, which may wrap at the end of the buffer */
+	raw = buf->l - buf->send_max;
+	if (raw > *left)
+		raw = *left;
+
+	ptr = buf->w + buf->send_max;
+	if (ptr >= end)
+		ptr -= BUFSIZE;
+
+	done = 0;
+	while (done < raw && ctx->out_len < BUFSIZE) {
+		len = raw - done;
+		if (len > end - ptr)
+			len = end - ptr;
+		len = comp_deflate(ctx, ptr, len, Z_NO_FLUSH);
+		if (len < 0)
+			return -1;
+		if (!len)
+			break;
+		done += len;
+		ptr += len;
+		if (ptr == end)
+			ptr = buf->data;
+	}
+
+	*left -= done;
+	ctx->pending += done;
+	update_freq_ctr(&comp_bps_in, done);
+
+	if (!*left && !ctx->finished) {
+		if (comp_deflate(ctx, NULL, 0, Z_FINISH) < 0)
+			return -1;
+	}
+	else if (ctx->pending && !ctx->out_len && !buf->send_max) {
+		if (comp_deflate(ctx, NULL, 0, Z_SYNC_FLUSH) < 0)
+			return -1;
+		ctx->pending = 0;
+	}
+
+	/* 2: find how much compressed data may be inserted as one chunk
+	 * between the scheduled data and the remaining raw data. Each chunk
+	 * costs at most 8 hex digits and two CRLF, and the last one needs 5
+	 * more bytes. The read limit of the response keeps MAXREWRITE bytes
+	 * free for them, so that the raw data cannot block the compressed ones.
+	 */
+	sched = buf->send_max;
+	rest = buf->l - sched - done;
+	room = BUFSIZE - sched - rest - 12;
+
+	chunk = ctx->out_len;
+	if (chunk > room)
+		chunk = room > 0 ? room : 0;
+	term = ctx->finished && chunk == ctx->out_len && chunk + 5 <= room;
+
+	if (!done && !chunk && !term)
+		return 0;
+
+	/* 3: rebuild the buffer, starting with the scheduled data */
+	out = trash;
+	len = end - buf->w;
+	if (len > sched)
+		len = sched;
+	memcpy(out, buf->w, len);
+	memcpy(out + len, buf->data, sched - len);
+	out += sched;
+
+	if (chunk) {
+		out += sprintf(out, "%x\r\n", chunk);
+		memcpy(out, ctx->out, chunk);
+		out += chunk;
+		memcpy(out, "\r\n", 2);
+		out += 2;
+		ctx->out_len -= chunk;
+		memmove(ctx->out, ctx->out + chunk, ctx->out_len);
+	}
+
+	if (term) {
+		memcpy(out, "0\r\n\r\n", 5);
+		out += 5;
+	}
+
+	sched = out - trash;
+	len = end - ptr;
+	if (len > rest)
+		len = rest;
+	memcpy(out, ptr, len);
+	memcpy(out + len, buf->data, rest - len);
+	out += rest;
+
+	buf->l = out - trash;
+	memcpy(buf->data, trash, buf->l);
+	buf->w = buf->data;
+	buf->r = buf->data + buf->l;
+	if (buf->r == end)
+		buf->r = buf->data;
+	buf->lr = buf->r;
+	buf->send_max = sched;
+
+	buf->flags &= ~(BF_EMPTY|BF_FULL);
+	if (buf->l == 0)
+		buf->flags |= BF_EMPTY;
+	if (buf->l >= buf->max_len)
+		buf->flags |= BF_FULL;
+
+	return term;
+}
+
+#endif /* USE_ZLIB */
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -29,6 +29,7 @@
 #include <common/debug.h>
 #include <common/memory.h>
 #include <common/mini-clist.h>
+#include <common/regex.h>
 #include <common/standard.h>
 #include <common/ticks.h>
 #include <common/time.h>
@@ -42,6 +43,8 @@
 #include <proto/dumpstats.h>
 #include <proto/fd.h>
 #include <proto/freq_ctr.h>
+#include <proto/histo.h>
+#include <proto/log.h>
 #include <proto/pipe.h>
 #include <proto/proto_uxst.h>
 #include <proto/session.h>
@@ -177,9 +180,29 @@ int print_csv_header(struct chunk *msg, int size)
 			    "chkfail,chkdown,lastchg,downtime,qlimit,"
 			    "pid,iid,sid,throttle,lbtot,tracked,type,"
 			    "rate,rate_lim,rate_max,"
+			    "tw50,tw90,tw99,tc50,tc90,tc99,tr50,tr90,tr99,"
 			    "\n");
 }
 
+/* Appends to <msg> the CSV fields reporting the 50th, 90th and 99th
+ * percentiles of the HISTO_TIMERS histograms of <histo>, which are empty for
+ * histograms without any value.
+ */
+static void print_csv_histo(struct chunk *msg, int size, const struct histo *histo)
+{
+	static const int pct[3] = { 50, 90, 99 };
+	int t, p;
+
+	for (t = 0; t < HISTO_TIMERS; t++) {
+		for (p = 0; p < 3; p++) {
+			if (histo[t].count)
+				chunk_printf(msg, size, "%d,", histo_percentile(&histo[t], pct[p]));
+			else
+				chunk_printf(msg, size, ",");
+		}
+	}
+}
+
 /*
  * Produces statistics data for the session <s>. Expects to be called with
  * client socket shut down on input. It *may* make use of informations from
@@ -238,6 +261,8 @@ int stats_dump_raw(struct session *s, struct buffer *rep, struct uri_auth *uri)
 				     "PipesFree: %d\n"
 				     "Tasks: %d\n"
 				     "Run_queue: %d\n"
+				     "LogDrops: %u\n"
+				     "LogStreamDrops: %u\n"
 				     "node: %s\n"
 				     "description: %s\n"
 				     "",
@@ -251,6 +276,7 @@ int stats_dump_raw(struct session *s, struct buffer *rep, struct uri_auth *uri)
 				     global.maxsock, global.maxconn, global.maxpipes,
 				     actconn, pipes_used, pipes_free,
 				     nb_tasks_cur, run_queue_cur,
+				     log_drops, log_stream_drops,
 				     global.node, global.desc?global.desc:""
 				     );
 			if (buffer_write_chunk(rep, &msg) >= 0)
@@ -761,6 +787,8 @@ int stats_dump_proxy(struct session *s, struct proxy *px, struct uri_auth *uri)
 				     "%d,%d,0,,,,%d,"
 				     /* rate, rate_lim, rate_max, */
 				     "%u,%u,%u,"
+				     /* timers percentiles: nothing */
+				     ",,,,,,,,,"
 				     "\n",
 				     px->id,
 				     px->feconn, px->feconn_max, px->maxconn, px->cum_feconn,
@@ -1001,6 +1029,9 @@ int stats_dump_proxy(struct session *s, struct proxy *px, struct uri_auth *uri)
 					     read_freq_ctr(&sv->sess_per_sec),
 					     sv->sps_max);
 
+				/* timers percentiles */
+				print_csv_histo(&msg, sizeof(trash), sv->histo);
+
 				/* finish with EOL */
 				chunk_printf(&msg, sizeof(trash), "\n");
 			}
@@ -1097,7 +1128,7 @@ int stats_dump_proxy(struct session *s, struct proxy *px, struct uri_auth *uri)
 				     "%d,%d,0,,%lld,,%d,"
 				     /* rate, rate_lim, rate_max, */
 				     "%u,,%u,"
-				     "\n",
+				     "",
 				     px->id,
 				     px->nbpend /* or px->totpend ? */, px->nbpend_max,
 				     px->beconn, px->beconn_max, px->fullconn, px->cum_beconn,
@@ -1114,6 +1145,10 @@ int stats_dump_proxy(struct session *s, struct proxy *px, struct uri_auth *uri)
 				     px->cum_lbconn, STATS_TYPE_BE,
 				     read_freq_ctr(&px->be_sess_per_sec),
 				     px->be_sps_max);
+
+				/* timers percentiles */
+				print_csv_histo(&msg, sizeof(trash), px->histo);
+				chunk_printf(&msg, sizeof(trash), "\n");
 			}
 			if (buffer_write_chunk(rep, &msg) >= 0)
 				return 0;
@@ -1549,6 +1584,205 @@ void stats_dump_errors_to_buffer(struct session *s, struct buffer *rep)
 }
 
 
+/* This function is called to send output to the response buffer.
+ * It dumps the hit counters of the "block" rules and of the request and
+ * response regex filters of all proxies onto the output buffer <rep>, one
+ * rule per line, in the order they are currently evaluated. Each line reports
+ * the proxy name and ID, the chain ("block", "req" or "rsp"), the position in
+ * the chain, the action, the number of hits and the rule itself (config line
+ * for "block" rules, regex for the other ones).
+ * Expects to be called with client socket shut down on input.
+ * s->data_ctx must have been zeroed first, and the flags properly set.
+ * It automatically clears the HIJACK bit from the response buffer.
+ */
+void stats_dump_filters_to_buffer(struct session *s, struct buffer *rep)
+{
+	static const char *act_name[] = {
+		[ACT_ALLOW] = "allow", [ACT_REPLACE] = "replace", [ACT_REMOVE] = "remove",
+		[ACT_DENY] = "deny", [ACT_PASS] = "pass", [ACT_TARPIT] = "tarpit",
+		[ACT_SETBE] = "setbe",
+	};
+	static const char *chain_name[] = { "block", "req", "rsp" };
+	struct chunk msg;
+
+	if (unlikely(rep->flags & (BF_WRITE_ERROR|BF_SHUTW))) {
+		s->data_state = DATA_ST_FIN;
+		buffer_stop_hijack(rep);
+		s->ana_state = STATS_ST_CLOSE;
+		return;
+	}
+
+	if (s->ana_state != STATS_ST_REP)
+		return;
+
+	msg.len = 0;
+	msg.str = trash;
+
+	if (!s->data_ctx.filters.px) {
+		/* the function had not been called yet, let's prepare the
+		 * buffer for a response.
+		 */
+		stream_int_retnclose(rep->cons, &msg);
+		s->data_ctx.filters.px = proxy;
+		s->data_ctx.filters.chain = 0;
+		s->data_ctx.filters.pos = 0;
+	}
+
+	while (s->data_ctx.filters.px) {
+		struct proxy *px = s->data_ctx.filters.px;
+		unsigned int pos = 0;
+
+		if (s->data_ctx.filters.iid >= 0 && px->uuid != s->data_ctx.filters.iid)
+			goto next_proxy;
+
+		if (s->data_ctx.filters.chain == 0) {
+			struct acl_cond *cond;
+
+			list_for_each_entry(cond, &px->block_cond, list) {
+				if (pos++ < s->data_ctx.filters.pos)
+					continue;
+				chunk_printf(&msg, sizeof(trash), "%s (#%d) %s %u deny %u line %d\n",
+					     px->id, px->uuid, chain_name[0], pos - 1,
+					     cond->hits, cond->line);
+				if (buffer_write_chunk(rep, &msg) >= 0)
+					return;
+				s->data_ctx.filters.pos = pos;
+			}
+		}
+		else {
+			struct hdr_exp *exp;
+
+			exp = (s->data_ctx.filters.chain == 1) ? px->req_exp : px->rsp_exp;
+			for (; exp; exp = exp->next) {
+				if (pos++ < s->data_ctx.filters.pos)
+					continue;
+				chunk_printf(&msg, sizeof(trash), "%s (#%d) %s %u %s %u %s\n",
+					     px->id, px->uuid,
+					     chain_name[s->data_ctx.filters.chain], pos - 1,
+					     act_name[exp->action], exp->hits,
+					     exp->str ? exp->str : "");
+				if (buffer_write_chunk(rep, &msg) >= 0)
+					return;
+				s->data_ctx.filters.pos = pos;
+			}
+		}
+
+		s->data_ctx.filters.pos = 0;
+		if (++s->data_ctx.filters.chain <= 2)
+			continue;
+	next_proxy:
+		s->data_ctx.filters.pos = 0;
+		s->data_ctx.filters.chain = 0;
+		s->data_ctx.filters.px = px->next;
+	}
+
+	/* dump complete */
+	buffer_stop_hijack(rep);
+	s->ana_state = STATS_ST_CLOSE;
+}
+
+/* This function dumps the histograms of the queue, connect and response times
+ * of each backend and of its servers, one timer per line. Each line reports
+ * the proxy name and ID, the service name (BACKEND or the server's), the timer
+ * ("tw", "tc" or "tr"), the number of values, the 50th, 90th and 99th
+ * percentiles, then each non-empty bin as its lowest value followed by a colon
+ * and its count.
+ * Expects to be called with client socket shut down on input.
+ * s->data_ctx must have been zeroed first, and the flags properly set.
+ * It automatically clears the HIJACK bit from the response buffer.
+ */
+void stats_dump_histo_to_buffer(struct session *s, struct buffer *rep)
+{
+	static const char *timer_name[HISTO_TIMERS] = {
+		[HISTO_QUEUE] = "tw", [HISTO_CONNECT] = "tc", [HISTO_RESPONSE] = "tr",
+	};
+	struct chunk msg;
+
+	if (unlikely(rep->flags & (BF_WRITE_ERROR|BF_SHUTW))) {
+		s->data_state = DATA_ST_FIN;
+		buffer_stop_hijack(rep);
+		s->ana_state = STATS_ST_CLOSE;
+		return;
+	}
+
+	if (s->ana_state != STATS_ST_REP)
+		return;
+
+	msg.len = 0;
+	msg.str = trash;
+
+	if (!s->data_ctx.histo.px) {
+		/* the function had not been called yet, let's prepare the
+		 * buffer for a response.
+		 */
+		stream_int_retnclose(rep->cons, &msg);
+		s->data_ctx.histo.px = proxy;
+		s->data_ctx.histo.sv = NULL;
+		s->data_ctx.histo.in_srv = 0;
+		s->data_ctx.histo.timer = 0;
+	}
+
+	while (s->data_ctx.histo.px) {
+		struct proxy *px = s->data_ctx.histo.px;
+
+		if (!(px->cap & PR_CAP_BE) ||
+		    (s->data_ctx.histo.iid >= 0 && px->uuid != s->data_ctx.histo.iid))
+			goto next_proxy;
+
+		while (1) {
+			const struct histo *histo;
+			const char *name;
+			int bin;
+
+			if (s->data_ctx.histo.timer == HISTO_TIMERS) {
+				/* the backend comes first, then its servers */
+				s->data_ctx.histo.timer = 0;
+				s->data_ctx.histo.sv = s->data_ctx.histo.in_srv ?
+					s->data_ctx.histo.sv->next : px->srv;
+				s->data_ctx.histo.in_srv = 1;
+			}
+
+			if (!s->data_ctx.histo.in_srv) {
+				histo = &px->histo[s->data_ctx.histo.timer];
+				name = "BACKEND";
+			}
+			else if (s->data_ctx.histo.sv) {
+				histo = &s->data_ctx.histo.sv->histo[s->data_ctx.histo.timer];
+				name = s->data_ctx.histo.sv->id;
+			}
+			else
+				break;
+
+			chunk_printf(&msg, sizeof(trash), "%s (#%d) %s %s %u %d %d %d",
+				     px->id, px->uuid, name,
+				     timer_name[s->data_ctx.histo.timer], histo->count,
+				     histo_percentile(histo, 50), histo_percentile(histo, 90),
+				     histo_percentile(histo, 99));
+
+			for (bin = 0; bin < HISTO_BINS; bin++)
+				if (histo->bins[bin])
+					chunk_printf(&msg, sizeof(trash), " %u:%u",
+						     histo_bin_value(bin), histo->bins[bin]);
+
+			chunk_printf(&msg, sizeof(trash), "\n");
+			if (buffer_write_chunk(rep, &msg) >= 0)
+				return;
+			s->data_ctx.histo.timer++;
+		}
+
+	next_proxy:
+		s->data_ctx.histo.sv = NULL;
+		s->data_ctx.histo.in_srv = 0;
+		s->data_ctx.histo.timer = 0;
+		s->data_ctx.histo.px = px->next;
+	}
+
+	/* dump complete */
+	buffer_stop_hijack(rep);
+	s->ana_state = STATS_ST_CLOSE;
+}
+
+
 static struct cfg_kw_list cfg_kws = {{ },{
 	{ CFG_GLOBAL, "stats", stats_parse_global },
 	{ 0, NULL, NULL },
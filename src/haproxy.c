@@ -79,10 +79,13 @@
 #include <proto/acl.h>
 #include <proto/backend.h>
 #include <proto/buffers.h>
+#include <proto/cache.h>
 #include <proto/checks.h>
 #include <proto/client.h>
+#include <proto/compression.h>
 #include <proto/fd.h>
 #include <proto/log.h>
+#include <proto/map.h>
 #include <proto/protocols.h>
 #include <proto/proto_http.h>
 #include <proto/proxy.h>
@@ -412,6 +415,9 @@ void init(int argc, char **argv)
 	init_buffer();
 	init_pendconn();
 	init_proto_http();
+#ifdef USE_ZLIB
+	init_compression();
+#endif
 
 	global.tune.options |= GTUNE_USE_SELECT;  /* select() is always available */
 #if defined(ENABLE_POLL)
@@ -696,6 +702,10 @@ void deinit(void)
 	struct user_auth *user;
 	int i;
 
+	/* the pending logs reference the log servers of the proxies */
+	flush_log_ring();
+	close_log_streams(0);
+
 	while (p) {
 		free(p->id);
 		free(p->check_req);
@@ -734,6 +744,7 @@ void deinit(void)
 
 			if (exp->replace && exp->action != ACT_SETBE)
 				free((char *)exp->replace);
+			free((char *)exp->str);
 			expb = exp;
 			exp = exp->next;
 			free(expb);
@@ -747,6 +758,7 @@ void deinit(void)
 
 			if (exp->replace && exp->action != ACT_SETBE)
 				free((char *)exp->replace);
+			free((char *)exp->str);
 			expb = exp;
 			exp = exp->next;
 			free(expb);
@@ -776,20 +788,43 @@ void deinit(void)
 
 		list_for_each_entry_safe(rule, ruleb, &p->switching_rules, list) {
 			LIST_DEL(&rule->list);
-			prune_acl_cond(rule->cond);
-			free(rule->cond);
+			if (rule->cond) {
+				prune_acl_cond(rule->cond);
+				free(rule->cond);
+			}
+			map_free(rule->map);
+			free(rule->key.name);
 			free(rule);
 		}
 
 		list_for_each_entry_safe(rdr, rdrb, &p->redirect_rules, list) {
 			LIST_DEL(&rdr->list);
-			prune_acl_cond(rdr->cond);
-			free(rdr->cond);
+			if (rdr->cond) {
+				prune_acl_cond(rdr->cond);
+				free(rdr->cond);
+			}
+			if (rdr->map) {
+				struct map_entry *entry;
+				struct redirect_msg *msg;
+
+				list_for_each_entry(entry, &rdr->map->entries, list) {
+					msg = entry->ptr;
+					if (msg)
+						free(msg->head.str);
+					free(msg);
+				}
+				map_free(rdr->map);
+			}
+			if (rdr->msg)
+				free(rdr->msg->head.str);
+			free(rdr->msg);
+			free(rdr->key.name);
 			free(rdr->rdr_str);
 			free(rdr);
 		}
 
 		free(p->appsession_name);
+		cache_free(p->cache);
 
 		h = p->req_cap;
 		while (h) {
@@ -820,6 +855,10 @@ void deinit(void)
 
 			free(s->id);
 			free(s->cookie);
+			free(s->rdr_pfx);
+			if (s->rdr_msg)
+				free(s->rdr_msg->head.str);
+			free(s->rdr_msg);
 			free(s);
 			s = s_next;
 		}/* end while(s) */
@@ -873,6 +912,11 @@ void deinit(void)
 	pool_destroy2(pool2_capture);
 	pool_destroy2(pool2_appsess);
 	pool_destroy2(pool2_pendconn);
+	pool_destroy2(pool2_acl_cache);
+	pool_destroy2(pool2_body_spill);
+#ifdef USE_ZLIB
+	pool_destroy2(pool2_comp_ctx);
+#endif
     
 	if (have_appsession) {
 		pool_destroy2(apools.serverid);
@@ -918,6 +962,10 @@ void run_poll_loop()
 		 * numbers of proxies. */
 		maintain_proxies(&next);
 
+		/* send the logs produced by this round */
+		flush_log_ring();
+		flush_log_streams(&next);
+
 		/* stop when there's no connection left and we don't allow them anymore */
 		if (!actconn && listeners == 0)
 			break;
@@ -933,6 +981,7 @@ int main(int argc, char **argv)
 	int err, retry;
 	struct rlimit limit;
 	FILE *pidfile = NULL;
+	const char *logfile;
 	init(argc, argv);
 
 	signal_register(SIGQUIT, dump);
@@ -1014,6 +1063,14 @@ int main(int argc, char **argv)
 	}
 
 	/* open log & pid files before the chroot */
+	if ((logfile = open_log_files()) != NULL) {
+		Alert("[%s.main()] Cannot open log file %s\n", argv[0], logfile);
+		if (nb_oldpids)
+			tell_old_pids(SIGTTIN);
+		protocol_unbind_all();
+		exit(1);
+	}
+
 	if (global.mode & MODE_DAEMON && global.pidfile != NULL) {
 		int pidfd;
 		unlink(global.pidfile);
@@ -1145,6 +1202,10 @@ int main(int argc, char **argv)
 		int ret = 0;
 		int proc;
 
+		/* the children must not inherit pending logs nor log connections */
+		flush_log_ring();
+		close_log_streams(1);
+
 		/* the father launches the required number of processes */
 		for (proc = 0; proc < global.nbproc; proc++) {
 			ret = fork();
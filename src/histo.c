@@ -0,0 +1,58 @@
+/*
+ * Timer histograms.
+ *
+ * Copyright 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <common/config.h>
+
+#include <types/histo.h>
+
+#include <proto/histo.h>
+
+/* Halves all the bins of histogram <h> so that it does not overflow, and so
+ * that old values weigh less than new ones.
+ */
+void histo_halve(struct histo *h)
+{
+	int bin;
+
+	h->count = 0;
+	for (bin = 0; bin < HISTO_BINS; bin++) {
+		h->bins[bin] /= 2;
+		h->count += h->bins[bin];
+	}
+}
+
+/* Returns the lowest value of the bin of histogram <h> below which <pct>
+ * percent of its values are, or -1 if it is empty.
+ */
+int histo_percentile(const struct histo *h, int pct)
+{
+	unsigned long long thres, cum = 0;
+	int bin;
+
+	if (!h->count)
+		return -1;
+
+	thres = ((unsigned long long)h->count * pct + 99) / 100;
+	for (bin = 0; bin < HISTO_BINS - 1; bin++) {
+		cum += h->bins[bin];
+		if (cum >= thres)
+			break;
+	}
+	return histo_bin_value(bin);
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
@@ -10,6 +10,10 @@
  *
  */
 
+#ifdef CONFIG_HAP_SENDMMSG
+#define _GNU_SOURCE
+#endif
+
 #include <fcntl.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -21,15 +25,22 @@
 #include <errno.h>
 
 #include <sys/time.h>
+#include <sys/un.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
 
 #include <common/config.h>
 #include <common/compat.h>
 #include <common/standard.h>
+#include <common/ticks.h>
 #include <common/time.h>
 
 #include <types/global.h>
 
+#include <proto/fd.h>
+#include <proto/freq_ctr.h>
 #include <proto/log.h>
+#include <proto/proto_http.h>
 
 const char *log_facilities[NB_LOG_FACILITIES] = {
 	"kern", "user", "mail", "daemon",
@@ -156,30 +167,31 @@ static inline int logsrv_addrlen(const struct logsrv *logsrv)
 	return -1;
 }
 
+/* Log messages waiting to be sent, starting at <log_ring_head>. */
+static struct log_entry log_ring[LOG_RING_SIZE];
+static int log_ring_head = 0;
+static int log_ring_count = 0;
+unsigned int log_drops = 0;
+
+/* all stream log targets, and the number of messages they dropped */
+static struct log_stream *log_streams = NULL;
+unsigned int log_stream_drops = 0;
+
+/* The syslog message being built. Its header is rebuilt once a second, and
+ * the data are written after it at <dataptr>.
+ */
+static char logmsg[MAX_SYSLOG_LEN];
+static char *dataptr = NULL;
+
 /*
- * This function sends a syslog message to both log servers of a proxy,
- * or to global log servers if the proxy is NULL.
- * It also tries not to waste too much time computing the message header.
- * It doesn't care about errors nor does it report them.
+ * Returns the address where the data of the next log message may be written,
+ * right after the syslog header, and stores into <size> the number of bytes
+ * available there. The message is then sent with send_log_buffer().
  */
-void send_log(struct proxy *p, int level, const char *message, ...)
+char *get_log_buffer(int *size)
 {
-	static int logfdunix = -1;	/* syslog to AF_UNIX socket */
-	static int logfdinet = -1;	/* syslog to AF_INET socket */
 	static long tvsec = -1;	/* to force the string to be initialized */
-	va_list argp;
-	static char logmsg[MAX_SYSLOG_LEN];
-	static char *dataptr = NULL;
-	int fac_level;
-	int hdr_len, data_len;
-	struct logsrv *logsrvs[2];
-	int facilities[2], loglevel[2], minlvl[2];
-	int nblogger;
-	int nbloggers = 0;
-	char *log_ptr;
-
-	if (level < 0 || progname == NULL || message == NULL)
-		return;
+	int hdr_len;
 
 	if (unlikely(date.tv_sec != tvsec || dataptr == NULL)) {
 		/* this string is rebuild only once a second */
@@ -203,16 +215,507 @@ void send_log(struct proxy *p, int level, const char *message, ...)
 		dataptr = logmsg + hdr_len;
 	}
 
-	va_start(argp, message);
-	/*
-	 * FIXME: we take a huge performance hit here. We might have to replace
-	 * vsnprintf() for a hard-coded log writer.
-	 */
-	data_len = vsnprintf(dataptr, logmsg + sizeof(logmsg) - dataptr, message, argp);
-	if (data_len < 0 || data_len > (logmsg + sizeof(logmsg) - dataptr))
-		data_len = logmsg + sizeof(logmsg) - dataptr;
-	va_end(argp);
-	dataptr[data_len - 1] = '\n'; /* force a break on ultra-long lines */
+	*size = logmsg + sizeof(logmsg) - dataptr;
+	return dataptr;
+}
+
+/*
+ * Writes the date of <tv> at <dst> in the "dd/Mon/yyyy:hh:mm:ss.mmm" format
+ * of the logs, followed by a trailing zero, provided that it fits before
+ * <end>. Only the milliseconds are computed for each call, the rest is rebuilt
+ * once a second. Returns a pointer to the trailing zero, or NULL.
+ */
+char *lf_date(char *dst, const char *end, const struct timeval *tv)
+{
+	static time_t cached_sec = -1;
+	static char cached[21]; /* "dd/Mon/yyyy:hh:mm:ss" + trailing zero */
+
+	if (!dst || end - dst < sizeof(cached) + 4)
+		return NULL;
+
+	if (unlikely(tv->tv_sec != cached_sec)) {
+		struct tm tm;
+		char *p;
+
+		cached_sec = tv->tv_sec;
+		get_localtime(cached_sec, &tm);
+		p = utoa_pad(tm.tm_mday, cached, 3);
+		*p++ = '/';
+		memcpy(p, monthname[tm.tm_mon], 3);
+		p += 3;
+		*p++ = '/';
+		p = utoa_pad(tm.tm_year + 1900, p, 5);
+		*p++ = ':';
+		p = utoa_pad(tm.tm_hour, p, 3);
+		*p++ = ':';
+		p = utoa_pad(tm.tm_min, p, 3);
+		*p++ = ':';
+		utoa_pad(tm.tm_sec, p, 3);
+	}
+
+	memcpy(dst, cached, sizeof(cached) - 1);
+	dst += sizeof(cached) - 1;
+	*dst++ = '.';
+	return utoa_pad((unsigned int)tv->tv_usec / 1000, dst, 4);
+}
+
+/*
+ * Writes the address and port of <addr> at <dst> as "ip:port", followed by a
+ * trailing zero, provided that it fits before <end>. IPv4 addresses are
+ * converted by hand. Returns a pointer to the trailing zero, or NULL.
+ */
+char *lf_addr(char *dst, const char *end, const struct sockaddr_storage *addr)
+{
+	const unsigned char *ip;
+	int port, i;
+
+	if (!dst)
+		return NULL;
+
+	if (addr->ss_family == AF_INET) {
+		if (end - dst < 16)
+			return NULL;
+		ip = (const unsigned char *)&((struct sockaddr_in *)addr)->sin_addr;
+		for (i = 0; i < 4; i++) {
+			if (i)
+				*dst++ = '.';
+			if (ip[i] >= 100)
+				*dst++ = '0' + ip[i] / 100;
+			if (ip[i] >= 10)
+				*dst++ = '0' + ip[i] / 10 % 10;
+			*dst++ = '0' + ip[i] % 10;
+		}
+		port = ntohs(((struct sockaddr_in *)addr)->sin_port);
+	}
+	else {
+		if (!inet_ntop(AF_INET6, (const void *)&((struct sockaddr_in6 *)addr)->sin6_addr,
+			       dst, end - dst))
+			return NULL;
+		dst += strlen(dst);
+		port = ntohs(((struct sockaddr_in6 *)addr)->sin6_port);
+	}
+
+	dst = lf_char(dst, end, ':');
+	return lf_ulong(dst, end, port);
+}
+
+/*
+ * Sends the log messages waiting in the ring, in the order they were queued.
+ * Consecutive messages sent from the same socket are grouped into a single
+ * sendmmsg() call when it is supported. Messages which cannot be sent yet are
+ * kept for the next call, others are dropped on error.
+ */
+void flush_log_ring()
+{
+#ifdef CONFIG_HAP_SENDMMSG
+	static int no_sendmmsg = 0;
+	struct mmsghdr msgs[LOG_BATCH];
+	struct iovec iov[LOG_BATCH];
+#endif
+	struct log_entry *e;
+	int n, sent;
+
+	while (log_ring_count) {
+		e = &log_ring[log_ring_head];
+
+		/* group the messages sent from the same socket, without wrapping */
+		n = 1;
+		while (n < LOG_BATCH && n < log_ring_count &&
+		       log_ring_head + n < LOG_RING_SIZE && e[n].fd == e->fd)
+			n++;
+
+#ifdef CONFIG_HAP_SENDMMSG
+		if (!no_sendmmsg) {
+			int i;
+
+			for (i = 0; i < n; i++) {
+				iov[i].iov_base = e[i].msg;
+				iov[i].iov_len = e[i].len;
+				memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+				msgs[i].msg_hdr.msg_name = (void *)&e[i].srv->u.addr;
+				msgs[i].msg_hdr.msg_namelen = logsrv_addrlen(e[i].srv);
+				msgs[i].msg_hdr.msg_iov = &iov[i];
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+
+			sent = sendmmsg(e->fd, msgs, n, MSG_DONTWAIT | MSG_NOSIGNAL);
+			if (sent < 0 && errno == ENOSYS) {
+				/* old kernel, fall back to sendto() */
+				no_sendmmsg = 1;
+				continue;
+			}
+		}
+		else
+#endif
+		{
+			sent = sendto(e->fd, e->msg, e->len, MSG_DONTWAIT | MSG_NOSIGNAL,
+				      &e->srv->u.addr, logsrv_addrlen(e->srv));
+			if (sent >= 0)
+				sent = 1;
+		}
+
+		if (sent <= 0) {
+			if (errno == EAGAIN)
+				return;
+			Alert("sendto logger #%d failed: %s (errno=%d)\n",
+			      e->logger, strerror(errno), errno);
+			sent = 1;
+		}
+
+		log_ring_head = (log_ring_head + sent) % LOG_RING_SIZE;
+		log_ring_count -= sent;
+	}
+}
+
+/*
+ * Appends the <len> bytes of syslog message <msg> to the ring, for log server
+ * <srv> which is reached from socket <fd>. If the ring is full, it is flushed
+ * first, and the message is dropped if there is still no room.
+ */
+static void queue_log(const struct logsrv *srv, int fd, int logger, const char *msg, int len)
+{
+	struct log_entry *e;
+
+	if (log_ring_count == LOG_RING_SIZE) {
+		flush_log_ring();
+		if (log_ring_count == LOG_RING_SIZE) {
+			log_drops++;
+			return;
+		}
+	}
+
+	e = &log_ring[(log_ring_head + log_ring_count) % LOG_RING_SIZE];
+	e->srv = srv;
+	e->fd = fd;
+	e->logger = logger;
+	e->len = len;
+	memcpy(e->msg, msg, len);
+	log_ring_count++;
+}
+
+/*
+ * Returns the stream log target of type <type> (LOG_STREAM_*) for <path>,
+ * which is created if it does not exist yet, so that all the loggers using
+ * the same path share the same connection. Returns NULL if the path is too
+ * long or if memory is lacking.
+ */
+struct log_stream *get_log_stream(int type, const char *path)
+{
+	struct log_stream *st;
+
+	if (strlen(path) >= sizeof(st->addr.sun_path))
+		return NULL;
+
+	for (st = log_streams; st; st = st->next)
+		if (st->type == type && strcmp(st->addr.sun_path, path) == 0)
+			return st;
+
+	st = calloc(1, sizeof(*st));
+	if (!st)
+		return NULL;
+
+	st->type = type;
+	st->fd = -1;
+	st->retry = TICK_ETERNITY;
+	st->addr.sun_family = AF_UNIX;
+	strcpy(st->addr.sun_path, path);
+	st->next = log_streams;
+	log_streams = st;
+	global.maxsock++; /* one more fd */
+	return st;
+}
+
+/* Accounts for <n> messages dropped by stream log target <st>. */
+static inline void log_stream_dropped(struct log_stream *st, int n)
+{
+	st->drops += n;
+	log_stream_drops += n;
+	log_drops += n;
+}
+
+/* Closes the fd of stream log target <st> and schedules a new connection. */
+static void log_stream_close(struct log_stream *st)
+{
+	char *nl;
+
+	if (st->type == LOG_STREAM_UNIX)
+		fd_delete(st->fd);
+	else
+		close(st->fd);
+	st->fd = -1;
+	st->retry = tick_add(now_ms, MS_TO_TICKS(1000));
+
+	/* a message which was partially sent cannot be completed */
+	if (st->partial) {
+		nl = memchr(st->buf + st->o, '\n', st->l);
+		if (nl) {
+			st->l -= nl + 1 - (st->buf + st->o);
+			st->o = nl + 1 - st->buf;
+		} else
+			st->l = 0;
+		st->partial = 0;
+		log_stream_dropped(st, 1);
+	}
+}
+
+/*
+ * Writes as much of the pending data of stream log target <st> as possible.
+ * If the socket is full, it is polled for writing, unless the polling loop
+ * does not run yet. Returns the number of bytes written, or -1 if the target
+ * was closed because of an error.
+ */
+static int log_stream_write(struct log_stream *st)
+{
+	int ret, done = 0;
+
+	while (st->l) {
+		if (st->type == LOG_STREAM_UNIX)
+			ret = send(st->fd, st->buf + st->o, st->l, MSG_DONTWAIT | MSG_NOSIGNAL);
+		else
+			ret = write(st->fd, st->buf + st->o, st->l);
+
+		if (ret > 0) {
+			st->o += ret;
+			st->l -= ret;
+			st->partial = (st->buf[st->o - 1] != '\n');
+			done += ret;
+			continue;
+		}
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+
+		if (ret < 0 && errno == EAGAIN) {
+			if (st->type == LOG_STREAM_UNIX && !(global.mode & MODE_STARTING))
+				EV_FD_COND_S(st->fd, DIR_WR);
+			return done;
+		}
+
+		log_stream_close(st);
+		return -1;
+	}
+
+	st->o = 0;
+	if (st->type == LOG_STREAM_UNIX && !(global.mode & MODE_STARTING))
+		EV_FD_COND_C(st->fd, DIR_WR);
+	return done;
+}
+
+/*
+ * I/O handler of the stream log targets' sockets, which are only polled for
+ * writing, either to complete a connection or because they were full. Returns
+ * non-zero if some data could be written.
+ */
+static int log_stream_io(int fd)
+{
+	struct log_stream *st = fdtab[fd].owner;
+	int err = 0;
+	socklen_t len = sizeof(err);
+
+	if (fdtab[fd].state == FD_STCONN) {
+		if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == -1 || err) {
+			log_stream_close(st);
+			return 1;
+		}
+		fdtab[fd].state = FD_STREADY;
+	}
+
+	return log_stream_write(st) != 0;
+}
+
+/*
+ * Opens the file or connects the socket of stream log target <st>, at most
+ * once a second. Returns the fd, or -1 if it is not available yet.
+ */
+static int log_stream_connect(struct log_stream *st)
+{
+	int fd, state;
+
+	if (tick_isset(st->retry) && !tick_is_expired(st->retry, now_ms))
+		return -1;
+	st->retry = tick_add(now_ms, MS_TO_TICKS(1000));
+
+	if (st->type == LOG_STREAM_FILE) {
+		fd = open(st->addr.sun_path, O_WRONLY | O_CREAT | O_APPEND | O_NONBLOCK, 0644);
+		if (fd < 0)
+			return -1;
+		st->fd = fd;
+		st->retry = TICK_ETERNITY;
+		return fd;
+	}
+
+	/* the fd table and the poller must be ready */
+	if (!fdtab || !cur_poller.clo)
+		return -1;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	if (fd >= global.maxsock || fcntl(fd, F_SETFL, O_NONBLOCK) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	state = FD_STREADY;
+	if (connect(fd, (struct sockaddr *)&st->addr, sizeof(st->addr)) == -1) {
+		if (errno != EINPROGRESS) {
+			close(fd);
+			return -1;
+		}
+		state = FD_STCONN;
+	}
+
+	/* we don't want to receive anything on this socket */
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &zero, sizeof(zero));
+
+	fd_insert(fd);
+	fdtab[fd].owner = st;
+	fdtab[fd].cb[DIR_RD].f = NULL; /* never polled */
+	fdtab[fd].cb[DIR_RD].b = NULL;
+	fdtab[fd].cb[DIR_WR].f = log_stream_io;
+	fdtab[fd].cb[DIR_WR].b = NULL;
+	fdtab[fd].peeraddr = (struct sockaddr *)&st->addr;
+	fdtab[fd].peerlen = sizeof(st->addr);
+	fdtab[fd].state = state;
+	st->fd = fd;
+	st->retry = TICK_ETERNITY;
+
+	if (fdtab[fd].state == FD_STCONN && !(global.mode & MODE_STARTING))
+		EV_FD_SET(fd, DIR_WR);
+	return fd;
+}
+
+/*
+ * Appends the <len> bytes of message <msg> to the buffer of stream log target
+ * <st>, or drops it if there is no room left. The buffer is written by
+ * flush_log_streams().
+ */
+static void log_stream_queue(struct log_stream *st, const char *msg, int len)
+{
+	if (st->o + st->l + len > LOG_STREAM_BUFSIZE) {
+		memmove(st->buf, st->buf + st->o, st->l);
+		st->o = 0;
+	}
+
+	if (st->l + len > LOG_STREAM_BUFSIZE) {
+		log_stream_dropped(st, 1);
+		return;
+	}
+
+	memcpy(st->buf + st->o + st->l, msg, len);
+	st->l += len;
+}
+
+/*
+ * Writes the messages waiting for the stream log targets which are not polled
+ * yet, opening them if needed. <next> is updated, if not NULL, so that targets
+ * which could not be opened are retried in time.
+ */
+void flush_log_streams(int *next)
+{
+	struct log_stream *st;
+
+	for (st = log_streams; st; st = st->next) {
+		if (!st->l)
+			continue;
+
+		if (st->fd < 0 && log_stream_connect(st) < 0) {
+			if (next)
+				*next = tick_first(*next, st->retry);
+			continue;
+		}
+
+		if (st->type == LOG_STREAM_UNIX && !(global.mode & MODE_STARTING) &&
+		    EV_FD_ISSET(st->fd, DIR_WR))
+			continue; /* the poller will do it */
+
+		if (st->type == LOG_STREAM_UNIX && fdtab[st->fd].state == FD_STCONN) {
+			/* the connection may have been started during startup */
+			if (!(global.mode & MODE_STARTING))
+				EV_FD_SET(st->fd, DIR_WR);
+			continue;
+		}
+
+		log_stream_write(st);
+	}
+}
+
+/*
+ * Opens the files of the "file@" log targets. This must be done before the
+ * chroot. Returns the path of the first file which could not be opened, or
+ * NULL if all of them were opened.
+ */
+const char *open_log_files()
+{
+	struct log_stream *st;
+
+	for (st = log_streams; st; st = st->next) {
+		if (st->type != LOG_STREAM_FILE || st->fd >= 0)
+			continue;
+		st->retry = TICK_ETERNITY;
+		if (log_stream_connect(st) < 0)
+			return st->addr.sun_path;
+	}
+	return NULL;
+}
+
+/*
+ * Writes what can still be written to the stream log targets, then closes
+ * their sockets, dropping the messages which remain. Files are left open if
+ * <keep_files> is set. This is used before forking, so that the processes do
+ * not share the same connections, and when stopping.
+ */
+void close_log_streams(int keep_files)
+{
+	struct log_stream *st;
+
+	for (st = log_streams; st; st = st->next) {
+		if (st->fd >= 0 && !(st->type == LOG_STREAM_UNIX &&
+				     fdtab[st->fd].state == FD_STCONN))
+			log_stream_write(st);
+
+		if (st->l) {
+			/* each pending message ends with a line feed */
+			char *p = st->buf + st->o, *end = p + st->l;
+			int n = 0;
+
+			while ((p = memchr(p, '\n', end - p)) != NULL) {
+				p++;
+				n++;
+			}
+			log_stream_dropped(st, n);
+			st->o = st->l = st->partial = 0;
+		}
+
+		if (st->fd >= 0 && !(keep_files && st->type == LOG_STREAM_FILE))
+			log_stream_close(st);
+		st->retry = TICK_ETERNITY;
+	}
+}
+/*
+ * Queues the <len> bytes of data written at the address returned by
+ * get_log_buffer() for both log servers of a proxy, or for global log servers
+ * if the proxy is NULL. The last byte is forced to a line feed. The messages
+ * are sent by flush_log_ring() and flush_log_streams() at the end of the
+ * polling loop, or immediately during startup. It doesn't care about errors
+ * nor does it report them.
+ */
+void send_log_buffer(struct proxy *p, int level, int len)
+{
+	static int logfdunix = -1;	/* syslog to AF_UNIX socket */
+	static int logfdinet = -1;	/* syslog to AF_INET socket */
+	int fac_level;
+	struct logsrv *logsrvs[2];
+	int facilities[2], loglevel[2], minlvl[2];
+	int nblogger;
+	int nbloggers = 0;
+	char *log_ptr;
+
+	if (level < 0 || progname == NULL || dataptr == NULL || len <= 0)
+		return;
+
+	dataptr[len - 1] = '\n'; /* force a break on ultra-long lines */
 
 	if (p == NULL) {
 		if (global.logfac1 >= 0) {
@@ -251,6 +754,8 @@ void send_log(struct proxy *p, int level, const char *message, ...)
 	for (nblogger = 0; nblogger < nbloggers; nblogger++) {
 		const struct logsrv *logsrv = logsrvs[nblogger];
 		int proto, *plogfd;
+		if (logsrv->stream)
+			continue;
 		if (logsrv->u.addr.sa_family == AF_UNIX) {
 			proto = 0;
 			plogfd = &logfdunix;
@@ -275,12 +780,11 @@ void send_log(struct proxy *p, int level, const char *message, ...)
 		shutdown(*plogfd, SHUT_RD);
 	}
 
-	/* Send log messages to syslog server. */
+	/* Queue log messages for the syslog servers. */
 	for (nblogger = 0; nblogger < nbloggers; nblogger++) {
 		const struct logsrv *logsrv = logsrvs[nblogger];
 		int *plogfd = logsrv->u.addr.sa_family == AF_UNIX ?
 			&logfdunix : &logfdinet;
-		int sent;
 
 		/* we can filter the level of the messages that are sent to each logger */
 		if (level > loglevel[nblogger])
@@ -302,78 +806,326 @@ void send_log(struct proxy *p, int level, const char *message, ...)
 		} while (fac_level && log_ptr > logmsg);
 		*log_ptr = '<';
 	
-		/* the total syslog message now starts at logptr, for dataptr+data_len-logptr */
-		sent = sendto(*plogfd, log_ptr, dataptr + data_len - log_ptr,
-			MSG_DONTWAIT | MSG_NOSIGNAL, &logsrv->u.addr, logsrv_addrlen(logsrv));
-		if (sent < 0) {
-			Alert("sendto logger #%d failed: %s (errno=%d)\n",
-				nblogger, strerror(errno), errno);
-		}
+		/* the total syslog message now starts at logptr, for dataptr+len-logptr */
+		if (logsrv->stream)
+			log_stream_queue(logsrv->stream, log_ptr, dataptr + len - log_ptr);
+		else
+			queue_log(logsrv, *plogfd, nblogger, log_ptr, dataptr + len - log_ptr);
+	}
+
+	/* the polling loop does not run yet */
+	if (global.mode & MODE_STARTING) {
+		flush_log_ring();
+		flush_log_streams(NULL);
 	}
 }
 
+/*
+ * This function sends a syslog message to both log servers of a proxy,
+ * or to global log servers if the proxy is NULL.
+ * It also tries not to waste too much time computing the message header.
+ * It doesn't care about errors nor does it report them.
+ */
+void send_log(struct proxy *p, int level, const char *message, ...)
+{
+	va_list argp;
+	char *ptr;
+	int size, data_len;
+
+	if (level < 0 || progname == NULL || message == NULL)
+		return;
+
+	ptr = get_log_buffer(&size);
+
+	va_start(argp, message);
+	data_len = vsnprintf(ptr, size, message, argp);
+	if (data_len < 0 || data_len > size)
+		data_len = size;
+	va_end(argp);
+
+	send_log_buffer(p, level, data_len);
+}
+
+
+/* socket connected to the "log-binary" collector, -1 if none */
+static int binlog_fd = -1;
+
+/*
+ * Connects the socket of the "log-binary" collector. Attempts are made at most
+ * once a second so that a missing collector does not cost a connect() per
+ * record. Returns the socket, or -1 if it is not available.
+ */
+static int binlog_connect()
+{
+	static long last_try = -1;
+	int fd;
+
+	if (last_try == date.tv_sec)
+		return -1;
+	last_try = date.tv_sec;
+
+	fd = socket(AF_UNIX, global.binlog_type, 0);
+	if (fd < 0)
+		return -1;
+
+	if (fcntl(fd, F_SETFL, O_NONBLOCK) == -1 ||
+	    connect(fd, &global.binlog_srv.u.addr, sizeof(global.binlog_srv.u.un)) == -1) {
+		close(fd);
+		return -1;
+	}
+
+	/* we don't want to receive anything on this socket */
+	setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &zero, sizeof(zero));
+	shutdown(fd, SHUT_RD);
+	binlog_fd = fd;
+	return fd;
+}
+
+/*
+ * Appends string <str>, which may be NULL, to the binary record <buf> of
+ * length <*len>, preceded by its length. The string is truncated so that it
+ * does not use more than <*room> bytes, which is decreased accordingly.
+ */
+static inline void binlog_str(char *buf, int *len, int *room, const char *str)
+{
+	int l = str ? strlen(str) : 0;
+	unsigned short nl;
+
+	if (l > *room)
+		l = *room;
+	*room -= l;
+
+	nl = htons(l);
+	memcpy(buf + *len, &nl, sizeof(nl));
+	if (l)
+		memcpy(buf + *len + sizeof(nl), str, l);
+	*len += sizeof(nl) + l;
+}
+
+/*
+ * Sends a binary record of type <type> (BINLOG_TCP or BINLOG_HTTP) describing
+ * session <s> to the "log-binary" collector. <svid> is the server name as it
+ * appears in the text logs, and <t_request> the request time for HTTP. The
+ * record is dropped if the collector cannot accept it immediately. On stream
+ * sockets, a partially sent record causes the connection to be closed, so
+ * that the next connection starts on a record boundary.
+ */
+void send_binlog(struct session *s, int type, const char *svid, int t_request)
+{
+	static char buf[BINLOG_MAX_LEN];
+	struct binlog_rec *rec = (struct binlog_rec *)buf;
+	struct proxy *fe = s->fe;
+	struct proxy *be = s->be;
+	struct http_txn *txn = &s->txn;
+	const struct timeval *tv;
+	int nreq, nrsp, len, room, hdr, ret;
+
+	if (binlog_fd < 0 && binlog_connect() < 0) {
+		log_drops++;
+		return;
+	}
+
+	memset(rec, 0, sizeof(*rec));
+	rec->version = BINLOG_VERSION;
+	rec->type = type;
+
+	nreq = nrsp = 0;
+	if (type == BINLOG_HTTP) {
+		tv = &s->logs.accept_date;
+		rec->t_request = htonl(t_request);
+		rec->t_queue = htonl((s->logs.t_queue >= 0) ? s->logs.t_queue - t_request : -1);
+		rec->t_data = htonl((s->logs.t_data >= 0) ? s->logs.t_data - s->logs.t_connect : -1);
+		rec->status = htons(txn->status);
+		rec->cli_ck = (be->options & PR_O_COOK_ANY) ? sess_cookie[(txn->flags & TX_CK_MASK) >> TX_CK_SHIFT] : '-';
+		rec->srv_ck = (be->options & PR_O_COOK_ANY) ? sess_set_cookie[(txn->flags & TX_SCK_MASK) >> TX_SCK_SHIFT] : '-';
+		if ((fe->to_log & LW_REQHDR) && txn->req.cap)
+			nreq = MIN(fe->nb_req_cap, 255);
+		if ((fe->to_log & LW_RSPHDR) && txn->rsp.cap)
+			nrsp = MIN(fe->nb_rsp_cap, 255);
+	}
+	else {
+		tv = &s->logs.tv_accept;
+		rec->t_request = htonl(-1);
+		rec->t_queue = htonl((s->logs.t_queue >= 0) ? s->logs.t_queue : -1);
+		rec->t_data = htonl(-1);
+		rec->cli_ck = rec->srv_ck = '-';
+	}
+
+	rec->accept_sec = htonl(tv->tv_sec);
+	rec->accept_usec = htonl(tv->tv_usec);
+	rec->t_connect = htonl((s->logs.t_connect >= 0) ? s->logs.t_connect - s->logs.t_queue : -1);
+	rec->t_close = htonl(s->logs.t_close);
+	rec->bytes_hi = htonl((unsigned long long)s->logs.bytes_out >> 32);
+	rec->bytes_lo = htonl(s->logs.bytes_out);
+	rec->actconn = htonl(actconn);
+	rec->feconn = htonl(fe->feconn);
+	rec->beconn = htonl(be->beconn);
+	rec->srv_conn = htonl(s->srv ? s->srv->cur_sess : 0);
+	rec->srv_queue = htonl(s->logs.srv_queue_size);
+	rec->prx_queue = htonl(s->logs.prx_queue_size);
+	rec->retries = htons((s->conn_retries>0)?(be->conn_retries - s->conn_retries):be->conn_retries);
+	rec->term_cond = sess_term_cond[(s->flags & SN_ERR_MASK) >> SN_ERR_SHIFT];
+	rec->fin_state = sess_fin_state[(s->flags & SN_FINST_MASK) >> SN_FINST_SHIFT];
+	rec->nb_req_cap = nreq;
+	rec->nb_rsp_cap = nrsp;
+
+	if (!(fe->to_log & LW_BYTES))
+		rec->flags |= BINLOG_F_PARTIAL;
+	if (s->flags & SN_REDISP)
+		rec->flags |= BINLOG_F_REDISP;
+
+	if (s->cli_addr.ss_family == AF_INET) {
+		memcpy(rec->cli_addr, &((struct sockaddr_in *)&s->cli_addr)->sin_addr, 4);
+		rec->cli_port = ((struct sockaddr_in *)&s->cli_addr)->sin_port;
+	}
+	else {
+		memcpy(rec->cli_addr, &((struct sockaddr_in6 *)&s->cli_addr)->sin6_addr, 16);
+		rec->cli_port = ((struct sockaddr_in6 *)&s->cli_addr)->sin6_port;
+		rec->flags |= BINLOG_F_IPV6;
+	}
+
+	/* the strings share the room left after their lengths */
+	len = sizeof(*rec);
+	room = sizeof(buf) - len - (6 + nreq + nrsp) * sizeof(unsigned short);
+
+	binlog_str(buf, &len, &room, fe->id);
+	binlog_str(buf, &len, &room, be->id);
+	binlog_str(buf, &len, &room, svid);
+	binlog_str(buf, &len, &room, (type == BINLOG_HTTP) ? txn->cli_cookie : NULL);
+	binlog_str(buf, &len, &room, (type == BINLOG_HTTP) ? txn->srv_cookie : NULL);
+	for (hdr = 0; hdr < nreq; hdr++)
+		binlog_str(buf, &len, &room, txn->req.cap[hdr]);
+	for (hdr = 0; hdr < nrsp; hdr++)
+		binlog_str(buf, &len, &room, txn->rsp.cap[hdr]);
+	binlog_str(buf, &len, &room, (type == BINLOG_HTTP) ? (txn->uri ? txn->uri : "<BADREQ>") : NULL);
+
+	rec->len = htons(len);
+
+	ret = send(binlog_fd, buf, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+	if (ret == len)
+		return;
+
+	log_drops++;
+	if (ret < 0 && (errno == EAGAIN || errno == ENOBUFS))
+		return;
+
+	/* partial record or dead collector */
+	close(binlog_fd);
+	binlog_fd = -1;
+}
+
+/*
+ * Returns non-zero if the log of session <s>, which terminated normally, must
+ * be skipped because of the sampling or the log rate limit of its frontend
+ * <fe>. Sessions are sampled on their unique ID so that the choice is
+ * deterministic and spread over all frontends. Sessions lasting at least
+ * fe->log_slow milliseconds are always logged.
+ */
+int skip_normal_log(struct session *s, struct proxy *fe)
+{
+	unsigned int h;
+
+	if (fe->log_slow && s->logs.t_close >= fe->log_slow)
+		return 0;
+
+	if (fe->log_sample_den) {
+		h = s->uniq_id * 2654435761U;
+		if (((unsigned long long)h * fe->log_sample_den) >> 32 >= fe->log_sample_num)
+			return 1;
+	}
+
+	if (fe->log_rate_lim) {
+		if (!freq_ctr_remain(&fe->log_per_sec, fe->log_rate_lim, 0))
+			return 1;
+		update_freq_ctr(&fe->log_per_sec, 1);
+	}
+	return 0;
+}
 
 /*
  * send a log for the session when we have enough info about it
  */
 void tcp_sess_log(struct session *s)
 {
-	char pn[INET6_ADDRSTRLEN + strlen(":65535")];
 	struct proxy *fe = s->fe;
 	struct proxy *be = s->be;
 	struct proxy *prx_log;
-	int tolog, level, err;
+	int tolog, level, err, size;
 	char *svid;
-	struct tm tm;
+	char *start, *end, *p;
 
 	/* if we don't want to log normal traffic, return now */
 	err = (s->flags & (SN_ERR_MASK | SN_REDISP)) || (s->conn_retries != be->conn_retries);
 	if (!err && (fe->options2 & PR_O2_NOLOGNORM))
 		return;
 
-	if (s->cli_addr.ss_family == AF_INET)
-		inet_ntop(AF_INET,
-			  (const void *)&((struct sockaddr_in *)&s->cli_addr)->sin_addr,
-			  pn, sizeof(pn));
-	else
-		inet_ntop(AF_INET6,
-			  (const void *)&((struct sockaddr_in6 *)(&s->cli_addr))->sin6_addr,
-			  pn, sizeof(pn));
-
-	get_localtime(s->logs.tv_accept.tv_sec, &tm);
+	if (fe->logfac1 < 0 && fe->logfac2 < 0 && !global.binlog_type)
+		return;
 
-	if (fe->logfac1 < 0 && fe->logfac2 < 0)
+	if (!err && skip_normal_log(s, fe))
 		return;
 
 	prx_log = fe;
 	tolog = fe->to_log;
 	svid = (tolog & LW_SVID) ? (s->srv != NULL) ? s->srv->id : "<NOSRV>" : "-";
 
+	if (global.binlog_type) {
+		send_binlog(s, BINLOG_TCP, svid, -1);
+		if (fe->logfac1 < 0 && fe->logfac2 < 0)
+			goto out;
+	}
+
 	level = LOG_INFO;
 	if (err && (fe->options2 & PR_O2_LOGERRORS))
 		level = LOG_ERR;
 
-	send_log(prx_log, level, "%s:%d [%02d/%s/%04d:%02d:%02d:%02d.%03d]"
-		 " %s %s/%s %ld/%ld/%s%ld %s%lld"
-		 " %c%c %d/%d/%d/%d/%s%u %ld/%ld\n",
-		 pn,
-		 (s->cli_addr.ss_family == AF_INET) ?
-		 ntohs(((struct sockaddr_in *)&s->cli_addr)->sin_port) :
-		 ntohs(((struct sockaddr_in6 *)&s->cli_addr)->sin6_port),
-		 tm.tm_mday, monthname[tm.tm_mon], tm.tm_year+1900,
-		 tm.tm_hour, tm.tm_min, tm.tm_sec, (int)s->logs.tv_accept.tv_usec/1000,
-		 fe->id, be->id, svid,
-		 (s->logs.t_queue >= 0) ? s->logs.t_queue : -1,
-		 (s->logs.t_connect >= 0) ? s->logs.t_connect - s->logs.t_queue : -1,
-		 (tolog & LW_BYTES) ? "" : "+", s->logs.t_close,
-		 (tolog & LW_BYTES) ? "" : "+", s->logs.bytes_out,
-		 sess_term_cond[(s->flags & SN_ERR_MASK) >> SN_ERR_SHIFT],
-		 sess_fin_state[(s->flags & SN_FINST_MASK) >> SN_FINST_SHIFT],
-		 actconn, fe->feconn, be->beconn, s->srv ? s->srv->cur_sess : 0,
-		 (s->flags & SN_REDISP)?"+":"",
-		 (s->conn_retries>0)?(be->conn_retries - s->conn_retries):be->conn_retries,
-		 s->logs.srv_queue_size, s->logs.prx_queue_size);
+	/* The fields are written directly into the syslog message. If one of
+	 * them does not fit, the line is truncated after the previous one.
+	 */
+	start = get_log_buffer(&size);
+	end = start + size;
+	*start = '\0';
+
+	p = lf_addr(start, end, &s->cli_addr);
+	p = lf_text(p, end, " [");
+	p = lf_date(p, end, &s->logs.tv_accept);
+	p = lf_text(p, end, "] ");
+	p = lf_text(p, end, fe->id);
+	p = lf_char(p, end, ' ');
+	p = lf_text(p, end, be->id);
+	p = lf_char(p, end, '/');
+	p = lf_text(p, end, svid);
+	p = lf_char(p, end, ' ');
+	p = lf_long(p, end, (s->logs.t_queue >= 0) ? s->logs.t_queue : -1);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, (s->logs.t_connect >= 0) ? s->logs.t_connect - s->logs.t_queue : -1);
+	p = lf_text(p, end, (tolog & LW_BYTES) ? "/" : "/+");
+	p = lf_long(p, end, s->logs.t_close);
+	p = lf_text(p, end, (tolog & LW_BYTES) ? " " : " +");
+	p = lf_llong(p, end, s->logs.bytes_out);
+	p = lf_char(p, end, ' ');
+	p = lf_char(p, end, sess_term_cond[(s->flags & SN_ERR_MASK) >> SN_ERR_SHIFT]);
+	p = lf_char(p, end, sess_fin_state[(s->flags & SN_FINST_MASK) >> SN_FINST_SHIFT]);
+	p = lf_char(p, end, ' ');
+	p = lf_long(p, end, actconn);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, fe->feconn);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, be->beconn);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, s->srv ? s->srv->cur_sess : 0);
+	p = lf_text(p, end, (s->flags & SN_REDISP) ? "/+" : "/");
+	p = lf_ulong(p, end, (unsigned int)((s->conn_retries>0)?(be->conn_retries - s->conn_retries):be->conn_retries));
+	p = lf_char(p, end, ' ');
+	p = lf_long(p, end, s->logs.srv_queue_size);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, s->logs.prx_queue_size);
 
+	/* the trailing zero leaves room for the line feed */
+	if (!p)
+		p = start + strlen(start);
+	send_log_buffer(prx_log, level, p - start + 1);
+ out:
 	s->logs.logwait = 0;
 }
 
@@ -0,0 +1,271 @@
+/*
+ * Key/value maps loaded from files.
+ *
+ * Copyright 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/config.h>
+#include <common/errors.h>
+#include <common/eb32tree.h>
+#include <common/mini-clist.h>
+#include <common/standard.h>
+
+#include <types/map.h>
+
+#include <proto/log.h>
+#include <proto/map.h>
+
+/* Returns non-zero if the <len> bytes at <key> match the key of <entry>. */
+static inline int map_key_match(const struct map *map, const struct map_entry *entry,
+				const char *key, int len)
+{
+	if (entry->len != len)
+		return 0;
+	if (map->flags & MAP_F_ICASE)
+		return strncasecmp(entry->key, key, len) == 0;
+	return memcmp(entry->key, key, len) == 0;
+}
+
+/* Returns the entry of <map> whose key is exactly the <len> bytes at <key>,
+ * or NULL.
+ */
+static struct map_entry *map_lookup_str(struct map *map, const char *key, int len)
+{
+	struct eb32_node *node;
+	struct map_entry *entry;
+	unsigned int hash;
+
+	hash = hash_nocase(key, len);
+	for (node = eb32_lookup(&map->by_hash, hash);
+	     node && node->key == hash;
+	     node = eb32_next(node)) {
+		entry = eb32_entry(node, struct map_entry, node);
+		if (map_key_match(map, entry, key, len))
+			return entry;
+	}
+	return NULL;
+}
+
+/* Returns the entry of <map> whose key is a prefix of the <len> bytes at
+ * <key>, or NULL. When several entries match, the first declared one wins,
+ * just as it would with a list of rules evaluated in turn. The trie folds
+ * case, so entries are checked again when case matters.
+ */
+static struct map_entry *map_lookup_beg(struct map *map, const char *key, int len)
+{
+	struct ac_node *node = map->trie.root;
+	struct map_entry *entry, *best = NULL;
+	int i = 0;
+
+	while (node) {
+		list_for_each_entry(entry, &node->entries, trie) {
+			if (best && best->line < entry->line)
+				continue;
+			if (!(map->flags & MAP_F_ICASE) && memcmp(entry->key, key, entry->len) != 0)
+				continue;
+			best = entry;
+		}
+		if (i >= len)
+			break;
+		node = ac_child(node, key[i++]);
+	}
+	return best;
+}
+
+/* Returns the entry of <map> matching the <len> bytes at <key> according to
+ * the map's lookup method, or NULL.
+ */
+struct map_entry *map_lookup(struct map *map, const char *key, int len)
+{
+	if (map->match == MAP_MATCH_BEG)
+		return map_lookup_beg(map, key, len);
+	return map_lookup_str(map, key, len);
+}
+
+/* Releases map <map> and all of its entries. */
+void map_free(struct map *map)
+{
+	struct map_entry *entry, *back;
+
+	if (!map)
+		return;
+
+	list_for_each_entry_safe(entry, back, &map->entries, list) {
+		LIST_DEL(&entry->list);
+		free(entry->key);
+		free(entry->value);
+		free(entry);
+	}
+	ac_free(&map->trie, NULL);
+	free(map->file);
+	free(map);
+}
+
+/* Loads the map from file <file>, using lookup method <match> and flags
+ * <flags>. Each non-empty line not starting with '#' must contain a key and
+ * a value separated by spaces. ERR_WARN is added to <err_code> when a warning
+ * is emitted. Returns the map, or NULL after emitting an alert in case of
+ * error.
+ */
+struct map *map_load(const char *file, int match, int flags, int *err_code)
+{
+	struct map *map;
+	struct map_entry *entry, *prev;
+	char line[LINESIZE];
+	char *key, *key_end, *value, *end;
+	int linenum = 0;
+	FILE *f;
+
+	f = fopen(file, "r");
+	if (!f) {
+		Alert("failed to open map file <%s> : %s.\n", file, strerror(errno));
+		return NULL;
+	}
+
+	map = calloc(1, sizeof(*map));
+	if (!map)
+		goto out_nomem;
+
+	map->file = strdup(file);
+	map->match = match;
+	map->flags = flags;
+	map->by_hash = EB_ROOT;
+	ac_init(&map->trie);
+	LIST_INIT(&map->entries);
+
+	while (fgets(line, sizeof(line), f) != NULL) {
+		linenum++;
+
+		key = line;
+		while (isspace((unsigned char)*key))
+			key++;
+
+		if (!*key || *key == '#')
+			continue;
+
+		key_end = key;
+		while (*key_end && !isspace((unsigned char)*key_end))
+			key_end++;
+
+		value = key_end;
+		while (isspace((unsigned char)*value))
+			value++;
+
+		end = value + strlen(value);
+		while (end > value && isspace((unsigned char)end[-1]))
+			end--;
+
+		if (end == value) {
+			Alert("parsing [%s:%d] : missing value for key '%.*s'.\n",
+			      file, linenum, (int)(key_end - key), key);
+			goto out_free;
+		}
+
+		*key_end = '\0';
+		*end = '\0';
+
+		prev = map_lookup_str(map, key, key_end - key);
+		if (prev) {
+			Warning("parsing [%s:%d] : key '%s' already declared at line %d, ignoring.\n",
+				file, linenum, key, prev->line);
+			*err_code |= ERR_WARN;
+			continue;
+		}
+
+		entry = calloc(1, sizeof(*entry));
+		if (!entry)
+			goto out_nomem;
+
+		entry->key = strdup(key);
+		entry->len = key_end - key;
+		entry->value = strdup(value);
+		entry->line = linenum;
+		LIST_INIT(&entry->trie);
+		LIST_ADDQ(&map->entries, &entry->list);
+		if (!entry->key || !entry->value)
+			goto out_nomem;
+
+		entry->node.key = hash_nocase(entry->key, entry->len);
+		eb32_insert(&map->by_hash, &entry->node);
+
+		if (match == MAP_MATCH_BEG) {
+			struct ac_node *node;
+
+			node = ac_insert(&map->trie, entry->key, entry->len, 0);
+			if (!node)
+				goto out_nomem;
+			LIST_ADDQ(&node->entries, &entry->trie);
+		}
+		map->count++;
+	}
+
+	fclose(f);
+	return map;
+
+ out_nomem:
+	Alert("out of memory while loading map file <%s>.\n", file);
+ out_free:
+	map_free(map);
+	fclose(f);
+	return NULL;
+}
+
+/* Parses a map key designation such as "map(hdr(host))" or "map_beg(path)"
+ * from <str> into <key>, and sets <match> to the lookup method it implies.
+ * Returns 1 if OK, 0 if <str> does not designate a map, or -1 if it is
+ * invalid.
+ */
+int map_parse_key(const char *str, struct map_key *key, int *match)
+{
+	const char *arg, *end;
+
+	if (strncmp(str, "map(", 4) == 0) {
+		*match = MAP_MATCH_STR;
+		arg = str + 4;
+	}
+	else if (strncmp(str, "map_beg(", 8) == 0) {
+		*match = MAP_MATCH_BEG;
+		arg = str + 8;
+	}
+	else
+		return 0;
+
+	end = arg + strlen(arg);
+	if (end == arg || end[-1] != ')')
+		return -1;
+	end--;
+
+	memset(key, 0, sizeof(*key));
+	if (end - arg == 4 && strncmp(arg, "path", 4) == 0) {
+		key->type = MAP_KEY_PATH;
+		return 1;
+	}
+
+	if (end - arg > 5 && strncmp(arg, "hdr(", 4) == 0 && end[-1] == ')') {
+		key->type = MAP_KEY_HDR;
+		key->name_len = end - arg - 5;
+		key->name = my_strndup(arg + 4, key->name_len);
+		return key->name ? 1 : -1;
+	}
+
+	return -1;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
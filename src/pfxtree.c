@@ -0,0 +1,193 @@
+/*
+ * Binary prefix trees for longest-prefix matching.
+ *
+ * Copyright 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version
+ * 2 of the License, or (at your option) any later version.
+ *
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <common/config.h>
+#include <common/pfxtree.h>
+
+/* returns bit <pos> of <key>, counting from the most significant bit */
+static inline int pfx_bit(const unsigned char *key, unsigned int pos)
+{
+	return (key[pos >> 3] >> (7 - (pos & 7))) & 1;
+}
+
+/* Returns the number of leading bits common to <k1> and <k2>, without
+ * exceeding <max>.
+ */
+static unsigned int pfx_common_bits(const unsigned char *k1, const unsigned char *k2, unsigned int max)
+{
+	unsigned int bits = 0;
+	unsigned char diff;
+
+	while (bits < max) {
+		diff = k1[bits >> 3] ^ k2[bits >> 3];
+		if (diff) {
+			while (!(diff & 0x80)) {
+				diff <<= 1;
+				bits++;
+			}
+			break;
+		}
+		bits += 8;
+	}
+	return bits < max ? bits : max;
+}
+
+/* Returns non-zero if the first <plen> bits of <k1> and <k2> are equal. */
+static inline int pfx_match(const unsigned char *k1, const unsigned char *k2, unsigned int plen)
+{
+	unsigned int bytes = plen >> 3;
+
+	if (memcmp(k1, k2, bytes) != 0)
+		return 0;
+	if (!(plen & 7))
+		return 1;
+	return !((k1[bytes] ^ k2[bytes]) & (0xFF << (8 - (plen & 7))));
+}
+
+/* Allocates a node for the first <plen> bits of <key>. The remaining bits of
+ * the node's key are cleared. Returns NULL if memory is lacking.
+ */
+static struct pfx_node *pfx_new_node(const struct pfx_root *root, const unsigned char *key, unsigned int plen)
+{
+	struct pfx_node *node;
+	unsigned int bytes = (plen + 7) >> 3;
+
+	node = calloc(1, sizeof(*node) + root->key_len);
+	if (!node)
+		return NULL;
+
+	node->plen = plen;
+	memcpy(node->key, key, bytes);
+	if (plen & 7)
+		node->key[bytes - 1] &= 0xFF << (8 - (plen & 7));
+	return node;
+}
+
+/* Inserts the first <plen> bits of <key> into <root> and returns the
+ * corresponding node, which may already have existed. <data> is attached to
+ * the node if it was not already set. Returns NULL if memory is lacking.
+ */
+struct pfx_node *pfx_insert(struct pfx_root *root, const void *key, unsigned int plen, void *data)
+{
+	const unsigned char *k = key;
+	struct pfx_node **link, *node, *leaf, *glue;
+	unsigned int common;
+
+	if (plen > root->key_len * 8)
+		plen = root->key_len * 8;
+
+	link = &root->node;
+	while ((node = *link) != NULL) {
+		common = pfx_common_bits(k, node->key, plen < node->plen ? plen : node->plen);
+
+		if (common == node->plen) {
+			/* <node> covers the new prefix */
+			if (plen == node->plen) {
+				if (!node->set) {
+					node->set = 1;
+					node->data = data;
+					root->count++;
+				}
+				return node;
+			}
+			link = &node->child[pfx_bit(k, node->plen)];
+			continue;
+		}
+
+		/* the new prefix diverges from <node> before its end */
+		leaf = pfx_new_node(root, k, plen);
+		if (!leaf)
+			return NULL;
+		leaf->set = 1;
+		leaf->data = data;
+
+		if (common == plen) {
+			/* the new prefix is a parent of <node> */
+			leaf->child[pfx_bit(node->key, plen)] = node;
+			*link = leaf;
+		}
+		else {
+			/* both diverge, we need a joining node */
+			glue = pfx_new_node(root, k, common);
+			if (!glue) {
+				free(leaf);
+				return NULL;
+			}
+			glue->child[pfx_bit(node->key, common)] = node;
+			glue->child[pfx_bit(k, common)] = leaf;
+			*link = glue;
+		}
+		root->count++;
+		return leaf;
+	}
+
+	leaf = pfx_new_node(root, k, plen);
+	if (!leaf)
+		return NULL;
+	leaf->set = 1;
+	leaf->data = data;
+	*link = leaf;
+	root->count++;
+	return leaf;
+}
+
+/* Returns the node holding the longest prefix of <root> which matches <key>,
+ * or NULL if no prefix matches. <key> must be <root>->key_len bytes long.
+ */
+struct pfx_node *pfx_lookup_longest(const struct pfx_root *root, const void *key)
+{
+	const unsigned char *k = key;
+	const struct pfx_node *node = root->node;
+	const struct pfx_node *best = NULL;
+	unsigned int bits = root->key_len * 8;
+
+	while (node && pfx_match(k, node->key, node->plen)) {
+		if (node->set)
+			best = node;
+		if (node->plen >= bits)
+			break;
+		node = node->child[pfx_bit(k, node->plen)];
+	}
+	return (struct pfx_node *)best;
+}
+
+/* recursively frees <node> and all of its children */
+static void pfx_free_node(struct pfx_node *node, void (*free_data)(void *))
+{
+	if (!node)
+		return;
+	pfx_free_node(node->child[0], free_data);
+	pfx_free_node(node->child[1], free_data);
+	if (node->set && free_data)
+		free_data(node->data);
+	free(node);
+}
+
+/* Releases all nodes of <root>, calling <free_data> on each attached data if
+ * it is not NULL. The tree is empty upon return.
+ */
+void pfx_free(struct pfx_root *root, void (*free_data)(void *))
+{
+	pfx_free_node(root->node, free_data);
+	root->node = NULL;
+	root->count = 0;
+}
+
+/*
+ * Local variables:
+ *  c-indent-level: 8
+ *  c-basic-offset: 8
+ * End:
+ */
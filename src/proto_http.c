@@ -41,11 +41,15 @@
 #include <proto/acl.h>
 #include <proto/backend.h>
 #include <proto/buffers.h>
+#include <proto/compression.h>
+#include <proto/cache.h>
 #include <proto/client.h>
 #include <proto/dumpstats.h>
 #include <proto/fd.h>
 #include <proto/log.h>
 #include <proto/hdr_idx.h>
+#include <proto/map.h>
+#include <proto/pipe.h>
 #include <proto/proto_tcp.h>
 #include <proto/proto_http.h>
 #include <proto/proxy.h>
@@ -637,6 +641,454 @@ http_get_path(struct http_txn *txn)
 	return ptr;
 }
 
+/* Looks up in <map> the part of the request of <txn> designated by <key>.
+ * For the "host" header, the port is not part of the key. Returns the
+ * matching entry, or NULL if none matches or the key is not present.
+ */
+static struct map_entry *
+http_lookup_map(struct http_txn *txn, struct map *map, const struct map_key *key)
+{
+	struct hdr_ctx ctx;
+	const char *ptr, *end;
+
+	switch (key->type) {
+	case MAP_KEY_HDR:
+		ctx.idx = 0;
+		if (!http_find_header2(key->name, key->name_len, txn->req.sol, &txn->hdr_idx, &ctx))
+			return NULL;
+		ptr = ctx.line + ctx.val;
+		end = ptr + ctx.vlen;
+		if (key->name_len == 4 && strncasecmp(key->name, "host", 4) == 0) {
+			const char *p = end;
+
+			while (p > ptr && isdigit((unsigned char)p[-1]))
+				p--;
+			if (p > ptr && p[-1] == ':')
+				end = p - 1;
+		}
+		break;
+	case MAP_KEY_PATH:
+		ptr = http_get_path(txn);
+		if (!ptr)
+			return NULL;
+		end = ptr;
+		while (end < txn->req.sol + txn->req.sl.rq.u + txn->req.sl.rq.u_l && *end != '?')
+			end++;
+		break;
+	default:
+		return NULL;
+	}
+	return map_lookup(map, ptr, end - ptr);
+}
+
+/* Builds into <key> the key under which the response to the request of <txn>
+ * may be cached : the value of the Host header, turned to lower case, followed
+ * by the URI. Returns its length, or -1 if it does not fit in <size> bytes.
+ */
+static int http_cache_key(struct http_txn *txn, char *key, int size)
+{
+	struct hdr_ctx ctx;
+	int len = 0;
+
+	ctx.idx = 0;
+	if (http_find_header2("Host", 4, txn->req.sol, &txn->hdr_idx, &ctx)) {
+		if (ctx.vlen > size)
+			return -1;
+		for (len = 0; len < ctx.vlen; len++)
+			key[len] = tolower((unsigned char)ctx.line[ctx.val + len]);
+	}
+
+	if (len + txn->req.sl.rq.u_l > size)
+		return -1;
+	memcpy(key + len, txn->req.sol + txn->req.sl.rq.u, txn->req.sl.rq.u_l);
+	return len + txn->req.sl.rq.u_l;
+}
+
+/* Returns non-zero if one of the values of header <name> of the message
+ * starting at <sol> in <txn> is the <vlen> bytes of <value>, ignoring case.
+ */
+static int http_hdr_has_value(struct http_txn *txn, const char *sol,
+			      const char *name, int len, const char *value, int vlen)
+{
+	struct hdr_ctx ctx;
+
+	ctx.idx = 0;
+	while (http_find_header2(name, len, sol, &txn->hdr_idx, &ctx))
+		if (ctx.vlen == vlen && strncasecmp(ctx.line + ctx.val, value, vlen) == 0)
+			return 1;
+	return 0;
+}
+
+/* Tries to answer the request of session <s> with a response from its
+ * backend's cache. Returns 1 if it was answered, otherwise 0. In the later
+ * case, a GET request gets an object prepared in txn->cache_obj so that its
+ * response may be stored. Unsafe methods invalidate the cached response to
+ * the same URI (RFC2616 #13.10).
+ */
+static int http_cache_request(struct session *s, struct buffer *req)
+{
+	struct http_txn *txn = &s->txn;
+	struct cache *cache = s->be->cache;
+	struct cache_obj *obj;
+	struct hdr_ctx ctx;
+	struct chunk rsp;
+	int len;
+
+	len = http_cache_key(txn, trash, sizeof(trash));
+	if (len < 0)
+		return 0;
+
+	if (txn->meth != HTTP_METH_GET && txn->meth != HTTP_METH_HEAD) {
+		if (txn->meth == HTTP_METH_POST || txn->meth == HTTP_METH_PUT ||
+		    txn->meth == HTTP_METH_DELETE)
+			cache_delete(cache, trash, len);
+		return 0;
+	}
+
+	/* responses to authenticated requests must not be shared */
+	ctx.idx = 0;
+	if (http_find_header2("Authorization", 13, txn->req.sol, &txn->hdr_idx, &ctx))
+		return 0;
+
+	/* the client may want a fresh response, which will then be stored */
+	if (!http_hdr_has_value(txn, txn->req.sol, "Cache-Control", 13, "no-cache", 8) &&
+	    !http_hdr_has_value(txn, txn->req.sol, "Cache-Control", 13, "max-age=0", 9) &&
+	    !http_hdr_has_value(txn, txn->req.sol, "Pragma", 6, "no-cache", 8)) {
+		obj = cache_lookup(cache, trash, len);
+		if (obj) {
+			rsp.str = obj->data;
+			rsp.len = (txn->meth == HTTP_METH_HEAD) ? obj->hdr_len : obj->len;
+			txn->status = obj->status;
+			s->logs.tv_request = now;
+			stream_int_retnclose(req->prod, &rsp);
+			return 1;
+		}
+	}
+
+	/* HEAD responses have no body, so they cannot be stored */
+	if (txn->meth == HTTP_METH_GET)
+		txn->cache_obj = cache_obj_new(trash, len);
+	return 0;
+}
+
+/* Decides whether the response of session <s>, whose headers have just been
+ * processed, may be stored into the backend's cache, and prepares the object
+ * in txn->cache_obj accordingly, or releases it. The response must be
+ * cacheable, have a known length, fit in the buffer, and neither set cookies
+ * nor vary with request headers. The "s-maxage" and "max-age" cache-control
+ * directives may shorten the configured lifetime, but not extend it.
+ */
+static void http_cache_prepare(struct session *s, struct buffer *rep)
+{
+	struct http_txn *txn = &s->txn;
+	struct http_msg *msg = &txn->rsp;
+	struct cache *cache = s->be->cache;
+	struct hdr_ctx ctx;
+	unsigned int ttl, age;
+	int hdr_len, s_maxage = 0;
+
+	hdr_len = rep->lr - (rep->data + msg->som);
+	if (!(txn->flags & TX_CACHEABLE) || txn->status == 206 ||
+	    (txn->flags & TX_RES_CHNK) || !(rep->analysers & AN_RTR_HTTP_BODY) ||
+	    hdr_len > cache->max_obj || msg->chunk_len > cache->max_obj - hdr_len)
+		goto not_stored;
+
+	ctx.idx = 0;
+	if (http_find_header2("Set-Cookie", 10, msg->sol, &txn->hdr_idx, &ctx))
+		goto not_stored;
+
+	ctx.idx = 0;
+	if (http_find_header2("Vary", 4, msg->sol, &txn->hdr_idx, &ctx))
+		goto not_stored;
+
+	ttl = cache->max_age;
+	ctx.idx = 0;
+	while (http_find_header2("Cache-Control", 13, msg->sol, &txn->hdr_idx, &ctx)) {
+		const char *val = ctx.line + ctx.val;
+
+		if (ctx.vlen >= 8 && strncasecmp(val, "no-cache", 8) == 0)
+			goto not_stored;
+
+		if (ctx.vlen > 9 && strncasecmp(val, "s-maxage=", 9) == 0) {
+			age = strl2ui(val + 9, ctx.vlen - 9);
+			s_maxage = 1;
+		}
+		else if (!s_maxage && ctx.vlen > 8 && strncasecmp(val, "max-age=", 8) == 0)
+			age = strl2ui(val + 8, ctx.vlen - 8);
+		else
+			continue;
+
+		ttl = (age < cache->max_age / 1000) ? age * 1000 : cache->max_age;
+	}
+
+	txn->cache_obj = cache_obj_resize(txn->cache_obj, hdr_len + msg->chunk_len);
+	if (!txn->cache_obj)
+		return;
+
+	txn->cache_obj->hdr_len = hdr_len;
+	txn->cache_obj->status = txn->status;
+	txn->cache_obj->expire = tick_add(now_ms, ttl);
+	return;
+
+ not_stored:
+	free(txn->cache_obj);
+	txn->cache_obj = NULL;
+}
+
+/* Copies the response of session <s> into txn->cache_obj once it has been
+ * completely received, and stores it into the backend's cache. Returns 0 if
+ * the response is not complete yet, otherwise 1, including when it will never
+ * be and is not stored.
+ */
+static int http_cache_store(struct session *s, struct buffer *rep)
+{
+	struct http_txn *txn = &s->txn;
+	struct cache_obj *obj = txn->cache_obj;
+	const char *ptr = rep->data + txn->rsp.som;
+	int len;
+
+	if (rep->l - rep->send_max < obj->len) {
+		if (!(rep->flags & (BF_SHUTR|BF_READ_ERROR|BF_READ_TIMEOUT|BF_FULL)))
+			return 0;
+		free(obj);
+	}
+	else {
+		/* the body may wrap at the end of the buffer */
+		len = rep->data + BUFSIZE - ptr;
+		if (len > obj->len)
+			len = obj->len;
+		memcpy(obj->data, ptr, len);
+		memcpy(obj->data + len, rep->data, obj->len - len);
+		cache_insert(s->be->cache, obj);
+	}
+	txn->cache_obj = NULL;
+	return 1;
+}
+
+/* Returns the compression settings applying to session <s>, if any. Those of
+ * the backend take precedence over those of the frontend.
+ */
+static inline struct comp *http_comp_settings(struct session *s)
+{
+	return s->be->comp ? s->be->comp : s->fe->comp;
+}
+
+/* Notes in txn->flags which content-codings the client of session <s> accepts
+ * according to its Accept-Encoding header. Codings with a null quality value
+ * are refused. Only HTTP/1.1 clients are considered since the compressed body
+ * is sent chunked.
+ */
+static void http_comp_request(struct session *s, struct buffer *req)
+{
+	struct http_txn *txn = &s->txn;
+	struct http_msg *msg = &txn->req;
+	struct hdr_ctx ctx;
+	const char *val, *end, *p;
+	int algo, len;
+
+	if (msg->sl.rq.v_l != 8 || req->data[msg->som + msg->sl.rq.v + 7] != '1')
+		return;
+
+	ctx.idx = 0;
+	while (http_find_header2("Accept-Encoding", 15, msg->sol, &txn->hdr_idx, &ctx)) {
+		val = ctx.line + ctx.val;
+		end = val + ctx.vlen;
+
+		for (len = 0; val + len < end && val[len] != ';' && !HTTP_IS_LWS(val[len]); len++)
+			;
+
+		/* look for "q=0", "q=0.0", ... among the parameters */
+		for (p = val + len; p < end && *p != '='; p++)
+			;
+		if (p < end && (p[-1] == 'q' || p[-1] == 'Q')) {
+			for (p++; p < end && (*p == '0' || *p == '.'); p++)
+				;
+			if (p == end || HTTP_IS_LWS(*p))
+				continue;
+		}
+
+		if (len == 1 && *val == '*') {
+			txn->flags |= TX_ACCEPT_GZIP | TX_ACCEPT_DEFLATE;
+			continue;
+		}
+
+		algo = comp_find_algo(val, len);
+		if (algo != COMP_ALGO_NONE)
+			txn->flags |= 1 << (TX_ACCEPT_SHIFT + algo);
+	}
+}
+
+#ifdef USE_ZLIB
+/* Decides whether the response of session <s>, whose headers have just been
+ * processed, may be compressed, and if so, prepares the compression context
+ * in txn->comp_ctx and rewrites the headers : the Content-Length is replaced
+ * with a chunked Transfer-Encoding, and the Content-Encoding is set. Only
+ * successful HTTP/1.1 responses of a known non-null length, not encoded yet,
+ * and of one of the configured content types are compressed, within the
+ * global rate and memory limits. Returns -1 if the headers could not be
+ * rewritten, otherwise 0.
+ */
+static int http_comp_prepare(struct session *s, struct buffer *rep)
+{
+	struct http_txn *txn = &s->txn;
+	struct http_msg *msg = &txn->rsp;
+	struct comp *comp = http_comp_settings(s);
+	struct hdr_ctx ctx;
+	char *cur_ptr, *cur_end, *cur_next;
+	int cur_idx, old_idx, delta, algo, i;
+
+	if (txn->status != 200 || (txn->flags & TX_RES_CHNK) ||
+	    !(rep->analysers & AN_RTR_HTTP_BODY) || !msg->chunk_len ||
+	    msg->sl.st.v_l != 8 || rep->data[msg->som + 7] != '1')
+		return 0;
+
+	/* use the first configured algorithm the client accepts */
+	algo = COMP_ALGO_NONE;
+	for (i = 0; i < comp->nb_algos; i++) {
+		if (txn->flags & (1 << (TX_ACCEPT_SHIFT + comp->algos[i]))) {
+			algo = comp->algos[i];
+			break;
+		}
+	}
+	if (!comp->nb_algos)
+		algo = (txn->flags & TX_ACCEPT_GZIP) ? COMP_ALGO_GZIP : COMP_ALGO_DEFLATE;
+	if (algo == COMP_ALGO_NONE)
+		return 0;
+
+	ctx.idx = 0;
+	if (http_find_header2("Content-Encoding", 16, msg->sol, &txn->hdr_idx, &ctx))
+		return 0;
+
+	if (http_hdr_has_value(txn, msg->sol, "Cache-Control", 13, "no-transform", 12))
+		return 0;
+
+	ctx.idx = 0;
+	if (!http_find_header2("Content-Type", 12, msg->sol, &txn->hdr_idx, &ctx) ||
+	    !comp_type_match(comp, ctx.line + ctx.val, ctx.vlen))
+		return 0;
+
+	/* the new headers must fit, which is normally guaranteed by the
+	 * space reserved for rewriting.
+	 */
+	if (rep->r + 100 >= rep->data + BUFSIZE)
+		return 0;
+
+	txn->comp_ctx = comp_ctx_new(algo);
+	if (!txn->comp_ctx)
+		return 0;
+
+	/* remove the Content-Length header */
+	cur_next = rep->data + msg->som + hdr_idx_first_pos(&txn->hdr_idx);
+	old_idx = 0;
+
+	while ((cur_idx = txn->hdr_idx.v[old_idx].next)) {
+		struct hdr_idx_elem *cur_hdr = &txn->hdr_idx.v[cur_idx];
+
+		cur_ptr  = cur_next;
+		cur_end  = cur_ptr + cur_hdr->len;
+		cur_next = cur_end + cur_hdr->cr + 1;
+
+		if (http_header_match2(cur_ptr, cur_end, "Content-Length", 14)) {
+			delta = buffer_replace2(rep, cur_ptr, cur_next, NULL, 0);
+			msg->eoh += delta;
+			cur_next += delta;
+			txn->hdr_idx.v[old_idx].next = cur_hdr->next;
+			if (txn->hdr_idx.tail == cur_idx)
+				txn->hdr_idx.tail = old_idx;
+			txn->hdr_idx.used--;
+			cur_hdr->len = 0;
+			continue;
+		}
+		old_idx = cur_idx;
+	}
+
+	i = sprintf(trash, "Content-Encoding: %s", comp_algo_name(algo));
+	if (unlikely(http_header_add_tail2(rep, msg, &txn->hdr_idx, "Transfer-Encoding: chunked", 26) < 0) ||
+	    unlikely(http_header_add_tail2(rep, msg, &txn->hdr_idx, trash, i) < 0) ||
+	    unlikely(http_header_add_tail2(rep, msg, &txn->hdr_idx, "Vary: Accept-Encoding", 21) < 0))
+		return -1;
+
+	/* the compressed chunks are inserted before the raw data, which must
+	 * thus never fill the buffer, otherwise nothing could move anymore.
+	 */
+	buffer_set_rlim(rep, BUFSIZE - MAXREWRITE);
+	return 0;
+}
+#endif
+
+/* Builds a response redirecting with code <code> (301 to 303) to the <loc_len>
+ * bytes of <location>, and setting the <cookie_len> bytes of <cookie> if
+ * <cookie_len> is not zero. Anything passed to http_write_redirect() will be
+ * appended to the location. Returns the newly allocated message, or NULL if
+ * memory is lacking.
+ */
+struct redirect_msg *http_make_redirect(int code, const char *location, int loc_len,
+					const char *cookie, int cookie_len)
+{
+	struct redirect_msg *rdr;
+	const char *msg_fmt;
+	char *str;
+	int len;
+
+	switch (code) {
+	case 301: msg_fmt = HTTP_301; break;
+	case 303: msg_fmt = HTTP_303; break;
+	case 302:
+	default:  msg_fmt = HTTP_302; code = 302; break;
+	}
+
+	rdr = malloc(sizeof(*rdr));
+	if (!rdr)
+		return NULL;
+
+	len = strlen(msg_fmt);
+	str = malloc(len + loc_len + 14 + cookie_len + 4);
+	if (!str) {
+		free(rdr);
+		return NULL;
+	}
+
+	rdr->code = code;
+	rdr->head.str = str;
+	memcpy(str, msg_fmt, len);
+	memcpy(str + len, location, loc_len);
+	rdr->head.len = len + loc_len;
+
+	str += rdr->head.len;
+	rdr->tail.str = str;
+	len = 0;
+	if (cookie_len) {
+		memcpy(str, "\r\nSet-Cookie: ", 14);
+		memcpy(str + 14, cookie, cookie_len);
+		len = 14 + cookie_len;
+	}
+	memcpy(str + len, "\r\n\r\n", 4);
+	rdr->tail.len = len + 4;
+	return rdr;
+}
+
+/* Writes redirect <rdr> into buffer <buf>, with the <len> bytes of <path>
+ * appended to its location. The buffer is expected to have just been erased.
+ * Returns 0, or -1 if the response does not fit in the buffer.
+ */
+static int http_write_redirect(struct buffer *buf, const struct redirect_msg *rdr,
+			       const char *path, int len)
+{
+	if (rdr->head.len + len + rdr->tail.len > buffer_realign(buf))
+		return -1;
+
+	if (!len) {
+		/* <tail> follows <head> */
+		buffer_write(buf, rdr->head.str, rdr->head.len + rdr->tail.len);
+		return 0;
+	}
+
+	buffer_write(buf, rdr->head.str, rdr->head.len);
+	buffer_write(buf, path, len);
+	buffer_write(buf, rdr->tail.str, rdr->tail.len);
+	return 0;
+}
+
 /* Returns a 302 for a redirectable request. This may only be called just after
  * the stream interface has moved to SI_ST_ASS. Unprocessable requests are
  * left unchanged and will follow normal proxy processing.
@@ -644,37 +1096,19 @@ http_get_path(struct http_txn *txn)
 void perform_http_redirect(struct session *s, struct stream_interface *si)
 {
 	struct http_txn *txn;
-	struct chunk rdr;
 	char *path;
 	int len;
 
-	/* 1: create the response header */
-	rdr.len = strlen(HTTP_302);
-	rdr.str = trash;
-	memcpy(rdr.str, HTTP_302, rdr.len);
-
-	/* 2: add the server's prefix */
-	if (rdr.len + s->srv->rdr_len > sizeof(trash))
-		return;
-
-	memcpy(rdr.str + rdr.len, s->srv->rdr_pfx, s->srv->rdr_len);
-	rdr.len += s->srv->rdr_len;
-
-	/* 3: add the request URI */
+	/* the response only lacks the request URI */
 	txn = &s->txn;
 	path = http_get_path(txn);
 	if (!path)
 		return;
 
 	len = txn->req.sl.rq.u_l + (txn->req.sol+txn->req.sl.rq.u) - path;
-	if (rdr.len + len > sizeof(trash) - 4) /* 4 for CRLF-CRLF */
+	if (s->srv->rdr_msg->head.len + len + s->srv->rdr_msg->tail.len > BUFSIZE)
 		return;
 
-	memcpy(rdr.str + rdr.len, path, len);
-	rdr.len += len;
-	memcpy(rdr.str + rdr.len, "\r\n\r\n", 4);
-	rdr.len += 4;
-
 	/* prepare to return without error. */
 	si->shutr(si);
 	si->shutw(si);
@@ -683,7 +1117,9 @@ void perform_http_redirect(struct session *s, struct stream_interface *si)
 	si->state    = SI_ST_CLO;
 
 	/* send the message */
-	http_server_error(s, si, SN_ERR_PRXCOND, SN_FINST_C, 302, &rdr);
+	http_server_error(s, si, SN_ERR_PRXCOND, SN_FINST_C, 302, NULL);
+	txn->status = 302;
+	http_write_redirect(si->ib, s->srv->rdr_msg, path, len);
 
 	/* FIXME: we should increase a counter of redirects per server and per backend. */
 	if (s->srv)
@@ -735,6 +1171,8 @@ const char sess_set_cookie[8] = "N1I3PD5R";	/* No set-cookie, unknown, Set-Cooki
 						   unknown, Set-cookie Rewritten */
 struct pool_head *pool2_requri;
 struct pool_head *pool2_capture;
+struct pool_head *pool2_body_spill = NULL;
+unsigned int body_spill_size = 0;   /* spill area size, 0 if never needed */
 
 /*
  * send a log for the session when we have enough info about it.
@@ -742,16 +1180,13 @@ struct pool_head *pool2_capture;
  */
 void http_sess_log(struct session *s)
 {
-	char pn[INET6_ADDRSTRLEN + strlen(":65535")];
 	struct proxy *fe = s->fe;
 	struct proxy *be = s->be;
 	struct proxy *prx_log;
 	struct http_txn *txn = &s->txn;
-	int tolog, level, err;
-	char *uri, *h;
-	char *svid;
-	struct tm tm;
-	static char tmpline[MAX_SYSLOG_LEN];
+	int tolog, level, err, size;
+	char *uri, *svid;
+	char *start, *end, *p;
 	int t_request;
 	int hdr;
 
@@ -762,106 +1197,138 @@ void http_sess_log(struct session *s)
 	if (!err && (fe->options2 & PR_O2_NOLOGNORM))
 		return;
 
-	if (fe->logfac1 < 0 && fe->logfac2 < 0)
+	if (fe->logfac1 < 0 && fe->logfac2 < 0 && !global.binlog_type)
 		return;
-	prx_log = fe;
-
-	if (s->cli_addr.ss_family == AF_INET)
-		inet_ntop(AF_INET,
-			  (const void *)&((struct sockaddr_in *)&s->cli_addr)->sin_addr,
-			  pn, sizeof(pn));
-	else
-		inet_ntop(AF_INET6,
-			  (const void *)&((struct sockaddr_in6 *)(&s->cli_addr))->sin6_addr,
-			  pn, sizeof(pn));
 
-	get_localtime(s->logs.accept_date.tv_sec, &tm);
+	if (!err && skip_normal_log(s, fe))
+		return;
+	prx_log = fe;
 
 	/* FIXME: let's limit ourselves to frontend logging for now. */
 	tolog = fe->to_log;
 
-	h = tmpline;
-	if (fe->to_log & LW_REQHDR &&
+	svid = (tolog & LW_SVID) ?
+		(s->data_source != DATA_SRC_STATS) ?
+		(s->srv != NULL) ? s->srv->id : "<NOSRV>" : "<STATS>" : "-";
+
+	t_request = -1;
+	if (tv_isge(&s->logs.tv_request, &s->logs.tv_accept))
+		t_request = tv_ms_elapsed(&s->logs.tv_accept, &s->logs.tv_request);
+
+	level = LOG_INFO;
+	if (err && (fe->options2 & PR_O2_LOGERRORS))
+		level = LOG_ERR;
+
+	if (global.binlog_type) {
+		send_binlog(s, BINLOG_HTTP, svid, t_request);
+		if (fe->logfac1 < 0 && fe->logfac2 < 0)
+			goto out;
+	}
+
+	/* The fields are written directly into the syslog message. If one of
+	 * them does not fit, the line is truncated after the previous one.
+	 */
+	start = get_log_buffer(&size);
+	end = start + size;
+	*start = '\0';
+
+	p = lf_addr(start, end, &s->cli_addr);
+	p = lf_text(p, end, " [");
+	p = lf_date(p, end, &s->logs.accept_date);
+	p = lf_text(p, end, "] ");
+	p = lf_text(p, end, fe->id);
+	p = lf_char(p, end, ' ');
+	p = lf_text(p, end, be->id);
+	p = lf_char(p, end, '/');
+	p = lf_text(p, end, svid);
+	p = lf_char(p, end, ' ');
+	p = lf_long(p, end, t_request);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, (s->logs.t_queue >= 0) ? s->logs.t_queue - t_request : -1);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, (s->logs.t_connect >= 0) ? s->logs.t_connect - s->logs.t_queue : -1);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, (s->logs.t_data >= 0) ? s->logs.t_data - s->logs.t_connect : -1);
+	p = lf_text(p, end, (tolog & LW_BYTES) ? "/" : "/+");
+	p = lf_long(p, end, s->logs.t_close);
+	p = lf_char(p, end, ' ');
+	p = lf_long(p, end, txn->status);
+	p = lf_text(p, end, (tolog & LW_BYTES) ? " " : " +");
+	p = lf_llong(p, end, s->logs.bytes_out);
+	p = lf_char(p, end, ' ');
+	p = lf_text(p, end, txn->cli_cookie ? txn->cli_cookie : "-");
+	p = lf_char(p, end, ' ');
+	p = lf_text(p, end, txn->srv_cookie ? txn->srv_cookie : "-");
+	p = lf_char(p, end, ' ');
+	p = lf_char(p, end, sess_term_cond[(s->flags & SN_ERR_MASK) >> SN_ERR_SHIFT]);
+	p = lf_char(p, end, sess_fin_state[(s->flags & SN_FINST_MASK) >> SN_FINST_SHIFT]);
+	p = lf_char(p, end, (be->options & PR_O_COOK_ANY) ? sess_cookie[(txn->flags & TX_CK_MASK) >> TX_CK_SHIFT] : '-');
+	p = lf_char(p, end, (be->options & PR_O_COOK_ANY) ? sess_set_cookie[(txn->flags & TX_SCK_MASK) >> TX_SCK_SHIFT] : '-');
+	p = lf_char(p, end, ' ');
+	p = lf_long(p, end, actconn);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, fe->feconn);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, be->beconn);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, s->srv ? s->srv->cur_sess : 0);
+	p = lf_text(p, end, (s->flags & SN_REDISP) ? "/+" : "/");
+	p = lf_ulong(p, end, (unsigned int)((s->conn_retries>0)?(be->conn_retries - s->conn_retries):be->conn_retries));
+	p = lf_char(p, end, ' ');
+	p = lf_long(p, end, s->logs.srv_queue_size);
+	p = lf_char(p, end, '/');
+	p = lf_long(p, end, s->logs.prx_queue_size);
+
+	/* captures and URI are encoded in place, and are truncated to the
+	 * available room like they used to be.
+	 */
+	if (p && fe->to_log & LW_REQHDR &&
 	    txn->req.cap &&
-	    (h < tmpline + sizeof(tmpline) - 10)) {
-		*(h++) = ' ';
-		*(h++) = '{';
+	    (p < end - 10)) {
+		*(p++) = ' ';
+		*(p++) = '{';
 		for (hdr = 0; hdr < fe->nb_req_cap; hdr++) {
-			if (hdr)
-				*(h++) = '|';
+			if (hdr && p < end - 7)
+				*(p++) = '|';
 			if (txn->req.cap[hdr] != NULL)
-				h = encode_string(h, tmpline + sizeof(tmpline) - 7,
+				p = encode_string(p, end - 7,
 						  '#', hdr_encode_map, txn->req.cap[hdr]);
 		}
-		*(h++) = '}';
+		*(p++) = '}';
+		*p = '\0';
 	}
 
-	if (fe->to_log & LW_RSPHDR &&
+	if (p && fe->to_log & LW_RSPHDR &&
 	    txn->rsp.cap &&
-	    (h < tmpline + sizeof(tmpline) - 7)) {
-		*(h++) = ' ';
-		*(h++) = '{';
+	    (p < end - 7)) {
+		*(p++) = ' ';
+		*(p++) = '{';
 		for (hdr = 0; hdr < fe->nb_rsp_cap; hdr++) {
-			if (hdr)
-				*(h++) = '|';
+			if (hdr && p < end - 4)
+				*(p++) = '|';
 			if (txn->rsp.cap[hdr] != NULL)
-				h = encode_string(h, tmpline + sizeof(tmpline) - 4,
+				p = encode_string(p, end - 4,
 						  '#', hdr_encode_map, txn->rsp.cap[hdr]);
 		}
-		*(h++) = '}';
+		*(p++) = '}';
+		*p = '\0';
 	}
 
-	if (h < tmpline + sizeof(tmpline) - 4) {
-		*(h++) = ' ';
-		*(h++) = '"';
+	if (p && p < end - 4) {
+		*(p++) = ' ';
+		*(p++) = '"';
 		uri = txn->uri ? txn->uri : "<BADREQ>";
-		h = encode_string(h, tmpline + sizeof(tmpline) - 1,
+		p = encode_string(p, end - 2,
 				  '#', url_encode_map, uri);
-		*(h++) = '"';
+		*(p++) = '"';
+		*p = '\0';
 	}
-	*h = '\0';
-
-	svid = (tolog & LW_SVID) ?
-		(s->data_source != DATA_SRC_STATS) ?
-		(s->srv != NULL) ? s->srv->id : "<NOSRV>" : "<STATS>" : "-";
-
-	t_request = -1;
-	if (tv_isge(&s->logs.tv_request, &s->logs.tv_accept))
-		t_request = tv_ms_elapsed(&s->logs.tv_accept, &s->logs.tv_request);
-
-	level = LOG_INFO;
-	if (err && (fe->options2 & PR_O2_LOGERRORS))
-		level = LOG_ERR;
-
-	send_log(prx_log, level,
-		 "%s:%d [%02d/%s/%04d:%02d:%02d:%02d.%03d]"
-		 " %s %s/%s %d/%ld/%ld/%ld/%s%ld %d %s%lld"
-		 " %s %s %c%c%c%c %d/%d/%d/%d/%s%u %ld/%ld%s\n",
-		 pn,
-		 (s->cli_addr.ss_family == AF_INET) ?
-		 ntohs(((struct sockaddr_in *)&s->cli_addr)->sin_port) :
-		 ntohs(((struct sockaddr_in6 *)&s->cli_addr)->sin6_port),
-		 tm.tm_mday, monthname[tm.tm_mon], tm.tm_year+1900,
-		 tm.tm_hour, tm.tm_min, tm.tm_sec, (int)s->logs.accept_date.tv_usec/1000,
-		 fe->id, be->id, svid,
-		 t_request,
-		 (s->logs.t_queue >= 0) ? s->logs.t_queue - t_request : -1,
-		 (s->logs.t_connect >= 0) ? s->logs.t_connect - s->logs.t_queue : -1,
-		 (s->logs.t_data >= 0) ? s->logs.t_data - s->logs.t_connect : -1,
-		 (tolog & LW_BYTES) ? "" : "+", s->logs.t_close,
-		 txn->status,
-		 (tolog & LW_BYTES) ? "" : "+", s->logs.bytes_out,
-		 txn->cli_cookie ? txn->cli_cookie : "-",
-		 txn->srv_cookie ? txn->srv_cookie : "-",
-		 sess_term_cond[(s->flags & SN_ERR_MASK) >> SN_ERR_SHIFT],
-		 sess_fin_state[(s->flags & SN_FINST_MASK) >> SN_FINST_SHIFT],
-		 (be->options & PR_O_COOK_ANY) ? sess_cookie[(txn->flags & TX_CK_MASK) >> TX_CK_SHIFT] : '-',
-		 (be->options & PR_O_COOK_ANY) ? sess_set_cookie[(txn->flags & TX_SCK_MASK) >> TX_SCK_SHIFT] : '-',
-		 actconn, fe->feconn, be->beconn, s->srv ? s->srv->cur_sess : 0,
-		 (s->flags & SN_REDISP)?"+":"",
-		 (s->conn_retries>0)?(be->conn_retries - s->conn_retries):be->conn_retries,
-		 s->logs.srv_queue_size, s->logs.prx_queue_size, tmpline);
 
+	/* the trailing zero leaves room for the line feed */
+	if (!p)
+		p = start + strlen(start);
+	send_log_buffer(prx_log, level, p - start + 1);
+ out:
 	s->logs.logwait = 0;
 }
 
@@ -1351,6 +1818,9 @@ void http_msg_analyzer(struct buffer *buf, struct http_msg *msg, struct hdr_idx
 	http_msg_hdr_first:
 	case HTTP_MSG_HDR_FIRST:
 		msg->sol = ptr;
+		if (unlikely(msg->flags & HTTP_MSGF_NO_HDR_IDX))
+			goto http_msg_hdr_skip;
+
 		if (likely(!HTTP_IS_CRLF(*ptr))) {
 			goto http_msg_hdr_name;
 		}
@@ -1359,6 +1829,32 @@ void http_msg_analyzer(struct buffer *buf, struct http_msg *msg, struct hdr_idx
 			EAT_AND_JUMP_OR_RETURN(http_msg_last_lf, HTTP_MSG_LAST_LF);
 		goto http_msg_last_lf;
 
+	http_msg_hdr_skip:
+	case HTTP_MSG_HDR_SKIP:
+		/* Nobody will look at the headers, so we only have to find
+		 * the empty line. Assumes msg->sol points to the beginning of
+		 * the current line.
+		 */
+		while (1) {
+			if (ptr == msg->sol && HTTP_IS_CRLF(*ptr)) {
+				if (likely(*ptr == '\r'))
+					EAT_AND_JUMP_OR_RETURN(http_msg_last_lf, HTTP_MSG_LAST_LF);
+				goto http_msg_last_lf;
+			}
+
+			ptr = memchr(ptr, '\n', end - ptr);
+			if (!ptr) {
+				ptr = end;
+				state = HTTP_MSG_HDR_SKIP;
+				goto http_msg_ood;
+			}
+			msg->sol = ++ptr;
+			if (ptr >= end) {
+				state = HTTP_MSG_HDR_SKIP;
+				goto http_msg_ood;
+			}
+		}
+
 	http_msg_hdr_name:
 	case HTTP_MSG_HDR_NAME:
 		/* assumes msg->sol points to the first char */
@@ -1499,6 +1995,150 @@ void http_msg_analyzer(struct buffer *buf, struct http_msg *msg, struct hdr_idx
 	return;
 }
 
+/* Prepares the analysis of the response to a pipelined request of session
+ * <s>, and decides whether this request may be followed by other ones on the
+ * same connection, in which case its body is followed so that the next
+ * request can be found. This requires pipelining to be enabled, an HTTP/1.1
+ * request not asking to close the connection, and a known body length. It
+ * returns 1 if so, 0 if not, or -1 if the request is invalid.
+ */
+static int http_pipeline_request(struct session *s, struct buffer *req)
+{
+	struct http_txn *txn = &s->txn;
+	struct http_msg *msg = &txn->req;
+	struct hdr_ctx ctx;
+	long long len;
+	int te = 0, chunked = 0;
+
+	/* the server's response to a pipelined request may now be analysed,
+	 * and it must not be forwarded as the previous one's remains.
+	 */
+	if (txn->flags & TX_PIPELINED) {
+		s->rep->to_forward = 0;
+		buffer_set_rlim(s->rep, BUFSIZE - MAXREWRITE);
+		s->rep->analysers |= AN_RTR_HTTP_HDR;
+	}
+
+	if (!((s->fe->options2 | s->be->options2) & PR_O2_PIPELINE) ||
+	    ((s->fe->options | s->be->options) & (PR_O_HTTP_CLOSE|PR_O_FORCE_CLO)) ||
+	    msg->sl.rq.v_l != 8 || req->data[msg->som + msg->sl.rq.v + 7] != '1' ||
+	    http_hdr_has_value(txn, msg->sol, "Connection", 10, "close", 5))
+		return 0;
+
+	ctx.idx = 0;
+	while (http_find_header2("Transfer-Encoding", 17, msg->sol, &txn->hdr_idx, &ctx)) {
+		te = 1;
+		chunked = ctx.vlen == 7 && strncasecmp(ctx.line + ctx.val, "chunked", 7) == 0;
+	}
+
+	if (te && !chunked)
+		return 0; /* the body ends with the connection */
+
+	if (!te) {
+		ctx.idx = 0;
+		if (http_find_header2("Content-Length", 14, msg->sol, &txn->hdr_idx, &ctx)) {
+			if (strl2llrc(ctx.line + ctx.val, ctx.vlen, &len) || len < 0)
+				return -1;
+			msg->chunk_len = len;
+		}
+	}
+
+	txn->flags |= TX_PIPELINE;
+	if (chunked)
+		txn->flags |= TX_REQ_CHNK;
+	req->analysers |= AN_REQ_HTTP_XFER_BODY;
+
+	/* the next request may already be read, and have to be rewritten */
+	buffer_set_rlim(req, BUFSIZE - MAXREWRITE);
+	return 1;
+}
+
+/* Moves the request body which follows the <body> bytes of headers in buffer
+ * <req> to the spill area of session <s>, which is allocated if needed, so
+ * that more of the body may be read. <limit> is the amount of body data being
+ * waited for. Returns 0 if there is no room for them.
+ */
+static int http_spill_body(struct session *s, struct buffer *req,
+			   unsigned long body, long long limit)
+{
+	struct body_spill *spill = s->txn.spill;
+	char *end = req->data + BUFSIZE;
+	char *ptr;
+	int len = req->l - body;
+	int part;
+
+	if (!spill) {
+		if (!pool2_body_spill)
+			return 0;
+		spill = pool_alloc2(pool2_body_spill);
+		if (!spill)
+			return 0;
+		spill->limit = limit;
+		spill->len = spill->sent = 0;
+		spill->to_forward = 0;
+		spill->replay = 0;
+		s->txn.spill = spill;
+	}
+
+	if (spill->len + len > body_spill_size)
+		return 0;
+
+	/* the body may wrap at the end of the buffer */
+	ptr = req->w + body;
+	if (ptr >= end)
+		ptr -= BUFSIZE;
+
+	part = end - ptr;
+	if (part > len)
+		part = len;
+	memcpy(spill->data + spill->len, ptr, part);
+	memcpy(spill->data + spill->len + part, req->data, len - part);
+	spill->len += len;
+
+	req->l = body;
+	req->r = req->lr = ptr;
+	buffer_set_rlim(req, req->max_len);
+	return 1;
+}
+
+/* Returns the amount of data following the <body> bytes of headers in request
+ * buffer <req> which the url_param lookup of "check_post" should wait for.
+ * Only the first chunk of a chunked body is considered, and the configured
+ * limit is returned as long as its size is not known yet.
+ */
+static long long http_body_wait_limit(struct session *s, struct buffer *req,
+				      unsigned long body)
+{
+	struct http_msg *msg = &s->txn.req;
+	long long limit = s->be->url_param_post_limit;
+	struct hdr_ctx ctx;
+
+	ctx.idx = 0;
+	http_find_header2("Transfer-Encoding", 17, msg->sol, &s->txn.hdr_idx, &ctx);
+	if (ctx.idx && ctx.vlen >= 7 && strncasecmp(ctx.line+ctx.val, "chunked", 7) == 0) {
+		unsigned int chunk;
+		int ret;
+
+		ret = http_parse_chunk_size(req, msg->sol + body, req->l - body, &chunk);
+		if (ret <= 0)
+			return limit; /* chunk size incomplete or invalid */
+
+		/* if we support more then one chunk here, we have to do it again when assigning server
+		 * 1. how much entity data do we have? new var
+		 * 2. should save entity_start, entity_cursor, elen & rlen in req; so we don't repeat scanning here
+		 * 3. test if elen > limit, or set new limit to elen if 0 (end of entity found)
+		 */
+
+		if (chunk < limit)
+			limit = chunk;                  /* only reading one chunk */
+		limit += ret;                           /* after the chunk size line */
+	} else {
+		if (msg->hdr_content_len < limit)
+			limit = msg->hdr_content_len;
+	}
+	return limit;
+}
+
 /* This function performs all the processing enabled for the current request.
  * It returns 1 if the processing can continue on next analysers, or zero if it
  * needs more data, encounters an error, or wants to immediately abort the
@@ -1539,10 +2179,11 @@ int http_process_request(struct session *s, struct buffer *req)
 	 *   req->r  = end of data
 	 */
 
-	int cur_idx;
+	int cur_idx, srv_flags;
 	struct http_txn *txn = &s->txn;
 	struct http_msg *msg = &txn->req;
 	struct proxy *cur_proxy;
+	struct server *srv;
 
 	DPRINTF(stderr,"[%u] %s: session=%p b=%p, exp(r,w)=%u,%u bf=%08x bl=%d analysers=%02x\n",
 		now_ms, __FUNCTION__,
@@ -1553,6 +2194,28 @@ int http_process_request(struct session *s, struct buffer *req)
 		req->l,
 		req->analysers);
 
+	/* A request following another one cannot be processed once the
+	 * server has closed, and there is nothing to report if the client
+	 * leaves or stays idle instead of sending it. Otherwise, it is timed
+	 * and logged from its first byte on.
+	 */
+	if (unlikely(txn->flags & TX_PIPELINED) &&
+	    ((s->rep->flags & BF_SHUTR) || req->cons->state != SI_ST_EST ||
+	     (!req->l && ((req->flags & (BF_READ_ERROR|BF_READ_TIMEOUT|BF_SHUTR)) ||
+			  tick_is_expired(req->analyse_exp, now_ms))))) {
+		stream_int_retnclose(req->prod, NULL);
+		req->analysers = 0;
+		s->logs.logwait = 0;
+		return 0;
+	}
+
+	if (unlikely(txn->flags & TX_PIPELINED) &&
+	    msg->msg_state == HTTP_MSG_RQBEFORE && req->l) {
+		s->logs.logwait = s->fe->to_log;
+		s->logs.accept_date = date;
+		s->logs.tv_accept = now;
+	}
+
 	if (likely(req->lr < req->r))
 		http_msg_analyzer(req, msg, &txn->hdr_idx);
 
@@ -1812,13 +2475,22 @@ int http_process_request(struct session *s, struct buffer *req)
 	 * The response path will be able to apply either ->be, or
 	 * ->be then ->fe filters in order to match the reverse of
 	 * the forward sequence.
+	 *
+	 * A pipelined request already knows its backend, so ->fe is
+	 * run first, then ->be.
 	 */
 
+	cur_proxy = NULL;
 	do {
 		struct acl_cond *cond;
 		struct redirect_rule *rule;
-		struct proxy *rule_set = s->be;
-		cur_proxy = s->be;
+		struct proxy *rule_set;
+
+		if (!cur_proxy && (txn->flags & TX_PIPELINED))
+			cur_proxy = s->fe;
+		else
+			cur_proxy = s->be;
+		rule_set = cur_proxy;
 
 		/* first check whether we have some ACLs set to block this request */
 		list_for_each_entry(cond, &cur_proxy->block_cond, list) {
@@ -1829,6 +2501,9 @@ int http_process_request(struct session *s, struct buffer *req)
 				ret = !ret;
 
 			if (ret) {
+				cond->hits++;
+				if (cur_proxy->options2 & PR_O2_REORDER)
+					promote_acl_cond(&cur_proxy->block_cond, cond);
 				txn->status = 403;
 				/* let's log the request time */
 				s->logs.tv_request = now;
@@ -1839,7 +2514,7 @@ int http_process_request(struct session *s, struct buffer *req)
 
 		/* try headers filters */
 		if (rule_set->req_exp != NULL) {
-			if (apply_filters_to_request(s, req, rule_set->req_exp) < 0)
+			if (apply_filters_to_request(s, req, rule_set) < 0)
 				goto return_bad_req;
 		}
 
@@ -1865,6 +2540,10 @@ int http_process_request(struct session *s, struct buffer *req)
 			goto return_prx_cond;
 		}
 
+		/* the response may already be in the backend's cache */
+		if (rule_set == s->be && s->be->cache && http_cache_request(s, req))
+			goto return_prx_cond;
+
 		/* We might have to check for "Connection:" */
 		if (((s->fe->options | s->be->options) & (PR_O_HTTP_CLOSE|PR_O_FORCE_CLO)) &&
 		    !(s->flags & SN_CONN_CLOSED)) {
@@ -1923,6 +2602,13 @@ int http_process_request(struct session *s, struct buffer *req)
 				goto return_bad_req;
 		}
 
+		/* the request may have been rewritten above, so ACL results
+		 * depending on its contents must not be reused.
+		 */
+		if (rule_set->req_exp != NULL || rule_set->nb_reqadd ||
+		    ((s->fe->options | s->be->options) & (PR_O_HTTP_CLOSE|PR_O_FORCE_CLO)))
+			acl_cache_flush(s, 1);
+
 		/* check if stats URI was requested, and if an auth is needed */
 		if (rule_set->uri_auth != NULL &&
 		    (txn->meth == HTTP_METH_GET || txn->meth == HTTP_METH_HEAD)) {
@@ -1938,44 +2624,42 @@ int http_process_request(struct session *s, struct buffer *req)
 
 		/* first check whether we have some ACLs set to redirect this request */
 		list_for_each_entry(rule, &cur_proxy->redirect_rules, list) {
-			int ret = acl_exec_cond(rule->cond, cur_proxy, s, txn, ACL_DIR_REQ);
+			int ret = 1;
 
-			ret = acl_pass(ret);
-			if (rule->cond->pol == ACL_COND_UNLESS)
-				ret = !ret;
+			if (rule->cond) {
+				ret = acl_exec_cond(rule->cond, cur_proxy, s, txn, ACL_DIR_REQ);
 
-			if (ret) {
-				struct chunk rdr = { trash, 0 };
-				const char *msg_fmt;
-
-				/* build redirect message */
-				switch(rule->code) {
-				case 303:
-					rdr.len = strlen(HTTP_303);
-					msg_fmt = HTTP_303;
-					break;
-				case 301:
-					rdr.len = strlen(HTTP_301);
-					msg_fmt = HTTP_301;
-					break;
-				case 302:
-				default:
-					rdr.len = strlen(HTTP_302);
-					msg_fmt = HTTP_302;
-					break;
-				}
+				ret = acl_pass(ret);
+				if (rule->cond->pol == ACL_COND_UNLESS)
+					ret = !ret;
+			}
+
+			if (ret && rule->type == REDIRECT_TYPE_MAP) {
+				struct map_entry *entry;
+				struct redirect_msg *rdr;
+
+				entry = http_lookup_map(txn, rule->map, &rule->key);
+				if (!entry)
+					continue;
 
-				if (unlikely(rdr.len > sizeof(trash)))
-					goto return_bad_req;
-				memcpy(rdr.str, msg_fmt, rdr.len);
+				/* the whole response was built at load time */
+				rdr = entry->ptr;
+				txn->status = rdr->code;
+				s->logs.tv_request = now;
+				stream_int_retnclose(req->prod, NULL);
+				http_write_redirect(req->prod->ob, rdr, NULL, 0);
+				goto return_prx_cond;
+			}
 
-				switch(rule->type) {
-				case REDIRECT_TYPE_PREFIX: {
-					const char *path;
-					int pathlen;
+			if (ret) {
+				const char *path = NULL;
+				int pathlen = 0;
 
+				/* the response was built at load time, a prefix
+				 * redirect only needs the request path.
+				 */
+				if (rule->type == REDIRECT_TYPE_PREFIX) {
 					path = http_get_path(txn);
-					/* build message using path */
 					if (path) {
 						pathlen = txn->req.sl.rq.u_l + (txn->req.sol+txn->req.sl.rq.u) - path;
 						if (rule->flags & REDIRECT_FLAG_DROP_QS) {
@@ -1992,52 +2676,16 @@ int http_process_request(struct session *s, struct buffer *req)
 						path = "/";
 						pathlen = 1;
 					}
-
-					if (rdr.len + rule->rdr_len + pathlen > sizeof(trash) - 4)
-						goto return_bad_req;
-
-					/* add prefix. Note that if prefix == "/", we don't want to
-					 * add anything, otherwise it makes it hard for the user to
-					 * configure a self-redirection.
-					 */
-					if (rule->rdr_len != 1 || *rule->rdr_str != '/') {
-						memcpy(rdr.str + rdr.len, rule->rdr_str, rule->rdr_len);
-						rdr.len += rule->rdr_len;
-					}
-
-					/* add path */
-					memcpy(rdr.str + rdr.len, path, pathlen);
-					rdr.len += pathlen;
-					break;
-				}
-				case REDIRECT_TYPE_LOCATION:
-				default:
-					if (rdr.len + rule->rdr_len > sizeof(trash) - 4)
-						goto return_bad_req;
-
-					/* add location */
-					memcpy(rdr.str + rdr.len, rule->rdr_str, rule->rdr_len);
-					rdr.len += rule->rdr_len;
-					break;
-				}
-
-				if (rule->cookie_len) {
-					memcpy(rdr.str + rdr.len, "\r\nSet-Cookie: ", 14);
-					rdr.len += 14;
-					memcpy(rdr.str + rdr.len, rule->cookie_str, rule->cookie_len);
-					rdr.len += rule->cookie_len;
-					memcpy(rdr.str + rdr.len, "\r\n", 2);
-					rdr.len += 2;
 				}
 
-				/* add end of headers */
-				memcpy(rdr.str + rdr.len, "\r\n\r\n", 4);
-				rdr.len += 4;
+				if (rule->msg->head.len + pathlen + rule->msg->tail.len > BUFSIZE)
+					goto return_bad_req;
 
-				txn->status = rule->code;
+				txn->status = rule->msg->code;
 				/* let's log the request time */
 				s->logs.tv_request = now;
-				stream_int_retnclose(req->prod, &rdr);
+				stream_int_retnclose(req->prod, NULL);
+				http_write_redirect(req->prod->ob, rule->msg, path, pathlen);
 				goto return_prx_cond;
 			}
 		}
@@ -2047,16 +2695,27 @@ int http_process_request(struct session *s, struct buffer *req)
 			struct switching_rule *rule;
 
 			list_for_each_entry(rule, &cur_proxy->switching_rules, list) {
-				int ret;
+				struct proxy *backend = rule->be.backend;
+				int ret = 1;
 
-				ret = acl_exec_cond(rule->cond, cur_proxy, s, txn, ACL_DIR_REQ);
+				if (rule->cond) {
+					ret = acl_exec_cond(rule->cond, cur_proxy, s, txn, ACL_DIR_REQ);
 
-				ret = acl_pass(ret);
-				if (rule->cond->pol == ACL_COND_UNLESS)
-					ret = !ret;
+					ret = acl_pass(ret);
+					if (rule->cond->pol == ACL_COND_UNLESS)
+						ret = !ret;
+				}
+
+				if (ret && rule->map) {
+					struct map_entry *entry;
+
+					entry = http_lookup_map(txn, rule->map, &rule->key);
+					backend = entry ? entry->ptr : NULL;
+					ret = backend != NULL;
+				}
 
 				if (ret) {
-					s->be = rule->be.backend;
+					s->be = backend;
 					s->be->beconn++;
 					if (s->be->beconn > s->be->beconn_max)
 						s->be->beconn_max = s->be->beconn;
@@ -2134,8 +2793,11 @@ int http_process_request(struct session *s, struct buffer *req)
 
 	/*
 	 * 7: the appsession cookie was looked up very early in 1.2,
-	 * so let's do the same now.
+	 * so let's do the same now. A pipelined request must however
+	 * stay on the server its connection is established to.
 	 */
+	srv = s->srv;
+	srv_flags = s->flags & (SN_DIRECT|SN_ASSIGNED|SN_ADDR_SET);
 
 	/* It needs to look into the URI */
 	if (s->be->appsession_name) {
@@ -2152,6 +2814,12 @@ int http_process_request(struct session *s, struct buffer *req)
 	    && !(txn->flags & (TX_CLDENY|TX_CLTARPIT)))
 		manage_client_side_cookies(s, req);
 
+	if (txn->flags & TX_PIPELINED) {
+		s->srv = srv;
+		s->flags &= ~(SN_DIRECT|SN_ASSIGNED|SN_ADDR_SET);
+		s->flags |= srv_flags;
+	}
+
 	/*
 	 * 9: add X-Forwarded-For if either the frontend or the backend
 	 * asks for it.
@@ -2278,14 +2946,21 @@ int http_process_request(struct session *s, struct buffer *req)
 			goto return_bad_req;
 		s->flags |= SN_CONN_CLOSED;
 	}
+	/*
+	 * 12: note which content-codings the client accepts in case the
+	 * response has to be compressed.
+	 */
+	if (http_comp_settings(s))
+		http_comp_request(s, req);
+
 	/* Before we switch to data, was assignment set in manage_client_side_cookie?
 	 * If not assigned, perhaps we are balancing on url_param, but this is a
 	 * POST; and the parameters are in the body, maybe scan there to find our server.
-	 * (unless headers overflowed the buffer?)
+	 * A full buffer is only a problem when there is no spill area to make room.
 	 */
 	if (!(s->flags & (SN_ASSIGNED|SN_DIRECT)) &&
 	    s->txn.meth == HTTP_METH_POST && s->be->url_param_name != NULL &&
-	    s->be->url_param_post_limit != 0 && !(req->flags & BF_FULL) &&
+	    s->be->url_param_post_limit != 0 && (!(req->flags & BF_FULL) || pool2_body_spill) &&
 	    memchr(msg->sol + msg->sl.rq.u, '?', msg->sl.rq.u_l) == NULL) {
 		/* are there enough bytes here? total == l || r || rlim ?
 		 * len is unsigned, but eoh is int,
@@ -2358,6 +3033,16 @@ int http_process_request(struct session *s, struct buffer *req)
 				/* else... There are no body bytes to wait for */
 			}
 		}
+
+		/* The body may have come with the headers and filled the buffer,
+		 * which is still limited for header rewriting. Make room for the
+		 * rest of it right now, as the buffer would never grow otherwise.
+		 */
+		if ((req->analysers & AN_REQ_HTTP_BODY) && (req->flags & BF_FULL)) {
+			unsigned long body = req->l - len;
+
+			http_spill_body(s, req, body, http_body_wait_limit(s, req, body));
+		}
 	}
  end_check_maybe_wait_for_body:
 
@@ -2385,6 +3070,8 @@ int http_process_request(struct session *s, struct buffer *req)
 		if (!req->analyse_exp)
 			req->analyse_exp = tick_add(now_ms, 0);
 	}
+	else if (http_pipeline_request(s, req) < 0)
+		goto return_bad_req;
 
 	/* OK let's go on with the BODY now */
 	return 1;
@@ -2451,18 +3138,95 @@ int http_process_tarpit(struct session *s, struct buffer *req)
 	return 0;
 }
 
+/* Gives the spilled request body of session <s> back to request buffer <req>
+ * as room is made there. The buffer's read limit is zero until everything has
+ * been given back, so that the client is not read from and the body is kept
+ * in order. The data are scheduled for forwarding unless the request body is
+ * followed by another analyser.
+ * Returns 1 once everything has been given back, otherwise 0.
+ *
+ * The data are forwarded as if they were read, but the buffer's to_forward is
+ * kept aside meanwhile, otherwise the session would not be woken up once the
+ * buffer is empty to give more data back.
+ */
+static int http_unspill_body(struct session *s, struct buffer *req)
+{
+	struct body_spill *spill = s->txn.spill;
+	int len, fwd;
+
+	spill->to_forward += req->to_forward;
+	req->to_forward = 0;
+
+	while (spill->sent < spill->len) {
+		len = buffer_realign(req);
+		if (len > BUFSIZE - req->l)
+			len = BUFSIZE - req->l;
+		if (len <= 0)
+			break;
+		if (len > spill->len - spill->sent)
+			len = spill->len - spill->sent;
+
+		memcpy(req->r, spill->data + spill->sent, len);
+		spill->sent += len;
+		req->l += len;
+		req->r += len;
+		if (req->r == req->data + BUFSIZE)
+			req->r = req->data;
+
+		fwd = MIN(spill->to_forward, len);
+		req->send_max += fwd;
+		spill->to_forward -= fwd;
+	}
+
+	req->flags &= ~(BF_EMPTY|BF_FULL);
+	if (req->l == 0)
+		req->flags |= BF_EMPTY;
+	if (req->l >= req->max_len)
+		req->flags |= BF_FULL;
+
+	if (!(req->analysers & AN_REQ_HTTP_XFER_BODY))
+		buffer_flush(req);
+
+	if (spill->sent < spill->len)
+		return 0;
+
+	/* the spill area is only kept until the server is chosen */
+	req->to_forward = spill->to_forward;
+	buffer_set_rlim(req, spill->max_len);
+	if (s->flags & SN_ASSIGNED) {
+		pool_free2(pool2_body_spill, spill);
+		s->txn.spill = NULL;
+	}
+	return 1;
+}
+
 /* This function is an analyser which processes the HTTP request body. It looks
  * for parameters to be used for the load balancing algorithm (url_param). It
  * must only be called after the standard HTTP request processing has occurred,
  * because it expects the request to be parsed. It returns zero if it needs to
  * read more data, or 1 once it has completed its analysis.
+ *
+ * When the buffer fills up before enough data are present, the body is moved
+ * to a spill area so that up to url_param_post_limit bytes may be inspected.
+ * Once the analysis is over, reading from the client is stopped so that the
+ * spilled data may be given back before anything else.
  */
 int http_process_request_body(struct session *s, struct buffer *req)
 {
 	struct http_msg *msg = &s->txn.req;
+	struct body_spill *spill = s->txn.spill;
 	unsigned long body = msg->sol[msg->eoh] == '\r' ? msg->eoh + 2 : msg->eoh + 1;
-	long long limit = s->be->url_param_post_limit;
-	struct hdr_ctx ctx;
+	long long limit;
+	long long avail;
+
+	if (spill && spill->replay) {
+		/* the analysis is over, we're giving the body back, which
+		 * the next analysers may already process.
+		 */
+		if (http_unspill_body(s, req))
+			req->analysers &= ~AN_REQ_HTTP_BODY;
+		return 1;
+	}
 
 	/* We have to parse the HTTP request body to find any required data.
 	 * "balance url_param check_post" should have been the only way to get
@@ -2470,56 +3234,44 @@ int http_process_request_body(struct session *s, struct buffer *req)
 	 * related structures are ready.
 	 */
 
-	ctx.idx = 0;
-
-	/* now if we have a length, we'll take the hint */
-	http_find_header2("Transfer-Encoding", 17, msg->sol, &s->txn.hdr_idx, &ctx);
-	if (ctx.idx && ctx.vlen >= 7 && strncasecmp(ctx.line+ctx.val, "chunked", 7) == 0) {
-		unsigned int chunk = 0;
-		while (body < req->l && !HTTP_IS_CRLF(msg->sol[body])) {
-			char c = msg->sol[body];
-			if (ishex(c)) {
-				unsigned int hex = toupper(c) - '0';
-				if (hex > 9)
-					hex -= 'A' - '9' - 1;
-				chunk = (chunk << 4) | hex;
-			} else
-				break;
-			body++;
-		}
-		if (body + 2 >= req->l) /* we want CRLF too */
-			goto http_body_end; /* end of buffer? data missing! */
-
-		if (memcmp(msg->sol+body, "\r\n", 2) != 0)
-			goto http_body_end; /* chunked encoding len ends with CRLF, and we don't have it yet */
-
-		body += 2; // skip CRLF
-
-		/* if we support more then one chunk here, we have to do it again when assigning server
-		 * 1. how much entity data do we have? new var
-		 * 2. should save entity_start, entity_cursor, elen & rlen in req; so we don't repeat scanning here
-		 * 3. test if elen > limit, or set new limit to elen if 0 (end of entity found)
-		 */
-
-		if (chunk < limit)
-			limit = chunk;                  /* only reading one chunk */
-	} else {
-		if (msg->hdr_content_len < limit)
-			limit = msg->hdr_content_len;
+	if (spill) {
+		/* the beginning of the body is not in the buffer anymore */
+		limit = spill->limit;
 	}
+	else
+		limit = http_body_wait_limit(s, req, body);
+
+	/* make room for more data if the buffer is full, provided that the
+	 * spill area will still be able to take a whole buffer at the end.
+	 */
+	avail = req->l - body + (spill ? spill->len : 0);
+	if ((req->flags & BF_FULL) && avail < limit && avail + BUFSIZE <= body_spill_size &&
+	    http_spill_body(s, req, body, limit))
+		spill = s->txn.spill;
 
- http_body_end:
 	/* we leave once we know we have nothing left to do. This means that we have
 	 * enough bytes, or that we know we'll not get any more (buffer full, read
 	 * buffer closed).
 	 */
-	if (req->l - body >= limit ||             /* enough bytes! */
+	if (avail >= limit ||                     /* enough bytes! */
 	    req->flags & (BF_FULL | BF_READ_ERROR | BF_SHUTR | BF_READ_TIMEOUT) ||
 	    tick_is_expired(req->analyse_exp, now_ms)) {
 		/* The situation will not evolve, so let's give up on the analysis. */
 		s->logs.tv_request = now;  /* update the request timer to reflect full request */
-		req->analysers &= ~AN_REQ_HTTP_BODY;
 		req->analyse_exp = TICK_ETERNITY;
+
+		if (spill) {
+			/* move the rest of the body after what was spilled,
+			 * and give everything back in order.
+			 */
+			http_spill_body(s, req, body, limit);
+			spill->replay = 1;
+			spill->max_len = req->max_len;
+			buffer_set_rlim(req, 0);
+			if (!http_unspill_body(s, req))
+				return 1;
+		}
+		req->analysers &= ~AN_REQ_HTTP_BODY;
 		return 1;
 	}
 	else {
@@ -2764,7 +3516,7 @@ int process_response(struct session *t)
 			 *    Cache-Control or Expires header fields."
 			 */
 			if (likely(txn->meth != HTTP_METH_POST) &&
-			    (t->be->options & (PR_O_CHK_CACHE|PR_O_COOK_NOC)))
+			    ((t->be->options & (PR_O_CHK_CACHE|PR_O_COOK_NOC)) || t->be->cache))
 				txn->flags |= TX_CACHEABLE | TX_CACHE_COOK;
 			break;
 		default:
@@ -2796,7 +3548,7 @@ int process_response(struct session *t)
 
 			/* try headers filters */
 			if (rule_set->rsp_exp != NULL) {
-				if (apply_filters_to_response(t, rep, rule_set->rsp_exp) < 0) {
+				if (apply_filters_to_response(t, rep, rule_set) < 0) {
 				return_bad_resp:
 					if (t->srv)
 						t->srv->failed_resp++;
@@ -2900,7 +3652,7 @@ int process_response(struct session *t)
 		/*
 		 * 5: check for cache-control or pragma headers if required.
 		 */
-		if ((t->be->options & (PR_O_COOK_NOC | PR_O_CHK_CACHE)) != 0 && txn->status >= 200)
+		if (((t->be->options & (PR_O_COOK_NOC | PR_O_CHK_CACHE)) || t->be->cache) && txn->status >= 200)
 			check_response_for_cacheability(t, rep);
 
 		/*
@@ -3008,6 +3760,73 @@ int process_response(struct session *t)
 		buffer_set_rlim(rep, BUFSIZE); /* no more rewrite needed */
 		t->logs.t_data = tv_ms_elapsed(&t->logs.tv_accept, &now);
 
+		/*
+		 * 10: find how the end of the body will be known (RFC2616 #4.4),
+		 * so that we can follow it instead of waiting for the close.
+		 */
+		if (txn->meth != HTTP_METH_HEAD && txn->status != 204 && txn->status != 304) {
+			struct hdr_ctx ctx;
+			long long len;
+
+			int te = 0, chunked = 0;
+
+			/* "chunked" must be the last transfer-coding, otherwise
+			 * the body ends with the connection.
+			 */
+			ctx.idx = 0;
+			while (http_find_header2("Transfer-Encoding", 17, msg->sol, &txn->hdr_idx, &ctx)) {
+				te = 1;
+				chunked = ctx.vlen == 7 && strncasecmp(ctx.line + ctx.val, "chunked", 7) == 0;
+			}
+
+			if (chunked) {
+				txn->flags |= TX_RES_CHNK;
+				rep->analysers |= AN_RTR_HTTP_BODY;
+			}
+			else if (!te) {
+				ctx.idx = 0;
+				if (http_find_header2("Content-Length", 14, msg->sol, &txn->hdr_idx, &ctx) &&
+				    !strl2llrc(ctx.line + ctx.val, ctx.vlen, &len) && len >= 0) {
+					msg->chunk_len = len;
+					rep->analysers |= AN_RTR_HTTP_BODY;
+				}
+			}
+		}
+
+		/*
+		 * 11: the response may be stored into the backend's cache once
+		 * it is complete.
+		 */
+		if (txn->cache_obj)
+			http_cache_prepare(t, rep);
+
+#ifdef USE_ZLIB
+		/*
+		 * 12: the response may be compressed if it is not being
+		 * stored into the cache.
+		 */
+		if ((txn->flags & (TX_ACCEPT_GZIP|TX_ACCEPT_DEFLATE)) && !txn->cache_obj &&
+		    http_comp_settings(t) && http_comp_prepare(t, rep) < 0)
+			goto return_bad_resp;
+#endif
+
+		/*
+		 * 13: with pipelining, the next request is only processed if
+		 * the server keeps the connection and the end of the response
+		 * is known. A response without a body is complete once its
+		 * headers have left.
+		 */
+		if (txn->flags & TX_PIPELINE) {
+			if (txn->status < 200 ||
+			    msg->sl.st.v_l != 8 || rep->data[msg->som + 7] != '1' ||
+			    http_hdr_has_value(txn, msg->sol, "Connection", 10, "close", 5))
+				txn->flags &= ~TX_PIPELINE;
+			else if (txn->meth == HTTP_METH_HEAD || txn->status == 204 || txn->status == 304)
+				rep->analysers |= AN_RTR_HTTP_BODY;
+			else if (!(rep->analysers & AN_RTR_HTTP_BODY))
+				txn->flags &= ~TX_PIPELINE;
+		}
+
 #ifdef CONFIG_HAP_TCPSPLICE
 		if ((t->fe->options & t->be->options) & PR_O_TCPSPLICE) {
 			/* TCP splicing supported by both FE and BE */
@@ -3026,24 +3845,473 @@ int process_response(struct session *t)
 		}
 
 		/* Note: we must not try to cheat by jumping directly to DATA,
-		 * otherwise we would not let the client side wake up.
+		 * otherwise we would not let the client side wake up. The body
+		 * analyser however has to run now to schedule the headers.
 		 */
 
-		return 0;
+		return (rep->analysers & AN_RTR_HTTP_BODY) != 0;
 	}
 
 	/* Note: eventhough nobody should set an unknown flag, clearing them right now will
 	 * probably reduce one day's debugging session.
 	 */
 #ifdef DEBUG_DEV
-	if (rep->analysers & ~(AN_RTR_HTTP_HDR)) {
+	if (rep->analysers & ~(AN_RTR_HTTP_HDR|AN_RTR_HTTP_BODY)) {
 		fprintf(stderr, "FIXME !!!! unknown analysers flags %s:%d = 0x%08X\n",
 			__FILE__, __LINE__, rep->analysers);
 		ABORT_NOW();
 	}
 #endif
-	rep->analysers &= AN_RTR_HTTP_HDR;
+	rep->analysers &= AN_RTR_HTTP_HDR|AN_RTR_HTTP_BODY;
+	return 0;
+}
+
+/* Parses the chunk size line starting at <ptr> in buffer <buf>, of which
+ * <avail> bytes are present, possibly wrapping at the end of the buffer. Chunk
+ * extensions are ignored. On success, the chunk size is stored into <res> and
+ * the length of the line including the CRLF is returned. Zero is returned if
+ * the line is not complete yet, and -1 if it is invalid.
+ */
+int http_parse_chunk_size(const struct buffer *buf, const char *ptr, int avail, unsigned int *res)
+{
+	const char *end = buf->data + BUFSIZE;
+	unsigned int chunk = 0;
+	int len = 0;
+	char c;
+
+	while (1) {
+		if (len >= avail)
+			return 0;
+		c = *ptr;
+		if (!ishex(c))
+			break;
+		if (chunk & 0xF0000000)
+			return -1; /* too large */
+		c = toupper(c) - '0';
+		if (c > 9)
+			c -= 'A' - '9' - 1;
+		chunk = (chunk << 4) | c;
+		len++;
+		if (++ptr == end)
+			ptr = buf->data;
+	}
+
+	if (!len)
+		return -1;
+
+	/* skip optional spaces and extensions up to the end of line */
+	while (!HTTP_IS_CRLF(*ptr)) {
+		len++;
+		if (len >= avail)
+			return 0;
+		if (++ptr == end)
+			ptr = buf->data;
+	}
+
+	if (*ptr == '\r') {
+		len++;
+		if (len >= avail)
+			return 0;
+		if (++ptr == end)
+			ptr = buf->data;
+		if (*ptr != '\n')
+			return -1;
+	}
+
+	*res = chunk;
+	return len + 1;
+}
+
+/* Returns a pointer to the first byte of buffer <buf> which is not scheduled
+ * for sending yet.
+ */
+static inline char *buffer_fwd_ptr(const struct buffer *buf)
+{
+	char *ptr = buf->w + buf->send_max;
+
+	if (ptr >= buf->data + BUFSIZE)
+		ptr -= BUFSIZE;
+	return ptr;
+}
+
+/* Returns the length of the line starting at <ptr> in buffer <buf>, of which
+ * <avail> bytes are present, including the trailing LF, or 0 if it is not
+ * complete yet.
+ */
+static int buffer_line_len(const struct buffer *buf, const char *ptr, int avail)
+{
+	const char *end = buf->data + BUFSIZE;
+	int len = 0;
+
+	while (len < avail) {
+		len++;
+		if (*ptr == '\n')
+			return len;
+		if (++ptr == end)
+			ptr = buf->data;
+	}
+	return 0;
+}
+
+/* Follows the body of message <msg> in buffer <buf>, whose headers have
+ * already been scheduled for forwarding, in order to find where it ends.
+ * Known-length bodies are simply forwarded. Chunked bodies (<chunked> not
+ * zero) are parsed only at chunk boundaries, and each chunk's data is
+ * forwarded at once, which allows it to be spliced. Since the data are never
+ * modified, an invalid body just makes the message switch to the ERROR state,
+ * and the rest of the data is left to the caller. It returns 1 once the
+ * message is in the DONE or ERROR state, otherwise zero.
+ */
+static int http_forward_body(struct buffer *buf, struct http_msg *msg, int chunked)
+{
+	unsigned int chunk;
+	int avail, ret;
+
+	/* the rest will never leave if the consumer has gone */
+	if (buf->flags & (BF_SHUTW|BF_SHUTW_NOW))
+		goto invalid;
+
+	while (1) {
+		if (msg->msg_state == HTTP_MSG_DATA && msg->chunk_len) {
+			/* schedule as many bytes as possible in one step */
+			chunk = msg->chunk_len > FORWARD_DEFAULT_SIZE ? FORWARD_DEFAULT_SIZE : msg->chunk_len;
+			buffer_forward(buf, chunk);
+			msg->chunk_len -= chunk;
+		}
+
+		/* wait for the scheduled data to be received before parsing */
+		if (buf->to_forward)
+			break;
+
+		avail = buf->l - buf->send_max;
+
+		if (msg->msg_state == HTTP_MSG_DATA) {
+			if (msg->chunk_len)
+				continue;
+			if (!chunked) {
+				msg->msg_state = HTTP_MSG_DONE;
+				return 1;
+			}
+			msg->msg_state = HTTP_MSG_DATA_CRLF;
+		}
+
+		if (msg->msg_state == HTTP_MSG_DATA_CRLF) {
+			ret = buffer_line_len(buf, buffer_fwd_ptr(buf), avail);
+			if (!ret)
+				goto missing_data;
+			if (ret > 2 || (ret == 2 && *buffer_fwd_ptr(buf) != '\r'))
+				goto invalid;
+			buffer_forward(buf, ret);
+			msg->msg_state = HTTP_MSG_CHUNK_SIZE;
+			continue;
+		}
+
+		if (msg->msg_state == HTTP_MSG_CHUNK_SIZE) {
+			ret = http_parse_chunk_size(buf, buffer_fwd_ptr(buf), avail, &chunk);
+			if (ret < 0)
+				goto invalid;
+			if (!ret)
+				goto missing_data;
+			buffer_forward(buf, ret);
+			if (chunk) {
+				msg->chunk_len = chunk;
+				msg->msg_state = HTTP_MSG_DATA;
+			}
+			else
+				msg->msg_state = HTTP_MSG_TRAILERS;
+			continue;
+		}
+
+		if (msg->msg_state == HTTP_MSG_TRAILERS) {
+			/* trailers are forwarded line by line up to the empty one */
+			char *ptr = buffer_fwd_ptr(buf);
+
+			ret = buffer_line_len(buf, ptr, avail);
+			if (!ret)
+				goto missing_data;
+			buffer_forward(buf, ret);
+			if (ret > 2 || (ret == 2 && *ptr != '\r'))
+				continue;
+			msg->msg_state = HTTP_MSG_DONE;
+			return 1;
+		}
+
+		/* unexpected state */
+		goto invalid;
+	}
+
+	/* more data scheduled to be received, unless the producer has left */
+	if (buf->flags & BF_SHUTR)
+		goto invalid;
+	return 0;
+
+ missing_data:
+	/* a line longer than the buffer will never complete. The buffer may
+	 * also be full of data still being sent, which only means we have to
+	 * wait, and a zero read limit only pauses the reads.
+	 */
+	if (!(buf->flags & BF_SHUTR) &&
+	    (!buf->max_len || buf->l - buf->send_max < buf->max_len))
+		return 0;
+ invalid:
+	msg->msg_state = HTTP_MSG_ERROR;
+	return 1;
+}
+
+/* Moves the <buf->l> bytes of buffer <buf> to the beginning of its data area,
+ * so that a new message may be parsed there. Nothing may be scheduled for
+ * forwarding.
+ */
+static void http_buffer_realign(struct buffer *buf)
+{
+	int len;
+
+	if (buf->w != buf->data) {
+		len = buf->data + BUFSIZE - buf->w;
+		if (len > buf->l)
+			len = buf->l;
+		memcpy(trash, buf->w, len);
+		memcpy(trash + len, buf->data, buf->l - len);
+		memcpy(buf->data, trash, buf->l);
+	}
+	buf->w = buf->lr = buf->data;
+	buf->r = buf->data + buf->l;
+	if (buf->r == buf->data + BUFSIZE)
+		buf->r = buf->data;
+}
+
+/* Ends the current transaction of session <s>, whose request and response
+ * have both been completely forwarded, and prepares it for the next request
+ * of the client, which may already be present in the request buffer. The
+ * server connection and the backend are kept, everything else is reset as
+ * upon a new connection, starting with the logs.
+ */
+static void http_end_txn(struct session *s)
+{
+	struct http_txn *txn = &s->txn;
+	struct proxy *fe = s->fe;
+	struct buffer *req = s->req;
+	struct buffer *rep = s->rep;
+	struct cap_hdr *h;
+
+	/* 1: log the transaction which has just ended */
+	s->logs.t_close = tv_ms_elapsed(&s->logs.tv_accept, &now);
+	session_process_counters(s);
+	session_process_timers(s);
+	if (s->logs.logwait && !(s->flags & SN_MONITOR) &&
+	    (!(fe->options & PR_O_NULLNOLOG) || req->total))
+		s->do_log(s);
+
+	/* the next request is logged only once it starts */
+	s->logs.logwait = 0;
+	s->logs.accept_date = date;
+	s->logs.tv_accept = now;
+	tv_zero(&s->logs.tv_request);
+	s->logs.t_queue = -1;     /* set once the request is released */
+	s->logs.t_connect = -1;
+	s->logs.t_data = -1;
+	s->logs.t_close = 0;
+	s->logs.prx_queue_size = 0;
+	s->logs.srv_queue_size = 0;
+	req->total = rep->total = 0;
+	s->logs.bytes_in = s->logs.bytes_out = 0;
+	s->conn_retries = s->be->conn_retries;
+	s->flags &= ~(SN_ERR_MASK|SN_FINST_MASK|SN_REDIRECTABLE|SN_REDISP);
+
+	/* 2: release what belonged to the transaction */
+	pool_free2(pool2_requri, txn->uri);
+	pool_free2(pool2_capture, txn->cli_cookie);
+	pool_free2(pool2_capture, txn->srv_cookie);
+	txn->uri = txn->cli_cookie = txn->srv_cookie = NULL;
+	free(txn->cache_obj);
+	txn->cache_obj = NULL;
+	pool_free2(pool2_body_spill, txn->spill);
+	txn->spill = NULL;
+
+	if (txn->req.cap) {
+		for (h = fe->req_cap; h; h = h->next) {
+			pool_free2(h->pool, txn->req.cap[h->index]);
+			txn->req.cap[h->index] = NULL;
+		}
+	}
+	if (txn->rsp.cap) {
+		for (h = fe->rsp_cap; h; h = h->next) {
+			pool_free2(h->pool, txn->rsp.cap[h->index]);
+			txn->rsp.cap[h->index] = NULL;
+		}
+	}
+
+	/* 3: wait for the next request */
+	txn->flags = TX_PIPELINED;
+	txn->status = -1;
+	txn->req.hdr_content_len = txn->rsp.hdr_content_len = 0LL;
+	txn->req.chunk_len = txn->rsp.chunk_len = 0LL;
+	txn->req.flags = txn->rsp.flags = 0;
+	if (!(fe->requires & ACL_USE_HDR_ANY))
+		txn->req.flags |= HTTP_MSGF_NO_HDR_IDX;
+	txn->req.msg_state = HTTP_MSG_RQBEFORE;
+	txn->rsp.msg_state = HTTP_MSG_RPBEFORE;
+	txn->req.sol = txn->req.eol = NULL;
+	txn->req.som = txn->req.eoh = 0;
+	txn->rsp.sol = txn->rsp.eol = NULL;
+	txn->rsp.som = txn->rsp.eoh = 0;
+	txn->req.err_pos = txn->rsp.err_pos = -2;
+	if (fe->options2 & PR_O2_REQBUG_OK)
+		txn->req.err_pos = -1;
+	if (s->be->options2 & PR_O2_RSPBUG_OK)
+		txn->rsp.err_pos = -1;
+	txn->auth_hdr.len = -1;
+	hdr_idx_init(&txn->hdr_idx);
+	acl_cache_flush(s, 0);
+
+	/* The next request is parsed from the beginning of the buffer. The
+	 * response analyser is only set once it has been accepted, so that
+	 * until then, an idle server may close without being reported.
+	 */
+	http_buffer_realign(req);
+	buffer_set_rlim(req, BUFSIZE - MAXREWRITE);
+	req->analyse_exp = TICK_ETERNITY;
+	req->analysers = AN_REQ_HTTP_HDR;
+	req->flags |= BF_READ_ATTACHED | BF_READ_DONTWAIT;
+
+	buffer_realign(rep);
+	rep->analysers = 0;
+}
+
+/* Called by the response body analyser once the response is complete, with
+ * pipelining enabled. The transaction ends once the request has been sent
+ * too, and the next one may then be processed over the same connection.
+ * If anything went wrong on either side, pipelining is abandoned and the
+ * connections close as they would have without it. It returns 1 when the
+ * analysers are left to go on, otherwise zero.
+ */
+static int http_pipeline_next(struct session *s)
+{
+	struct http_txn *txn = &s->txn;
+	struct buffer *req = s->req;
+	struct buffer *rep = s->rep;
+
+	if (txn->req.msg_state == HTTP_MSG_ERROR || txn->rsp.msg_state == HTTP_MSG_ERROR)
+		goto give_up;
+
+	/* the server must still be there to take the next request, and the
+	 * client to get its response.
+	 */
+	if ((rep->flags & (BF_SHUTR|BF_SHUTR_NOW|BF_SHUTW|BF_SHUTW_NOW)) ||
+	    (req->flags & (BF_SHUTW|BF_SHUTW_NOW)) || req->cons->state != SI_ST_EST)
+		goto give_up;
+
+	/* the request and the response must have completely left */
+	if (txn->req.msg_state != HTTP_MSG_DONE ||
+	    req->send_max || req->to_forward || (req->pipe && req->pipe->data) ||
+	    rep->l || rep->to_forward || (rep->pipe && rep->pipe->data))
+		return 0;
+
+	http_end_txn(s);
 	return 0;
+
+ give_up:
+	txn->flags &= ~TX_PIPELINE;
+	req->analysers &= ~AN_REQ_HTTP_XFER_BODY;
+	rep->analysers &= ~AN_RTR_HTTP_BODY;
+	return 1;
+}
+
+/* This function follows the body of the response whose headers have just been
+ * processed, in order to find where it ends. Since the data are never modified
+ * except to be compressed, an invalid body just makes the function give up and
+ * let the rest of the data flow until the connection closes. It returns 1
+ * once the message is complete or abandoned, otherwise zero. With pipelining,
+ * it stays attached to the complete response until the next transaction may
+ * start.
+ */
+int http_response_forward_body(struct session *s, struct buffer *rep)
+{
+	struct http_msg *msg = &s->txn.rsp;
+#ifdef USE_ZLIB
+	int ret;
+#endif
+
+	if (msg->msg_state == HTTP_MSG_BODY) {
+		/* a response to be cached is held until it is complete */
+		if (s->txn.cache_obj && !http_cache_store(s, rep))
+			return 0;
+
+		/* the headers have been processed and may now leave */
+		buffer_forward(rep, rep->lr - (rep->data + msg->som));
+		msg->msg_state = (s->txn.flags & TX_RES_CHNK) ? HTTP_MSG_CHUNK_SIZE : HTTP_MSG_DATA;
+	}
+
+	if (msg->msg_state == HTTP_MSG_DONE)
+		goto done;
+
+#ifdef USE_ZLIB
+	if (s->txn.comp_ctx) {
+		/* the compressed data replace the raw ones in the buffer */
+		ret = comp_forward(s->txn.comp_ctx, rep, &msg->chunk_len);
+		if (ret > 0)
+			msg->msg_state = HTTP_MSG_DONE;
+		else if (ret < 0 || (rep->flags & (BF_SHUTW|BF_SHUTW_NOW)) ||
+			 (msg->chunk_len && rep->l == rep->send_max && (rep->flags & BF_SHUTR))) {
+			/* the client must not get the rest as-is */
+			buffer_abort(rep);
+			msg->msg_state = HTTP_MSG_ERROR;
+		}
+		else
+			return 0;
+	}
+	else
+#endif
+	if (!http_forward_body(rep, msg, s->txn.flags & TX_RES_CHNK))
+		return 0;
+
+ done:
+#ifdef USE_ZLIB
+	comp_ctx_free(s->txn.comp_ctx);
+	s->txn.comp_ctx = NULL;
+#endif
+	if (s->txn.flags & TX_PIPELINE)
+		return http_pipeline_next(s);
+
+	/* whatever remains, if anything, is not part of this message */
+	rep->analysers &= ~AN_RTR_HTTP_BODY;
+	return 1;
+}
+
+/* This function follows the body of a request which may be followed by other
+ * ones on the same connection, so that only this request is forwarded. Once
+ * it has been sent, the response analyser is woken up to end the transaction.
+ * It returns 1 if the request analysers may go on, otherwise zero.
+ */
+int http_request_forward_body(struct session *s, struct buffer *req)
+{
+	struct http_txn *txn = &s->txn;
+	struct http_msg *msg = &txn->req;
+	int len;
+
+	if (msg->msg_state == HTTP_MSG_BODY) {
+		/* the headers have been processed and may now leave */
+		len = req->lr - req->w;
+		if (len < 0)
+			len += BUFSIZE;
+		buffer_forward(req, len);
+		msg->msg_state = (txn->flags & TX_REQ_CHNK) ? HTTP_MSG_CHUNK_SIZE : HTTP_MSG_DATA;
+	}
+
+	if (msg->msg_state != HTTP_MSG_DONE &&
+	    !http_forward_body(req, msg, txn->flags & TX_REQ_CHNK))
+		return 0;
+
+	if (msg->msg_state == HTTP_MSG_DONE && (txn->flags & TX_PIPELINE)) {
+		if (txn->rsp.msg_state == HTTP_MSG_DONE &&
+		    !req->send_max && !req->to_forward)
+			s->rep->flags |= BF_READ_ATTACHED;
+		return 0;
+	}
+
+	/* whatever remains is sent as-is, up to the end of the connection */
+	req->analysers &= ~AN_REQ_HTTP_XFER_BODY;
+	return 1;
 }
 
 /*
@@ -3129,6 +4397,7 @@ int apply_filter_to_req_headers(struct session *t, struct buffer *req, struct hd
 		*cur_end = '\0';
 
 		if (regexec(exp->preg, cur_ptr, MAX_MATCH, pmatch, 0) == 0) {
+			exp->hits++;
 			switch (exp->action) {
 			case ACT_SETBE:
 				/* It is not possible to jump a second time.
@@ -3252,6 +4521,7 @@ int apply_filter_to_req_line(struct session *t, struct buffer *req, struct hdr_e
 	*cur_end = '\0';
 
 	if (regexec(exp->preg, cur_ptr, MAX_MATCH, pmatch, 0) == 0) {
+		exp->hits++;
 		switch (exp->action) {
 		case ACT_SETBE:
 			/* It is not possible to jump a second time.
@@ -3330,16 +4600,22 @@ int apply_filter_to_req_line(struct session *t, struct buffer *req, struct hdr_e
 
 
 /*
- * Apply all the req filters <exp> to all headers in buffer <req> of session <t>.
- * Returns 0 if everything is alright, or -1 in case a replacement lead to an
- * unparsable request. Since it can manage the switch to another backend, it
- * updates the per-proxy DENY stats.
+ * Apply all the req filters of proxy <px> to all headers in buffer <req> of
+ * session <t>. Returns 0 if everything is alright, or -1 in case a replacement
+ * lead to an unparsable request. Since it can manage the switch to another
+ * backend, it updates the per-proxy DENY stats. If the proxy has option
+ * "reorder-filters", matching verdicts are promoted along the chain.
  */
-int apply_filters_to_request(struct session *t, struct buffer *req, struct hdr_exp *exp)
+int apply_filters_to_request(struct session *t, struct buffer *req, struct proxy *px)
 {
 	struct http_txn *txn = &t->txn;
+	struct hdr_exp *exp = px->req_exp;
+	struct hdr_exp *prev = NULL;
+	int reorder = px->options2 & PR_O2_REORDER;
+
 	/* iterate through the filters in the outer loop */
 	while (exp && !(txn->flags & (TX_CLDENY|TX_CLTARPIT))) {
+		unsigned int hits = exp->hits;
 		int ret;
 
 		/*
@@ -3351,6 +4627,7 @@ int apply_filters_to_request(struct session *t, struct buffer *req, struct hdr_e
 		if ((txn->flags & TX_CLALLOW) &&
 		    (exp->action == ACT_ALLOW || exp->action == ACT_DENY ||
 		     exp->action == ACT_TARPIT || exp->action == ACT_PASS)) {
+			prev = exp;
 			exp = exp->next;
 			continue;
 		}
@@ -3366,6 +4643,11 @@ int apply_filters_to_request(struct session *t, struct buffer *req, struct hdr_e
 			 */
 			apply_filter_to_req_headers(t, req, exp);
 		}
+
+		if (reorder && exp->hits != hits)
+			promote_regex(px->req_exp, prev, exp);
+
+		prev = exp;
 		exp = exp->next;
 	}
 	return 0;
@@ -3763,6 +5045,7 @@ int apply_filter_to_resp_headers(struct session *t, struct buffer *rtr, struct h
 		*cur_end = '\0';
 
 		if (regexec(exp->preg, cur_ptr, MAX_MATCH, pmatch, 0) == 0) {
+			exp->hits++;
 			switch (exp->action) {
 			case ACT_ALLOW:
 				txn->flags |= TX_SVALLOW;
@@ -3852,6 +5135,7 @@ int apply_filter_to_sts_line(struct session *t, struct buffer *rtr, struct hdr_e
 	*cur_end = '\0';
 
 	if (regexec(exp->preg, cur_ptr, MAX_MATCH, pmatch, 0) == 0) {
+		exp->hits++;
 		switch (exp->action) {
 		case ACT_ALLOW:
 			txn->flags |= TX_SVALLOW;
@@ -3899,15 +5183,21 @@ int apply_filter_to_sts_line(struct session *t, struct buffer *rtr, struct hdr_e
 
 
 /*
- * Apply all the resp filters <exp> to all headers in buffer <rtr> of session <t>.
- * Returns 0 if everything is alright, or -1 in case a replacement lead to an
- * unparsable response.
+ * Apply all the resp filters of proxy <px> to all headers in buffer <rtr> of
+ * session <t>. Returns 0 if everything is alright, or -1 in case a replacement
+ * lead to an unparsable response. If the proxy has option "reorder-filters",
+ * matching verdicts are promoted along the chain.
  */
-int apply_filters_to_response(struct session *t, struct buffer *rtr, struct hdr_exp *exp)
+int apply_filters_to_response(struct session *t, struct buffer *rtr, struct proxy *px)
 {
 	struct http_txn *txn = &t->txn;
+	struct hdr_exp *exp = px->rsp_exp;
+	struct hdr_exp *prev = NULL;
+	int reorder = px->options2 & PR_O2_REORDER;
+
 	/* iterate through the filters in the outer loop */
 	while (exp && !(txn->flags & TX_SVDENY)) {
+		unsigned int hits = exp->hits;
 		int ret;
 
 		/*
@@ -3919,6 +5209,7 @@ int apply_filters_to_response(struct session *t, struct buffer *rtr, struct hdr_
 		if ((txn->flags & TX_SVALLOW) &&
 		    (exp->action == ACT_ALLOW || exp->action == ACT_DENY ||
 		     exp->action == ACT_PASS)) {
+			prev = exp;
 			exp = exp->next;
 			continue;
 		}
@@ -3934,6 +5225,11 @@ int apply_filters_to_response(struct session *t, struct buffer *rtr, struct hdr_
 			 */
 			apply_filter_to_resp_headers(t, rtr, exp);
 		}
+
+		if (reorder && exp->hits != hits)
+			promote_regex(px->rsp_exp, prev, exp);
+
+		prev = exp;
 		exp = exp->next;
 	}
 	return 0;
@@ -5069,28 +6365,27 @@ static struct acl_kw_list acl_kws = {{ },{
 	{ "url_ip",     acl_parse_ip,    acl_fetch_url_ip,   acl_match_ip,   ACL_USE_L7REQ_VOLATILE },
 	{ "url_port",   acl_parse_int,   acl_fetch_url_port, acl_match_int,  ACL_USE_L7REQ_VOLATILE },
 
-	/* note: we should set hdr* to use ACL_USE_HDR_VOLATILE, and chdr* to use L7REQ_VOLATILE */
-	{ "hdr",        acl_parse_str,   acl_fetch_chdr,    acl_match_str, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_reg",    acl_parse_reg,   acl_fetch_chdr,    acl_match_reg, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_beg",    acl_parse_str,   acl_fetch_chdr,    acl_match_beg, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_end",    acl_parse_str,   acl_fetch_chdr,    acl_match_end, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_sub",    acl_parse_str,   acl_fetch_chdr,    acl_match_sub, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_dir",    acl_parse_str,   acl_fetch_chdr,    acl_match_dir, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_dom",    acl_parse_str,   acl_fetch_chdr,    acl_match_dom, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_cnt",    acl_parse_int,   acl_fetch_chdr_cnt,acl_match_int, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_val",    acl_parse_int,   acl_fetch_chdr_val,acl_match_int, ACL_USE_L7REQ_VOLATILE },
-	{ "hdr_ip",     acl_parse_ip,    acl_fetch_chdr_ip, acl_match_ip,  ACL_USE_L7REQ_VOLATILE },
-
-	{ "shdr",       acl_parse_str,   acl_fetch_shdr,    acl_match_str, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_reg",   acl_parse_reg,   acl_fetch_shdr,    acl_match_reg, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_beg",   acl_parse_str,   acl_fetch_shdr,    acl_match_beg, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_end",   acl_parse_str,   acl_fetch_shdr,    acl_match_end, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_sub",   acl_parse_str,   acl_fetch_shdr,    acl_match_sub, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_dir",   acl_parse_str,   acl_fetch_shdr,    acl_match_dir, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_dom",   acl_parse_str,   acl_fetch_shdr,    acl_match_dom, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_cnt",   acl_parse_int,   acl_fetch_shdr_cnt,acl_match_int, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_val",   acl_parse_int,   acl_fetch_shdr_val,acl_match_int, ACL_USE_L7RTR_VOLATILE },
-	{ "shdr_ip",    acl_parse_ip,    acl_fetch_shdr_ip, acl_match_ip,  ACL_USE_L7RTR_VOLATILE },
+	{ "hdr",        acl_parse_str,   acl_fetch_chdr,    acl_match_str, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_reg",    acl_parse_reg,   acl_fetch_chdr,    acl_match_reg, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_beg",    acl_parse_str,   acl_fetch_chdr,    acl_match_beg, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_end",    acl_parse_str,   acl_fetch_chdr,    acl_match_end, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_sub",    acl_parse_str,   acl_fetch_chdr,    acl_match_sub, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_dir",    acl_parse_str,   acl_fetch_chdr,    acl_match_dir, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_dom",    acl_parse_str,   acl_fetch_chdr,    acl_match_dom, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_cnt",    acl_parse_int,   acl_fetch_chdr_cnt,acl_match_int, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_val",    acl_parse_int,   acl_fetch_chdr_val,acl_match_int, ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "hdr_ip",     acl_parse_ip,    acl_fetch_chdr_ip, acl_match_ip,  ACL_USE_L7REQ_VOLATILE|ACL_USE_HDR_VOLATILE },
+
+	{ "shdr",       acl_parse_str,   acl_fetch_shdr,    acl_match_str, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_reg",   acl_parse_reg,   acl_fetch_shdr,    acl_match_reg, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_beg",   acl_parse_str,   acl_fetch_shdr,    acl_match_beg, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_end",   acl_parse_str,   acl_fetch_shdr,    acl_match_end, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_sub",   acl_parse_str,   acl_fetch_shdr,    acl_match_sub, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_dir",   acl_parse_str,   acl_fetch_shdr,    acl_match_dir, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_dom",   acl_parse_str,   acl_fetch_shdr,    acl_match_dom, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_cnt",   acl_parse_int,   acl_fetch_shdr_cnt,acl_match_int, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_val",   acl_parse_int,   acl_fetch_shdr_val,acl_match_int, ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
+	{ "shdr_ip",    acl_parse_ip,    acl_fetch_shdr_ip, acl_match_ip,  ACL_USE_L7RTR_VOLATILE|ACL_USE_HDR_VOLATILE },
 
 	{ "path",       acl_parse_str,   acl_fetch_path,   acl_match_str, ACL_USE_L7REQ_VOLATILE },
 	{ "path_reg",   acl_parse_reg,   acl_fetch_path,   acl_match_reg, ACL_USE_L7REQ_VOLATILE },
@@ -84,6 +84,8 @@ const char unix_sock_usage_msg[] =
         "  show stat   : report counters for each proxy and server\n"
         "  show errors : report last request and response errors for each proxy\n"
         "  show sess   : report the list of current sessions\n"
+        "  show filters: report hit counters of blocking and regex rules\n"
+        "  show histo  : report queue, connect and response time histograms\n"
 	"\n";
 
 const struct chunk unix_sock_usage = {
@@ -485,6 +487,7 @@ int uxst_event_accept(int fd) {
 
 		memset(&s->logs, 0, sizeof(s->logs));
 		memset(&s->txn, 0, sizeof(s->txn));
+		s->acl_cache = NULL;
 
 		s->logs.tv_accept = now;  /* corrected date for internal use */
 
@@ -636,7 +639,25 @@ int unix_sock_parse_request(struct session *s, char *line)
 			s->ana_state = STATS_ST_REP;
 			buffer_install_hijacker(s, s->rep, stats_dump_errors_to_buffer);
 		}
-		else { /* neither "stat" nor "info" nor "sess" */
+		else if (strcmp(args[1], "filters") == 0) {
+			if (*args[2])
+				s->data_ctx.filters.iid	= atoi(args[2]);
+			else
+				s->data_ctx.filters.iid	= -1;
+			s->data_ctx.filters.px = NULL;
+			s->ana_state = STATS_ST_REP;
+			buffer_install_hijacker(s, s->rep, stats_dump_filters_to_buffer);
+		}
+		else if (strcmp(args[1], "histo") == 0) {
+			if (*args[2])
+				s->data_ctx.histo.iid	= atoi(args[2]);
+			else
+				s->data_ctx.histo.iid	= -1;
+			s->data_ctx.histo.px = NULL;
+			s->ana_state = STATS_ST_REP;
+			buffer_install_hijacker(s, s->rep, stats_dump_histo_to_buffer);
+		}
+		else { /* neither "stat" nor "info" nor "sess" nor "errors" nor "filters" nor "histo" */
 			return 0;
 		}
 	}
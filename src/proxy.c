@@ -231,6 +231,60 @@ static int proxy_parse_rate_limit(char **args, int section, struct proxy *proxy,
 	return retval;
 }
 
+/* This function parses the "log-sample", "log-rate-limit" and "log-slow"
+ * statements in a proxy section. It returns -1 if there is any error, 1 for a
+ * warning, otherwise zero. If it does not return zero, it may write an error
+ * message into the <err> buffer, for at most <errlen> bytes, trailing zero
+ * included. The trailing '\n' must not be written. The function must be
+ * called with <args> pointing to the first command line word, with <proxy>
+ * pointing to the proxy being parsed, and <defpx> to the default proxy or
+ * NULL.
+ */
+static int proxy_parse_log_limit(char **args, int section, struct proxy *proxy,
+				 struct proxy *defpx, char *err, int errlen)
+{
+	unsigned int num, den, val;
+	const char *res;
+
+	if (!strcmp(args[0], "log-sample")) {
+		num = strtoul(args[1], (char **)&res, 10);
+		den = 0;
+		if (res != args[1] && *res == '/')
+			den = strtoul(res + 1, (char **)&res, 10);
+		if (*res || !den || num > den) {
+			snprintf(err, errlen, "'%s' expects a ratio such as '1/10', of at most '1/1'", args[0]);
+			return -1;
+		}
+		if (num == den)
+			den = 0; /* everything is logged */
+		proxy->log_sample_num = num;
+		proxy->log_sample_den = den;
+	}
+	else if (!strcmp(args[0], "log-rate-limit")) {
+		val = strtoul(args[1], (char **)&res, 10);
+		if (!*args[1] || *res) {
+			snprintf(err, errlen, "'%s' expects an integer value (in logs/second)", args[0]);
+			return -1;
+		}
+		proxy->log_rate_lim = val;
+	}
+	else {
+		res = *args[1] ? parse_time_err(args[1], &val, TIME_UNIT_MS) : args[1];
+		if (res) {
+			snprintf(err, errlen, "'%s' expects a time in milliseconds", args[0]);
+			return -1;
+		}
+		proxy->log_slow = val;
+	}
+
+	if (!(proxy->cap & PR_CAP_FE)) {
+		snprintf(err, errlen, "%s will be ignored because %s '%s' has no frontend capability",
+			 args[0], proxy_type_str(proxy), proxy->id);
+		return 1;
+	}
+	return 0;
+}
+
 /*
  * This function finds a proxy with matching name, mode and with satisfying
  * capabilities. It also checks if there are more matching proxies with
@@ -321,6 +375,14 @@ int proxy_cfg_ensure_no_http(struct proxy *curproxy)
 		Warning("config : monitor-uri will be ignored for %s '%s' (needs 'mode http').\n",
 			proxy_type_str(curproxy), curproxy->id);
 	}
+	if (curproxy->cache != NULL) {
+		Warning("config : cache will be ignored for %s '%s' (needs 'mode http').\n",
+			proxy_type_str(curproxy), curproxy->id);
+	}
+	if (curproxy->comp != NULL) {
+		Warning("config : compression will be ignored for %s '%s' (needs 'mode http').\n",
+			proxy_type_str(curproxy), curproxy->id);
+	}
 	if (curproxy->lbprm.algo & BE_LB_PROP_L7) {
 		curproxy->lbprm.algo &= ~BE_LB_ALGO;
 		curproxy->lbprm.algo |= BE_LB_ALGO_RR;
@@ -637,6 +699,9 @@ static struct cfg_kw_list cfg_kws = {{ },{
 	{ CFG_LISTEN, "contimeout", proxy_parse_timeout },
 	{ CFG_LISTEN, "srvtimeout", proxy_parse_timeout },
 	{ CFG_LISTEN, "rate-limit", proxy_parse_rate_limit },
+	{ CFG_LISTEN, "log-sample", proxy_parse_log_limit },
+	{ CFG_LISTEN, "log-rate-limit", proxy_parse_log_limit },
+	{ CFG_LISTEN, "log-slow", proxy_parse_log_limit },
 	{ 0, NULL, NULL },
 }};
 
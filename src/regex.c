@@ -96,8 +96,10 @@ const char *check_replace_string(const char *str)
 }
 
 
-/* returns the pointer to an error in the replacement string, or NULL if OK */
-const char *chain_regex(struct hdr_exp **head, const regex_t *preg,
+/* returns the pointer to an error in the replacement string, or NULL if OK.
+ * <str> is the source of the expression, it is duplicated for reporting.
+ */
+const char *chain_regex(struct hdr_exp **head, const regex_t *preg, const char *str,
 			int action, const char *replace)
 {
 	struct hdr_exp *exp;
@@ -115,6 +117,7 @@ const char *chain_regex(struct hdr_exp **head, const regex_t *preg,
 	exp = calloc(1, sizeof(struct hdr_exp));
 
 	exp->preg = preg;
+	exp->str = str ? strdup(str) : NULL;
 	exp->replace = replace;
 	exp->action = action;
 	*head = exp;
@@ -122,6 +125,49 @@ const char *chain_regex(struct hdr_exp **head, const regex_t *preg,
 	return NULL;
 }
 
+/* Returns non-zero if two adjacent expressions performing action <action> may
+ * be evaluated in any order without changing the outcome. Only pure verdicts
+ * qualify, since the first one to match stops the evaluation anyway.
+ */
+static inline int regex_action_commutes(int action)
+{
+	return action == ACT_ALLOW || action == ACT_DENY || action == ACT_TARPIT;
+}
+
+/* To be called when expression <exp> from the chain starting at <head> has
+ * just matched, with <prev> being the expression immediately before it in the
+ * chain (or NULL). If both expressions perform the same verdict and <exp>
+ * matches more often than <prev>, their contents are swapped so that the most
+ * frequently matching one will be tried first next time. Scores are halved
+ * for the whole chain when one of them reaches EXP_SCORE_MAX so that the order
+ * keeps following the traffic. Swapping contents instead of nodes keeps the
+ * chain's head untouched and lets the caller's iterator continue with
+ * exp->next.
+ */
+void promote_regex(struct hdr_exp *head, struct hdr_exp *prev, struct hdr_exp *exp)
+{
+	const regex_t *preg;
+	const char *str;
+	unsigned int tmp;
+
+	if (++exp->score >= EXP_SCORE_MAX) {
+		struct hdr_exp *cur;
+		for (cur = head; cur; cur = cur->next)
+			cur->score >>= 1;
+	}
+
+	if (!prev || prev->action != exp->action ||
+	    !regex_action_commutes(exp->action) ||
+	    exp->score <= prev->score)
+		return;
+
+	preg = prev->preg;  prev->preg  = exp->preg;  exp->preg  = preg;
+	str  = prev->str;   prev->str   = exp->str;   exp->str   = str;
+	str  = prev->replace; prev->replace = exp->replace; exp->replace = str;
+	tmp  = prev->hits;  prev->hits  = exp->hits;  exp->hits  = tmp;
+	tmp  = prev->score; prev->score = exp->score; exp->score = tmp;
+}
+
 
 
 /*
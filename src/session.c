@@ -19,9 +19,12 @@
 #include <types/capture.h>
 #include <types/global.h>
 
+#include <proto/acl.h>
 #include <proto/backend.h>
 #include <proto/buffers.h>
+#include <proto/compression.h>
 #include <proto/hdr_idx.h>
+#include <proto/histo.h>
 #include <proto/log.h>
 #include <proto/session.h>
 #include <proto/pipe.h>
@@ -97,6 +100,12 @@ void session_free(struct session *s)
 	pool_free2(pool2_requri, txn->uri);
 	pool_free2(pool2_capture, txn->cli_cookie);
 	pool_free2(pool2_capture, txn->srv_cookie);
+	free(txn->cache_obj);
+	pool_free2(pool2_body_spill, txn->spill);
+#ifdef USE_ZLIB
+	comp_ctx_free(txn->comp_ctx);
+#endif
+	pool_free2(pool2_acl_cache, s->acl_cache);
 
 	list_for_each_entry_safe(bref, back, &s->back_refs, users) {
 		/* we have to unlink all watchers. We must not relink them if
@@ -165,6 +174,47 @@ void session_process_counters(struct session *s)
 	}
 }
 
+/* Accounts the queue, connect and response times of the request which has
+ * just ended in the histograms of its backend and of its server, if any. They
+ * are computed as in the logs, and the timers which were not reached are
+ * ignored, as well as the connect time of requests sent over a kept server
+ * connection.
+ */
+void session_process_timers(struct session *s)
+{
+	struct proxy *be = s->be;
+	long t_request = 0;
+	long t_queue, t_connect, t_resp;
+
+	if (s->logs.t_queue < 0 || !(be->cap & PR_CAP_BE))
+		return;
+
+	if (tv_isge(&s->logs.tv_request, &s->logs.tv_accept))
+		t_request = tv_ms_elapsed(&s->logs.tv_accept, &s->logs.tv_request);
+	else if (be->mode == PR_MODE_HTTP)
+		return; /* no complete request, eg: idle keep-alive connection */
+
+	t_queue = s->logs.t_queue - t_request;
+	t_connect = t_resp = -1;
+	if (s->logs.t_connect >= 0) {
+		/* a kept server connection was not connected for this request */
+		if (!(s->txn.flags & TX_PIPELINED))
+			t_connect = s->logs.t_connect - s->logs.t_queue;
+		if (s->logs.t_data >= 0)
+			t_resp = s->logs.t_data - s->logs.t_connect;
+	}
+
+	histo_add(&be->histo[HISTO_QUEUE], t_queue);
+	histo_add(&be->histo[HISTO_CONNECT], t_connect);
+	histo_add(&be->histo[HISTO_RESPONSE], t_resp);
+
+	if (s->srv) {
+		histo_add(&s->srv->histo[HISTO_QUEUE], t_queue);
+		histo_add(&s->srv->histo[HISTO_CONNECT], t_connect);
+		histo_add(&s->srv->histo[HISTO_RESPONSE], t_resp);
+	}
+}
+
 /* This function is called with (si->state == SI_ST_CON) meaning that a
  * connection was attempted and that the file descriptor is already allocated.
  * We must check for establishment, error and abort. Possible output states
@@ -755,8 +805,13 @@ resync_stream_interface:
 					if (!http_process_request_body(s, s->req))
 						break;
 
+				if (s->req->analysers & AN_REQ_HTTP_XFER_BODY)
+					if (!http_request_forward_body(s, s->req))
+						break;
+
 				/* Just make sure that nobody set a wrong flag causing an endless loop */
-				s->req->analysers &= AN_REQ_INSPECT | AN_REQ_HTTP_HDR | AN_REQ_HTTP_TARPIT | AN_REQ_HTTP_BODY;
+				s->req->analysers &= AN_REQ_INSPECT | AN_REQ_HTTP_HDR | AN_REQ_HTTP_TARPIT |
+					AN_REQ_HTTP_BODY | AN_REQ_HTTP_XFER_BODY;
 
 				/* we don't want to loop anyway */
 				break;
@@ -875,6 +930,14 @@ resync_stream_interface:
 			s->req->cons->state = SI_ST_CLO; /* shutw+ini = abort */
 	}
 
+	/* a request reusing an established server connection is neither
+	 * queued nor connected : both timers start when it is released.
+	 */
+	if (s->req->cons->state == SI_ST_EST && s->logs.t_queue < 0 &&
+	    tv_isge(&s->logs.tv_request, &s->logs.tv_accept) &&
+	    (s->req->flags & (BF_WRITE_ENA|BF_SHUTW|BF_SHUTW_NOW)) == BF_WRITE_ENA)
+		s->logs.t_queue = s->logs.t_connect = tv_ms_elapsed(&s->logs.tv_accept, &now);
+
 
 	/* we may have a pending connection request, or a connection waiting
 	 * for completion.
@@ -937,8 +1000,25 @@ resync_stream_interface:
 		if (s->rep->prod->state >= SI_ST_EST) {
 			/* it's up to the analysers to reset write_ena */
 			buffer_write_ena(s->rep);
-			if (s->rep->analysers)
-				process_response(s);
+
+			/* same as for the request, analysers are called in
+			 * turn and remove themselves once finished.
+			 */
+			while (s->rep->analysers) {
+				if (s->rep->analysers & AN_RTR_HTTP_HDR)
+					if (!process_response(s))
+						break;
+
+				if (s->rep->analysers & AN_RTR_HTTP_BODY)
+					if (!http_response_forward_body(s, s->rep))
+						break;
+
+				/* Just make sure that nobody set a wrong flag causing an endless loop */
+				s->rep->analysers &= AN_RTR_HTTP_HDR | AN_RTR_HTTP_BODY;
+
+				/* we don't want to loop anyway */
+				break;
+			}
 		}
 
 		/* Report it if the server got an error or a read timeout expired */
@@ -1160,6 +1240,7 @@ resync_stream_interface:
 
 	s->logs.t_close = tv_ms_elapsed(&s->logs.tv_accept, &now);
 	session_process_counters(s);
+	session_process_timers(s);
 
 	/* let's do a final log if we need it */
 	if (s->logs.logwait &&
@@ -70,6 +70,92 @@ const char *ultoa_r(unsigned long n, char *buffer, int size)
 	return pos + 1;
 }
 
+/*
+ * Writes the ascii representation for number 'n' in decimal at <dst>, which
+ * may receive at most <size> chars including the trailing zero. Returns a
+ * pointer to the trailing zero, or NULL if there is not enough room.
+ */
+char *ultoa_o(unsigned long n, char *dst, int size)
+{
+	char tmp[21];
+	char *pos = tmp + sizeof(tmp);
+	int len;
+
+	do {
+		*--pos = '0' + n % 10;
+		n /= 10;
+	} while (n);
+
+	len = tmp + sizeof(tmp) - pos;
+	if (len >= size)
+		return NULL;
+	memcpy(dst, pos, len);
+	dst[len] = '\0';
+	return dst + len;
+}
+
+/*
+ * Same as ultoa_o() for signed number 'n'.
+ */
+char *ltoa_o(long n, char *dst, int size)
+{
+	if (n >= 0)
+		return ultoa_o(n, dst, size);
+	if (size < 2)
+		return NULL;
+	*dst = '-';
+	return ultoa_o(-(unsigned long)n, dst + 1, size - 1);
+}
+
+/*
+ * Same as ltoa_o() for long long number 'n'. Small numbers avoid the 64-bit
+ * divisions.
+ */
+char *lltoa_o(long long n, char *dst, int size)
+{
+	char tmp[21];
+	char *pos = tmp + sizeof(tmp);
+	unsigned long long u;
+	int len;
+
+	if (n >= 0 && n <= (long long)(~0UL))
+		return ultoa_o(n, dst, size);
+
+	u = (n < 0) ? -(unsigned long long)n : n;
+	do {
+		*--pos = '0' + u % 10;
+		u /= 10;
+	} while (u);
+
+	if (n < 0)
+		*--pos = '-';
+
+	len = tmp + sizeof(tmp) - pos;
+	if (len >= size)
+		return NULL;
+	memcpy(dst, pos, len);
+	dst[len] = '\0';
+	return dst + len;
+}
+
+/*
+ * Writes the <size-1> lowest decimal digits of number 'n' at <dst>, padded
+ * with zeroes on the left, followed by a trailing zero. Returns a pointer to
+ * the trailing zero.
+ */
+char *utoa_pad(unsigned int n, char *dst, int size)
+{
+	char *end = dst + size - 1;
+	char *pos = end;
+
+	*end = '\0';
+	while (pos > dst) {
+		*--pos = '0' + n % 10;
+		n /= 10;
+	}
+	return end;
+}
+
 /*
  * This function simply returns a locally allocated string containing
  * the ascii representation for number 'n' in decimal, formatted for
@@ -359,6 +445,38 @@ int str2net(const char *str, struct in_addr *addr, struct in_addr *mask)
 	goto out_free;
 }
 
+/*
+ * converts <str> to a struct in6_addr and a prefix length, which must be
+ * pre-allocated. The format is "addr[/len]", where "addr" cannot be empty
+ * and "len" is between 0 and 128 (defaults to 128). Hostnames are not
+ * supported. Returns 1 if OK, 0 if error.
+ */
+int str62net(const char *str, struct in6_addr *addr, int *plen)
+{
+	char *c, *s, *err;
+	int ret_val = 0;
+	long len = 128;
+
+	s = strdup(str);
+	if (!s)
+		return 0;
+
+	if ((c = strrchr(s, '/')) != NULL) {
+		*c++ = '\0';
+		len = strtol(c, &err, 10);
+		if (!*c || (err && *err) || len < 0 || len > 128)
+			goto out_free;
+	}
+
+	if (inet_pton(AF_INET6, s, addr) > 0) {
+		*plen = len;
+		ret_val = 1;
+	}
+ out_free:
+	free(s);
+	return ret_val;
+}
+
 
 /*
  * Parse IP address found in url.
@@ -713,6 +831,49 @@ const char *parse_time_err(const char *text, unsigned *ret, unsigned unit_flags)
 	return NULL;
 }
 
+/* This function parses a size in bytes optionally followed by a unit suffix
+ * among "k", "m" or "g" (powers of 1024). The value is returned in <ret> if
+ * everything is fine, and a NULL is returned by the function. In case of
+ * error, a pointer to the error is returned and <ret> is left untouched.
+ */
+const char *parse_size_err(const char *text, unsigned *ret)
+{
+	unsigned long long value = 0;
+	unsigned int j;
+
+	while ((j = *text - '0') <= 9) {
+		value = value * 10 + j;
+		if (value > ~0U)
+			return text;
+		text++;
+	}
+
+	switch (*text) {
+	case '\0':
+		break;
+	case 'k': case 'K':
+		value <<= 10;
+		text++;
+		break;
+	case 'm': case 'M':
+		value <<= 20;
+		text++;
+		break;
+	case 'g': case 'G':
+		value <<= 30;
+		text++;
+		break;
+	default:
+		return text;
+	}
+
+	if (*text || value > ~0U)
+		return text;
+
+	*ret = value;
+	return NULL;
+}
+
 /* copies at most <n> characters from <src> and always terminates with '\0' */
 char *my_strndup(const char *src, int n)
 {
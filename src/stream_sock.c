@@ -285,6 +285,9 @@ int stream_sock_read(int fd) {
 		}
 		else if (b->r > b->w) {
 			max = b->data + b->max_len - b->r;
+			/* data may have been inserted after the read limit */
+			if (max < 0)
+				max = 0;
 		}
 		else {
 			max = b->w - b->r;